@@ -0,0 +1,26 @@
+#version 330 core
+
+out vec4 FragColor;
+in vec2 TexCoords;
+
+uniform sampler2DArray layers;
+uniform int layerCount;
+uniform vec2 layerOffset[8]; // PARALLAX_MAX_LAYERS, scroll of each layer in screens
+
+void main()
+{   
+    // back to front "over", the farthest layer is expected to be opaque
+    vec3 color = vec3(0.0);
+    for (int i = 0; i < layerCount; i++)
+    {
+        vec4 layer = texture(layers, vec3(TexCoords + layerOffset[i], float(i)));
+        color = mix(color, layer.rgb, layer.a);
+    }
+
+#ifdef OVERDRAW
+    // every layer in one fragment, the same single step as one sprite in _fragment_sprite.fs
+    FragColor = vec4(0.1, 0.05, 0.025, 1.0);
+#else
+    FragColor = vec4(color, 1.0);
+#endif
+}
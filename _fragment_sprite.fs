@@ -0,0 +1,26 @@
+#version 330 core
+
+out vec4 FragColor;
+in vec2 TexCoords;
+in vec4 Tint;
+
+uniform sampler2D tex;
+
+vec4 texColor;
+
+void main()
+{   
+    texColor = texture(tex, TexCoords) * Tint;
+#ifndef OPAQUE_PASS
+    // the opaque pass draws front to back with early depth test, a discard would turn that off
+    if(texColor.a < 0.1)
+        discard;
+#endif
+
+#ifdef OVERDRAW
+    // one step per shaded fragment, summed with (GL_ONE, GL_ONE): red saturates at 10, yellow 20, white 40
+    FragColor = vec4(0.1, 0.05, 0.025, 1.0);
+#else
+    FragColor = texColor;
+#endif
+}
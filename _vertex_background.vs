@@ -3,10 +3,18 @@ layout (location = 0) in vec3 vertex3D;
 layout (location = 1) in vec2 texCoord;
 
 uniform mat4 model;
+
+layout (std140) uniform FrameUniforms
+{
+    mat4 view;
+    mat4 projection;
+    vec4 viewportTime; // xy viewport size, z time, w frame dt
+};
+
 out vec2 TexCoords;
 
 void main()
 {   
-    gl_Position = model * vec4(vertex3D, 1.0);
+    gl_Position = projection * view * model * vec4(vertex3D, 1.0);
     TexCoords = texCoord;
 }
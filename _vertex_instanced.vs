@@ -0,0 +1,33 @@
+#version 330 core
+layout (location = 0) in vec3 vertex3D;
+layout (location = 1) in vec2 texCoord;
+
+// per instance, see shapes::instance_2d
+layout (location = 3) in vec4 instancePosition; // xyz position, w rotation (radians)
+layout (location = 4) in vec4 instanceScale;    // xy scale, z flip
+layout (location = 5) in vec4 instanceUVRect;   // u0 v0 u1 v1
+
+layout (std140) uniform FrameUniforms
+{
+    mat4 view;
+    mat4 projection;
+    vec4 viewportTime; // xy viewport size, z time, w frame dt
+};
+
+out vec2 TexCoords;
+
+void main()
+{   
+    float s = sin(instancePosition.w);
+    float c = cos(instancePosition.w);
+    vec2 local = vertex3D.xy * instanceScale.xy;
+    vec2 world = vec2(c * local.x - s * local.y, s * local.x + c * local.y) + instancePosition.xy;
+    gl_Position = projection * view * vec4(world, vertex3D.z + instancePosition.z, 1.0);
+
+    vec2 uv = texCoord;
+    if(instanceScale.z > 0.5)
+    {
+        uv.x = 1 - uv.x;
+    }
+    TexCoords = mix(instanceUVRect.xy, instanceUVRect.zw, uv);
+}
@@ -3,8 +3,13 @@ layout (location = 0) in vec3 vertex3D;
 layout (location = 1) in vec2 texCoord;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+layout (std140) uniform FrameUniforms
+{
+    mat4 view;
+    mat4 projection;
+    vec4 viewportTime; // xy viewport size, z time, w frame dt
+};
 
 out vec2 TexCoords;
 
@@ -0,0 +1,29 @@
+#version 330 core
+layout (location = 0) in vec3 vertex3D;
+layout (location = 1) in vec2 texCoord;
+
+// per instance, see shapes::instance_matrix
+layout (location = 3) in mat4 instanceModel;  // locations 3-6
+layout (location = 7) in vec4 instanceUVRect; // u0 v0 u1 v1
+layout (location = 8) in float instanceFlip;
+
+layout (std140) uniform FrameUniforms
+{
+    mat4 view;
+    mat4 projection;
+    vec4 viewportTime; // xy viewport size, z time, w frame dt
+};
+
+out vec2 TexCoords;
+
+void main()
+{   
+    gl_Position = projection * view * instanceModel * vec4(vertex3D, 1.0);
+
+    vec2 uv = texCoord;
+    if(instanceFlip > 0.5)
+    {
+        uv.x = 1 - uv.x;
+    }
+    TexCoords = mix(instanceUVRect.xy, instanceUVRect.zw, uv);
+}
@@ -0,0 +1,11 @@
+#version 330 core
+
+out vec2 TexCoords;
+
+void main()
+{   
+    // one triangle over the whole screen, no vertex buffer: ids 0, 1, 2 -> (-1, -1), (3, -1), (-1, 3)
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2.0 - 1.0;
+    gl_Position = vec4(position, 0.0, 1.0);
+    TexCoords = position * 0.5 + 0.5;
+}
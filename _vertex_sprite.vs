@@ -0,0 +1,22 @@
+#version 330 core
+layout (location = 0) in vec3 vertex3D;
+layout (location = 1) in vec2 texCoord;
+layout (location = 2) in vec4 tint;
+
+layout (std140) uniform FrameUniforms
+{
+    mat4 view;
+    mat4 projection;
+    vec4 viewportTime; // xy viewport size, z time, w frame dt
+};
+
+out vec2 TexCoords;
+out vec4 Tint;
+
+void main()
+{   
+    // positions are already in world space, the batcher applies the sprite transform
+    gl_Position = projection * view * vec4(vertex3D, 1.0);
+    TexCoords = texCoord;
+    Tint = tint;
+}
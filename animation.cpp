@@ -0,0 +1,234 @@
+#include "animation.h"
+#include "textureAtlas.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+bool ANIMATION_DBG = false;
+
+AnimationLibrary::AnimationLibrary()
+{
+    _event_names.push_back("");
+    addClip("none", CLIP_LOOP, {clip_frame_t{TextureRegion{0, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f)}, 1.0f, CLIP_EVENT_NONE}});
+}
+
+uint16_t AnimationLibrary::addClip(const std::string &name, clip_loop_t loop, const std::vector<clip_frame_t> &frames)
+{
+    if (frames.empty() || _clips.size() >= 0xFFFF)
+    {
+        printf("Animation: clip %s has no frames\n", name.c_str());
+        return CLIP_NONE;
+    }
+
+    animation_clip_t clip;
+    clip.first_frame = (uint32_t)_frames.size();
+    clip.frame_count = (uint16_t)frames.size();
+    clip.loop = (uint8_t)loop;
+    clip.length = 0.0f;
+    for (const clip_frame_t &frame : frames)
+    {
+        // zero length frames would never show and stall the lookup
+        clip_frame_t f = frame;
+        f.duration = f.duration > 1e-4f ? f.duration : 1e-4f;
+        clip.length += f.duration;
+        _frames.push_back(f);
+    }
+
+    uint16_t id = (uint16_t)_clips.size();
+    _clips.push_back(clip);
+    if (_clip_ids.count(name))
+    {
+        printf("Animation: clip %s redefined\n", name.c_str());
+    }
+    _clip_ids[name] = id;
+    return id;
+}
+
+// ---- .anim files ----
+
+static clip_loop_t parse_loop(const char *mode, bool &ok)
+{
+    ok = true;
+    if (strcmp(mode, "loop") == 0)
+    {
+        return CLIP_LOOP;
+    }
+    if (strcmp(mode, "once") == 0)
+    {
+        return CLIP_ONCE;
+    }
+    if (strcmp(mode, "pingpong") == 0)
+    {
+        return CLIP_PING_PONG;
+    }
+    ok = false;
+    return CLIP_LOOP;
+}
+
+bool AnimationLibrary::load(const std::string &path, const TextureAtlas &atlas)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        printf("Animation: could not open %s\n", path.c_str());
+        return false;
+    }
+
+    std::string clip_name;
+    clip_loop_t clip_loop = CLIP_LOOP;
+    std::vector<clip_frame_t> clip_frames;
+    int clips_before = (int)_clips.size();
+    bool ok = true;
+
+    char line[512];
+    int line_number = 0;
+    while (ok && fgets(line, sizeof(line), file))
+    {
+        line_number++;
+        char *comment = strchr(line, '#');
+        if (comment)
+        {
+            *comment = '\0';
+        }
+
+        char keyword[16], name[256], extra[64];
+        extra[0] = '\0';
+        float duration = 0.0f;
+        if (sscanf(line, "%15s", keyword) != 1)
+        {
+            continue;
+        }
+
+        if (strcmp(keyword, "clip") == 0)
+        {
+            char mode[16] = "loop";
+            if (sscanf(line, "%*s %255s %15s", name, mode) < 1)
+            {
+                ok = false;
+                break;
+            }
+            if (!clip_name.empty())
+            {
+                addClip(clip_name, clip_loop, clip_frames);
+            }
+            clip_name = name;
+            clip_loop = parse_loop(mode, ok);
+            clip_frames.clear();
+        }
+        else if (strcmp(keyword, "frame") == 0 && !clip_name.empty())
+        {
+            if (sscanf(line, "%*s %255s %f %63s", name, &duration, extra) < 2)
+            {
+                ok = false;
+                break;
+            }
+            uint16_t event = extra[0] ? findEvent(extra) : CLIP_EVENT_NONE;
+            clip_frames.push_back(clip_frame_t{atlas.region(name), duration, event});
+        }
+        else
+        {
+            ok = false;
+        }
+    }
+    fclose(file);
+
+    if (!ok)
+    {
+        printf("Animation: %s line %d can not be parsed\n", path.c_str(), line_number);
+        return false;
+    }
+    if (!clip_name.empty())
+    {
+        addClip(clip_name, clip_loop, clip_frames);
+    }
+
+    if (ANIMATION_DBG)
+    {
+        printf("Animation: %d clips from %s\n", (int)_clips.size() - clips_before, path.c_str());
+    }
+    return true;
+}
+
+// ---- Lookups ----
+
+uint16_t AnimationLibrary::find(const std::string &name) const
+{
+    auto it = _clip_ids.find(name);
+    if (it == _clip_ids.end())
+    {
+        printf("Animation: no clip named %s\n", name.c_str());
+        return CLIP_NONE;
+    }
+    return it->second;
+}
+
+uint16_t AnimationLibrary::findEvent(const std::string &name)
+{
+    auto it = _event_ids.find(name);
+    if (it != _event_ids.end())
+    {
+        return it->second;
+    }
+    uint16_t id = (uint16_t)_event_names.size();
+    _event_names.push_back(name);
+    _event_ids[name] = id;
+    return id;
+}
+
+const std::string &AnimationLibrary::getEventName(uint16_t event) const
+{
+    return _event_names[event < _event_names.size() ? event : CLIP_EVENT_NONE];
+}
+
+const animation_clip_t &AnimationLibrary::getClip(uint16_t clip) const
+{
+    return _clips[clip < _clips.size() ? clip : CLIP_NONE];
+}
+
+const clip_frame_t &AnimationLibrary::getFrame(uint32_t frame) const
+{
+    return _frames[frame];
+}
+
+uint16_t AnimationLibrary::getClipCount() const
+{
+    return (uint16_t)_clips.size();
+}
+
+uint32_t AnimationLibrary::frameAt(uint16_t clip_id, float time) const
+{
+    const animation_clip_t &clip = getClip(clip_id);
+    if (clip.frame_count == 1)
+    {
+        return clip.first_frame;
+    }
+
+    float t;
+    switch (clip.loop)
+    {
+    case CLIP_ONCE:
+        t = time < clip.length ? time : clip.length;
+        break;
+    case CLIP_PING_PONG:
+        t = fmodf(time, 2.0f * clip.length);
+        t = t > clip.length ? 2.0f * clip.length - t : t;
+        break;
+    case CLIP_LOOP:
+    default:
+        t = fmodf(time, clip.length);
+        break;
+    }
+
+    // clips are a handful of frames, a scan beats anything cleverer
+    uint32_t last = clip.first_frame + clip.frame_count - 1;
+    for (uint32_t frame = clip.first_frame; frame < last; frame++)
+    {
+        t -= _frames[frame].duration;
+        if (t < 0.0f)
+        {
+            return frame;
+        }
+    }
+    return last;
+}
@@ -0,0 +1,276 @@
+#include "assetLoader.h"
+#include "glStateCache.h"
+#include "profiler.h"
+#include "stb/stb_image.h"
+
+#include <GLFW/glfw3.h>
+
+#include <cstdio>
+#include <cstring>
+
+bool ASSET_LOADER_DBG = false;
+
+AssetLoader::AssetLoader(int num_workers)
+    : _stop(false), _in_flight(0), _next_upload_buffer(0)
+{
+    if (num_workers <= 0)
+    {
+        // leave one core for the render thread
+        num_workers = (int)std::thread::hardware_concurrency() - 1;
+        if (num_workers < 1)
+        {
+            num_workers = 1;
+        }
+    }
+
+    glGenBuffers(NUM_UPLOAD_BUFFERS, _upload_buffers);
+
+    for (int i = 0; i < num_workers; i++)
+    {
+        _workers.emplace_back(&AssetLoader::workerLoop, this);
+    }
+    printf("Asset loader started with %d workers.\n", num_workers);
+}
+
+AssetLoader::~AssetLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _wake.notify_all();
+    for (auto &worker : _workers)
+    {
+        worker.join();
+    }
+
+    for (asset_job_t *job : _queued)
+    {
+        delete job;
+    }
+    for (asset_job_t *job : _finished)
+    {
+        stbi_image_free(job->pixels);
+        delete job;
+    }
+
+    for (int i = 0; i < NUM_UPLOAD_BUFFERS; i++)
+    {
+        GLStateCache::get().forgetBuffer(_upload_buffers[i]);
+    }
+    glDeleteBuffers(NUM_UPLOAD_BUFFERS, _upload_buffers);
+}
+
+Texture2D *AssetLoader::loadTexture(const std::string &path)
+{
+    _textures.emplace_back(new Texture2D());
+    Texture2D *texture = _textures.back().get();
+
+    asset_job_t *job = new asset_job_t{};
+    job->type = ASSET_TEXTURE;
+    job->path = preferCooked(path);
+    job->texture = texture;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _queued.push_back(job);
+        _in_flight++;
+    }
+    _wake.notify_one();
+    return texture;
+}
+
+Mesh *AssetLoader::loadMesh(const std::string &path)
+{
+    _meshes.emplace_back(new Mesh(QUAD));
+    Mesh *mesh = _meshes.back().get();
+
+    asset_job_t *job = new asset_job_t{};
+    job->type = ASSET_MESH;
+    job->path = preferCooked(path);
+    job->mesh = mesh;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _queued.push_back(job);
+        _in_flight++;
+    }
+    _wake.notify_one();
+    return mesh;
+}
+
+void AssetLoader::workerLoop()
+{
+    // per thread override, the global stbi flag is shared with the render thread
+    stbi_set_flip_vertically_on_load_thread(1);
+    Profiler::get().setThreadName("asset worker");
+
+    while (true)
+    {
+        asset_job_t *job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [this]
+                       { return _stop || !_queued.empty(); });
+            if (_stop)
+            {
+                return;
+            }
+            job = _queued.front();
+            _queued.pop_front();
+        }
+
+        decode(*job);
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _finished.push_back(job);
+    }
+}
+
+// worker side, no GL calls
+void AssetLoader::decode(asset_job_t &job)
+{
+    PROFILE_SCOPE("decode");
+    if (isCookedPath(job.path))
+    {
+        // nothing to decode, the page-in happens here instead of on the GL thread
+        job.cooked.reset(new MappedFile());
+        job.ok = job.cooked->open(job.path) &&
+                 (job.type == ASSET_TEXTURE ? readTextureContainer(*job.cooked, job.cooked_texture) : cookedMesh(*job.cooked) != nullptr);
+    }
+    else
+    {
+        decodeSource(job);
+    }
+
+    if (!job.ok)
+    {
+        printf("Asset loader: failed to load %s\n", job.path.c_str());
+    }
+}
+
+void AssetLoader::decodeSource(asset_job_t &job)
+{
+    switch (job.type)
+    {
+    case ASSET_TEXTURE:
+    {
+        int channels;
+        job.pixels = stbi_load(job.path.c_str(), &job.width, &job.height, &channels, 4);
+        job.ok = (job.pixels != nullptr);
+        break;
+    }
+    case ASSET_MESH:
+        job.ok = (Mesh::build_indexed_obj(job.path, job.vertices, job.indices) == 0);
+        break;
+    }
+}
+
+// copies into the next unpack buffer, the texture then sources from GPU memory
+void AssetLoader::uploadTexture(asset_job_t &job)
+{
+    GLuint buffer = _upload_buffers[_next_upload_buffer];
+    _next_upload_buffer = (_next_upload_buffer + 1) % NUM_UPLOAD_BUFFERS;
+
+    GLsizeiptr size = (GLsizeiptr)job.width * job.height * 4;
+    GLStateCache::get().bindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+    // orphan, a previous upload from this buffer may still be in flight
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    void *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (dst)
+    {
+        memcpy(dst, job.pixels, size);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        job.texture->setImage(job.width, job.height, 4, nullptr);
+    }
+    GLStateCache::get().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (!dst)
+    {
+        // mapping failed, upload straight from client memory
+        job.texture->setImage(job.width, job.height, 4, job.pixels);
+    }
+}
+
+int AssetLoader::update(double budget_ms)
+{
+    double start = glfwGetTime();
+    int done = 0;
+
+    while (true)
+    {
+        asset_job_t *job;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_finished.empty())
+            {
+                break;
+            }
+            job = _finished.front();
+            _finished.pop_front();
+        }
+
+        if (job->ok && job->cooked)
+        {
+            switch (job->type)
+            {
+            case ASSET_TEXTURE:
+                job->ok = job->texture->setCooked(job->cooked_texture, job->cooked->data());
+                break;
+            case ASSET_MESH:
+                job->mesh->setGeometry(*cookedMesh(*job->cooked), job->cooked->data());
+                break;
+            }
+        }
+        else if (job->ok)
+        {
+            switch (job->type)
+            {
+            case ASSET_TEXTURE:
+                uploadTexture(*job);
+                break;
+            case ASSET_MESH:
+                job->mesh->setGeometry(std::move(job->vertices), std::move(job->indices));
+                break;
+            }
+        }
+
+        if (job->ok && job->type == ASSET_TEXTURE)
+        {
+            const Texture2D *texture = job->texture;
+            printf("Asset loader: %s %dx%d %s, %.1f KiB\n", job->path.c_str(), texture->getWidth(), texture->getHeight(),
+                   texture->getFormatName(), texture->getMemoryBytes() / 1024.0);
+        }
+        else if (ASSET_LOADER_DBG)
+        {
+            printf("Asset loader: uploaded %s\n", job->path.c_str());
+        }
+
+        stbi_image_free(job->pixels);
+        delete job;
+        done++;
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _in_flight--;
+        }
+
+        // always make progress, stop once the frame budget is spent
+        if ((glfwGetTime() - start) * 1000.0 > budget_ms)
+        {
+            break;
+        }
+    }
+    return done;
+}
+
+int AssetLoader::getPendingCount() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _in_flight;
+}
+
+bool AssetLoader::isIdle() const
+{
+    return getPendingCount() == 0;
+}
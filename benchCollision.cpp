@@ -0,0 +1,238 @@
+/*
+    Microbenchmark: CollisionWorld::step() with N moving bodies in a tile
+    level, broad phase + tile sweep + actor sweep together.
+
+        benchCollision.exe [ticks]
+
+    Bodies fall, land, stand or walk, hop again at random and run into
+    walls and each other, so the grid always holds a mix of resting piles
+    and movers. The level is wider for more bodies to keep the density the
+    same. Runs without a GL context, the tilemap is never drawn. The broad
+    phase is checked against brute force first, a mismatch exits with 1.
+*/
+
+#include "collision.h"
+#include "memoryArena.h"
+#include "registry.h"
+#include "simdIntegrator.h"
+#include "tilemap.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+static const float TICK_DT = 1.0f / 120.0f;
+static const float TILE_SIZE = 0.05f;
+static const float GRAVITY = -9.81f / 2;
+static const int LEVEL_HEIGHT = 64;
+
+// deterministic across runs and platforms
+static uint32_t rng_state = 1234;
+static float random_range(float lo, float hi)
+{
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return lo + (hi - lo) * ((rng_state >> 8) / 16777216.0f);
+}
+
+static double now_ms()
+{
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+static std::unique_ptr<TileMap> make_level(int width)
+{
+    std::unique_ptr<TileMap> level(new TileMap(width, LEVEL_HEIGHT, TILE_SIZE));
+    level->fill(0, 0, width - 1, 1, 1);
+    level->fill(0, 0, 0, LEVEL_HEIGHT - 1, 1);
+    level->fill(width - 1, 0, width - 1, LEVEL_HEIGHT - 1, 1);
+    for (int x = 8; x < width - 8; x += 12)
+    {
+        int y = 6 + (int)random_range(0.0f, 30.0f);
+        level->fill(x, y, x + 4 + (int)random_range(0.0f, 4.0f), y, 1);
+    }
+    return level;
+}
+
+static bool boxes_overlap(const glm::vec4 &a, const glm::vec4 &b)
+{
+    return a.x <= b.z && b.x <= a.z && a.y <= b.w && b.y <= a.w;
+}
+
+/*
+    SpatialHash against brute force before anything is timed: forEachPair()
+    reports every overlapping pair exactly once, query() every overlapping
+    box once. Tables of one and two buckets force the cells of one body into
+    the same bucket, the default sized table is checked too.
+*/
+static bool check_pairs()
+{
+    rng_state = 99;
+    std::vector<glm::vec4> boxes;
+    for (int i = 0; i < 200; i++)
+    {
+        // a few long bodies spanning many cells among small ones
+        bool large = i % 20 == 0;
+        float x = random_range(0.0f, 2.0f);
+        float y = random_range(0.0f, 1.0f);
+        float w = large ? random_range(0.3f, 0.8f) : random_range(0.01f, 0.08f);
+        float h = large ? random_range(0.2f, 0.5f) : random_range(0.01f, 0.08f);
+        boxes.push_back(glm::vec4(x, y, x + w, y + h));
+    }
+    uint32_t count = (uint32_t)boxes.size();
+
+    SpatialHash hash;
+    std::vector<uint32_t> visits(count * count);
+    std::vector<uint32_t> found;
+    const uint32_t bucket_counts[] = {1, 2, 0};
+    for (uint32_t buckets : bucket_counts)
+    {
+        hash.build(boxes.data(), count, buckets);
+
+        std::fill(visits.begin(), visits.end(), 0);
+        hash.forEachPair([&](uint32_t a, uint32_t b)
+                         { visits[a * count + b]++; });
+        for (uint32_t a = 0; a < count; a++)
+        {
+            for (uint32_t b = 0; b < count; b++)
+            {
+                uint32_t expected = a < b && boxes_overlap(boxes[a], boxes[b]) ? 1 : 0;
+                if (visits[a * count + b] != expected)
+                {
+                    printf("SpatialHash (%u buckets): pair %u %u reported %u times, expected %u\n", buckets, a, b,
+                           visits[a * count + b], expected);
+                    return false;
+                }
+            }
+        }
+
+        for (uint32_t a = 0; a < count; a++)
+        {
+            found.clear();
+            hash.query(boxes[a], found);
+            std::sort(found.begin(), found.end());
+            uint32_t expected = 0;
+            for (uint32_t b = 0; b < count; b++)
+            {
+                expected += boxes_overlap(boxes[a], boxes[b]) ? 1 : 0;
+            }
+            if (found.size() != expected || std::adjacent_find(found.begin(), found.end()) != found.end())
+            {
+                printf("SpatialHash (%u buckets): query of box %u found %zu, expected %u\n", buckets, a, found.size(),
+                       expected);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void run(uint32_t count, int ticks)
+{
+    rng_state = 1234;
+    int width = (int)(count * 2 > 256 ? count * 2 : 256);
+    std::unique_ptr<TileMap> level = make_level(width);
+
+    Registry registry;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        entity_t entity = registry.create();
+        glm::vec2 half(random_range(0.015f, 0.04f), random_range(0.015f, 0.05f));
+        glm::vec3 position(random_range(0.2f, (width - 2) * TILE_SIZE), random_range(0.2f, 3.0f), 0.0f);
+        registry.addTransform(entity, position, half);
+        registry.addVelocity(entity, glm::vec3(random_range(-0.3f, 0.3f), 0.0f, 0.0f), glm::vec3(0.0f, GRAVITY, 0.0f));
+        registry.addCollider(entity, half);
+    }
+
+    CollisionWorld collision;
+    collision.setLevel(level.get());
+
+    transform_pool_t &transforms = registry.getTransforms();
+    velocity_pool_t &velocities = registry.getVelocities();
+    collider_pool_t &colliders = registry.getColliders();
+
+    double total = 0.0, worst = 0.0;
+    uint64_t pairs = 0, actor_contacts = 0, tile_contacts = 0, entries = 0;
+    int warmup = ticks / 10;
+    for (int t = 0; t < warmup + ticks; t++)
+    {
+        std::copy(transforms.x.begin(), transforms.x.end(), transforms.prev_x.begin());
+        std::copy(transforms.y.begin(), transforms.y.end(), transforms.prev_y.begin());
+        integrate_arrays_t arrays{transforms.x.data(), transforms.y.data(), transforms.z.data(),
+                                  velocities.vx.data(), velocities.vy.data(), velocities.vz.data(),
+                                  velocities.ax.data(), velocities.ay.data(), velocities.az.data(),
+                                  transforms.moving_count};
+        integrateBatch(arrays, TICK_DT);
+
+        // one tick per frame here, step() takes its scratch from the frame arena
+        frameArena().reset();
+
+        double start = now_ms();
+        collision.step(registry);
+        double elapsed = now_ms() - start;
+
+        // what movementResolveSystem() does: gravity off on the ground, half
+        // the landings stand and half keep walking, walking off a ledge falls.
+        // Grounded bodies hop now and then
+        for (uint32_t i = 0; i < colliders.set.size(); i++)
+        {
+            uint32_t slot = transforms.set.indexOf(colliders.set.entityAt(i));
+            bool grounded = (colliders.contacts[i] & CONTACT_FLOOR) != 0;
+            if (grounded && random_range(0.0f, 1.0f) < 0.02f)
+            {
+                velocities.vx[slot] = random_range(-0.4f, 0.4f);
+                velocities.vy[slot] = random_range(0.5f, 2.5f);
+                velocities.ay[slot] = GRAVITY;
+            }
+            else if (grounded && velocities.ay[slot] != 0.0f)
+            {
+                velocities.vx[slot] = random_range(0.0f, 1.0f) < 0.5f ? 0.0f : velocities.vx[slot];
+                velocities.vy[slot] = 0.0f;
+                velocities.ay[slot] = 0.0f;
+            }
+            else if (!grounded && velocities.ay[slot] == 0.0f)
+            {
+                velocities.ay[slot] = GRAVITY;
+            }
+        }
+
+        if (t < warmup)
+        {
+            continue;
+        }
+        const collision_stats_t &stats = collision.getStats();
+        total += elapsed;
+        worst = elapsed > worst ? elapsed : worst;
+        pairs += stats.candidate_pairs;
+        actor_contacts += stats.actor_contacts;
+        tile_contacts += stats.tile_contacts;
+        entries += stats.hash_entries;
+    }
+
+    printf("%8u %10.3f %10.3f %10.2f %10.1f %10.1f %10.1f\n", count, total / ticks, worst,
+           (double)entries / ((double)ticks * count), (double)pairs / ticks,
+           (double)actor_contacts / ticks, (double)tile_contacts / ticks);
+}
+
+int main(int argc, char **argv)
+{
+    int ticks = argc > 1 ? atoi(argv[1]) : 600;
+    const uint32_t counts[] = {1000, 5000, 20000};
+
+    if (!check_pairs())
+    {
+        return 1;
+    }
+
+    printf("Collision bench, %d ticks per run, cell size %.3f, tile size %.3f\n", ticks, COLLISION_CELL_SIZE, TILE_SIZE);
+    printf("%8s %10s %10s %10s %10s %10s %10s\n", "bodies", "avg ms", "worst ms", "cells/body", "pairs", "actor hit", "tile hit");
+    for (uint32_t count : counts)
+    {
+        run(count, ticks);
+        levelArena().release(); // the next level is a different size
+    }
+    return 0;
+}
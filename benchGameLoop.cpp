@@ -0,0 +1,744 @@
+/*
+    Headless game loop bench: the update and render path of main.cpp, run
+    without a visible window for a fixed number of frames per scenario.
+
+        benchGameLoop.exe [frames] [output .jsonl] [input script]
+
+    Every frame advances exactly 1/60 s and the input script is replayed
+    through input_character_manager() on the simulated clock, so two runs
+    simulate the same thing and the checksum of the final transforms has
+    to match. Scenarios scale
+    the actor count, the visible tile count (camera zoom), the number of
+    static sprites (through the sprite batch, or instanced in one draw) and
+    the projectiles spawned and expired every frame.
+
+    One JSON object per scenario is appended to the output file (default
+    benchGameLoop.jsonl), the same numbers go to stdout as a table. The
+    modules log on stdout as well, so the file is the one to parse.
+
+    Frame times include a glFinish(), the GPU work is counted in the frame
+    that issued it. Allocations are the C++ heap (operator new) only, the
+    GL driver's own allocations are not seen.
+
+    Context: a hidden GLFW window by default. Built with -DBENCH_EGL it
+    makes a surfaceless EGL context instead (Mesa, no display needed, set
+    LIBGL_ALWAYS_SOFTWARE=1 / GALLIUM_DRIVER=llvmpipe for a software
+    rasterizer) and answers the two GLFW calls of the renderer itself, so
+    GLFW is not linked. Either way everything is drawn into an offscreen FBO.
+*/
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h> // key codes for the input script, the window only without BENCH_EGL
+#ifdef BENCH_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "shader.h"
+#include "shaderManager.h"
+#include "objectCreator.h"
+#include "spriteBatch.h"
+#include "frameUniforms.h"
+#include "glStateCache.h"
+#include "fixedTimestep.h"
+#include "registry.h"
+#include "systems.h"
+#include "tilemap.h"
+#include "collision.h"
+#include "input.h"
+#include "animation.h"
+#include "memoryArena.h"
+#include "parallax.h"
+#include "instancing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+static const int FRAME_WIDTH = 900;
+static const int FRAME_HEIGHT = 900;
+static const double FRAME_DT = 1.0 / 60.0;
+
+// ---- Allocation counting ----
+
+static std::atomic<uint64_t> alloc_count(0);
+static std::atomic<uint64_t> alloc_bytes(0);
+
+void *operator new(size_t size)
+{
+    alloc_count.fetch_add(1, std::memory_order_relaxed);
+    alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    void *p = malloc(size > 0 ? size : 1);
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+// ---- Scenarios ----
+
+struct bench_scenario_t
+{
+    const char *name;
+    uint32_t npcs;  // walking, jumping actors besides the character
+    float zoom;     // Camera2D::zoom, below 1 shows more of the level
+    uint32_t props; // static sprites, no movement or collider
+    uint32_t projectiles; // spawned per frame from an ObjectPool, each lives PROJECTILE_LIFETIME
+    bool instanced;       // props through one InstanceBuffer draw instead of the sprite batch
+};
+
+static const bench_scenario_t scenarios[] = {
+    {"baseline", 0, 1.0f, 0, 0},
+    {"actors_1k", 1000, 1.0f, 0, 0},
+    {"actors_5k", 5000, 1.0f, 0, 0},
+    {"tiles_zoom_0.25", 0, 0.25f, 0, 0},
+    {"tiles_zoom_0.1", 0, 0.1f, 0, 0},
+    {"sprites_10k", 0, 1.0f, 10000, 0},
+    {"sprites_10k_inst", 0, 1.0f, 10000, 0, true},
+    {"mixed", 2000, 0.5f, 5000, 0},
+    {"projectiles", 0, 1.0f, 0, 50},
+};
+
+// seconds, a pool of projectiles * frames per lifetime (plus slack) never runs dry
+static const float PROJECTILE_LIFETIME = 1.0f;
+
+// deterministic across runs and platforms
+static uint32_t rng_state = 1234;
+static float random_range(float lo, float hi)
+{
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return lo + (hi - lo) * ((rng_state >> 8) / 16777216.0f);
+}
+
+// ---- Input script ----
+
+struct script_event_t
+{
+    int frame;
+    int key;    // GLFW_KEY_*
+    int action; // GLFW_PRESS / GLFW_RELEASE
+};
+
+// walk, jump while walking, turn, duck, repeats every 240 frames
+static const char *default_script =
+    "0 RIGHT PRESS\n"
+    "40 UP PRESS\n"
+    "42 UP RELEASE\n"
+    "90 RIGHT RELEASE\n"
+    "100 LEFT PRESS\n"
+    "150 UP PRESS\n"
+    "152 UP RELEASE\n"
+    "190 LEFT RELEASE\n"
+    "200 DOWN PRESS\n"
+    "230 DOWN RELEASE\n";
+static const int default_script_length = 240;
+
+// "<frame> <LEFT|RIGHT|UP|DOWN> <PRESS|RELEASE>" per line, # starts a comment
+static bool parse_script(const std::string &text, std::vector<script_event_t> &events)
+{
+    struct key_name_t
+    {
+        const char *name;
+        int key;
+    };
+    static const key_name_t keys[] = {{"LEFT", GLFW_KEY_LEFT}, {"RIGHT", GLFW_KEY_RIGHT}, {"UP", GLFW_KEY_UP}, {"DOWN", GLFW_KEY_DOWN}};
+
+    size_t start = 0;
+    int line_number = 0;
+    while (start < text.size())
+    {
+        size_t end = text.find('\n', start);
+        std::string line = text.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        start = end == std::string::npos ? text.size() : end + 1;
+        line_number++;
+
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+        {
+            line.resize(comment);
+        }
+        int frame;
+        char key_name[16], action_name[16];
+        int fields = sscanf(line.c_str(), "%d %15s %15s", &frame, key_name, action_name);
+        if (fields <= 0)
+        {
+            continue;
+        }
+
+        script_event_t event{frame, -1, -1};
+        for (const key_name_t &key : keys)
+        {
+            if (fields == 3 && strcmp(key_name, key.name) == 0)
+            {
+                event.key = key.key;
+            }
+        }
+        if (fields == 3)
+        {
+            event.action = strcmp(action_name, "PRESS") == 0 ? GLFW_PRESS : (strcmp(action_name, "RELEASE") == 0 ? GLFW_RELEASE : -1);
+        }
+        if (event.key < 0 || event.action < 0 || frame < 0)
+        {
+            fprintf(stderr, "Input script: bad line %d: %s\n", line_number, line.c_str());
+            return false;
+        }
+        events.push_back(event);
+    }
+
+    std::stable_sort(events.begin(), events.end(), [](const script_event_t &a, const script_event_t &b)
+                     { return a.frame < b.frame; });
+    return true;
+}
+
+static bool load_script(const char *path, std::vector<script_event_t> &events, int &length)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "Input script: could not open %s\n", path);
+        return false;
+    }
+    std::string text;
+    char buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        text.append(buffer, read);
+    }
+    fclose(file);
+
+    if (!parse_script(text, events))
+    {
+        return false;
+    }
+    // a recorded script loops after its last event
+    length = events.empty() ? 1 : events.back().frame + 1;
+    return true;
+}
+
+// ---- Context ----
+
+struct bench_context_t
+{
+#ifdef BENCH_EGL
+    EGLDisplay display;
+    EGLContext context;
+#else
+    GLFWwindow *window;
+#endif
+    GLuint framebuffer;
+    GLuint color;
+    GLuint depth; // the sprite batch depth tests its opaque and alpha tested passes
+};
+
+#ifdef BENCH_EGL
+static bool create_context(bench_context_t &ctx)
+{
+    // surfaceless platform first, no X / Wayland needed, then whatever the default is
+    ctx.display = EGL_NO_DISPLAY;
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (get_platform_display)
+    {
+        ctx.display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (ctx.display == EGL_NO_DISPLAY)
+    {
+        ctx.display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    EGLint major, minor;
+    if (ctx.display == EGL_NO_DISPLAY || !eglInitialize(ctx.display, &major, &minor))
+    {
+        fprintf(stderr, "EGL: no display\n");
+        return false;
+    }
+
+    const EGLint config_attribs[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_SURFACE_TYPE, EGL_DONT_CARE, EGL_NONE};
+    EGLConfig config;
+    EGLint num_configs = 0;
+    if (!eglChooseConfig(ctx.display, config_attribs, &config, 1, &num_configs) || num_configs == 0)
+    {
+        fprintf(stderr, "EGL: no OpenGL config\n");
+        return false;
+    }
+    eglBindAPI(EGL_OPENGL_API);
+
+    const EGLint context_attribs[] = {EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 3,
+                                      EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE};
+    ctx.context = eglCreateContext(ctx.display, config, EGL_NO_CONTEXT, context_attribs);
+    if (ctx.context == EGL_NO_CONTEXT || !eglMakeCurrent(ctx.display, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx.context))
+    {
+        fprintf(stderr, "EGL: could not make a 3.3 core context current\n");
+        return false;
+    }
+    return gladLoadGLLoader((GLADloadproc)eglGetProcAddress);
+}
+
+// the renderer asks GLFW about extensions (SpriteBatch), without GLFW EGL answers
+int glfwExtensionSupported(const char *extension)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        if (strcmp((const char *)glGetStringi(GL_EXTENSIONS, i), extension) == 0)
+        {
+            return GLFW_TRUE;
+        }
+    }
+    return GLFW_FALSE;
+}
+
+GLFWglproc glfwGetProcAddress(const char *name)
+{
+    return (GLFWglproc)eglGetProcAddress(name);
+}
+
+static void destroy_context(bench_context_t &ctx)
+{
+    eglMakeCurrent(ctx.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(ctx.display, ctx.context);
+    eglTerminate(ctx.display);
+}
+#else
+static bool create_context(bench_context_t &ctx)
+{
+    if (!glfwInit())
+    {
+        fprintf(stderr, "GLFW: init failed\n");
+        return false;
+    }
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    ctx.window = glfwCreateWindow(FRAME_WIDTH, FRAME_HEIGHT, "Platformer bench", NULL, NULL);
+    if (!ctx.window)
+    {
+        fprintf(stderr, "GLFW: could not create a hidden window\n");
+        glfwTerminate();
+        return false;
+    }
+    glfwMakeContextCurrent(ctx.window);
+    glfwSwapInterval(0);
+    return gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+}
+
+static void destroy_context(bench_context_t &ctx)
+{
+    glfwDestroyWindow(ctx.window);
+    glfwTerminate();
+}
+#endif
+
+// both paths render here, the default framebuffer is never shown
+static void create_framebuffer(bench_context_t &ctx)
+{
+    glGenRenderbuffers(1, &ctx.color);
+    glBindRenderbuffer(GL_RENDERBUFFER, ctx.color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, FRAME_WIDTH, FRAME_HEIGHT);
+    glGenFramebuffers(1, &ctx.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, ctx.framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, ctx.color);
+    glGenRenderbuffers(1, &ctx.depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, ctx.depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, FRAME_WIDTH, FRAME_HEIGHT);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, ctx.depth);
+    glViewport(0, 0, FRAME_WIDTH, FRAME_HEIGHT);
+}
+
+static void destroy_framebuffer(bench_context_t &ctx)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &ctx.framebuffer);
+    glDeleteRenderbuffers(1, &ctx.color);
+    glDeleteRenderbuffers(1, &ctx.depth);
+}
+
+// ---- Run ----
+
+struct bench_result_t
+{
+    std::vector<double> frame_ms;
+    uint64_t draws, sprites, binds, tiles;
+    uint64_t allocs, bytes;
+    uint32_t checksum;
+};
+
+// FNV-1a over the final positions, equal across runs when the simulation is deterministic
+static uint32_t transform_checksum(Registry &registry)
+{
+    transform_pool_t &transforms = registry.getTransforms();
+    uint32_t hash = 2166136261u;
+    const std::vector<float> *columns[] = {&transforms.x, &transforms.y};
+    for (const std::vector<float> *column : columns)
+    {
+        const unsigned char *bytes = (const unsigned char *)column->data();
+        for (size_t i = 0; i < column->size() * sizeof(float); i++)
+        {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+static double now_ms()
+{
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+static bench_result_t run(const bench_scenario_t &scenario, int frames, const std::vector<script_event_t> &script,
+                          int script_length, Shader &sprite_shader, Shader &sprite_opaque_shader, GLuint white_texture,
+                          ParallaxBackground &background, Shader &parallax_shader, Shader &instanced_shader)
+{
+    rng_state = 1234;
+    button_action_state = LEFTR;
+    input_keys_down = 0;
+    input_queue.clear();
+
+    SpriteBatch sprite_batch;
+    sprite_batch.setVariant(sprite_shader, ALPHA_OPAQUE, sprite_opaque_shader);
+    FrameUniforms frame_uniforms;
+    Camera2D camera;
+    camera.zoom = scenario.zoom;
+    glm::mat4 projection = glm::ortho(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f);
+
+    // spawning below the reserved count never grows a pool column
+    uint32_t projectile_capacity = (uint32_t)(scenario.projectiles * (PROJECTILE_LIFETIME / FRAME_DT + 2.0f));
+    Registry registry;
+    registry.reserve(1 + scenario.npcs + scenario.props + projectile_capacity);
+    Character character(registry);
+
+    // same layout as the fallback level of main.cpp
+    const float tile_size = 0.05f;
+    std::unique_ptr<TileMap> level(new TileMap(4096, 64, tile_size, glm::vec2(-1.0f, -0.25f)));
+    level->fill(0, 0, level->getWidth() - 1, 2, 2);
+    level->fill(0, 3, level->getWidth() - 1, 3, 1);
+    for (int x = 48; x < level->getWidth(); x += 24)
+    {
+        level->fill(x, 8 + x % 5, x + 5, 8 + x % 5, 3);
+    }
+    level->setTileset(white_texture, 8, 8);
+
+    CollisionWorld collision;
+    collision.setLevel(level.get());
+
+    // npcs move like the character (profile 0, the first one added) and share one white clip
+    movement_profile_t profile = registry.getMovementProfile(0);
+    uint16_t npc_profile = registry.addMovementProfile(profile);
+    AnimationLibrary animations;
+    uint16_t white_clip = animations.addClip("white", CLIP_LOOP, {clip_frame_t{TextureRegion{white_texture, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), ALPHA_OPAQUE}, 1.0f, CLIP_EVENT_NONE}});
+    animation_set_t npc_clips;
+    for (int i = 0; i < NUM_MOVEMENT_STATES; i++)
+    {
+        npc_clips.clips[i] = white_clip;
+    }
+    uint16_t npc_animation = registry.addAnimationSet(npc_clips);
+
+    std::vector<entity_t> npcs;
+    for (uint32_t i = 0; i < scenario.npcs; i++)
+    {
+        entity_t npc = registry.create();
+        registry.addTransform(npc, glm::vec3(random_range(-0.95f, 8.0f), random_range(0.0f, 0.8f), 0.0f), glm::vec2(0.05f));
+        registry.addVelocity(npc, glm::vec3(0.0f), glm::vec3(0.0f));
+        registry.addMovement(npc, npc_profile);
+        registry.addSprite(npc, npc_animation, 1);
+        registry.addCollider(npc, glm::vec2(0.03f, 0.05f));
+        npcs.push_back(npc);
+    }
+    // same random sequence either way, the npcs behave the same with and without instancing
+    std::vector<shapes::instance_2d> instanced_props;
+    for (uint32_t i = 0; i < scenario.props; i++)
+    {
+        glm::vec2 half(random_range(0.01f, 0.04f));
+        glm::vec3 position(random_range(-1.0f, 1.0f), random_range(-0.2f, 1.0f), 0.0f);
+        uint8_t layer = (uint8_t)random_range(0.0f, 3.0f);
+        if (scenario.instanced)
+        {
+            instanced_props.push_back(shapes::instance_2d{position.x, position.y, 0.0f, 0.0f, half.x, half.y, 0.0f, 0.0f,
+                                                          glm::vec4(0.0f, 0.0f, 1.0f, 1.0f)});
+            continue;
+        }
+        entity_t prop = registry.create();
+        registry.addTransform(prop, position, half);
+        registry.addSprite(prop, npc_animation, layer);
+    }
+    InstanceBuffer prop_instances(INSTANCE_2D, scenario.props);
+    Uniform<int> instanced_tex = instanced_shader.getUniform<int>("tex");
+
+    // collected like main.cpp does, the npc clip raises none
+    std::vector<animation_event_t> animation_events;
+
+    FixedTimestep timestep(DEFAULT_TICK_RATE);
+    const uint8_t npc_actions[] = {LEFTP, LEFTR, RIGHTP, RIGHTR, UPP, UPR};
+
+    // destroyed before the registry, every live projectile gives its entity back
+    ObjectPool<Projectile> projectiles(projectile_capacity);
+
+    bench_result_t result{};
+    result.frame_ms.reserve(frames);
+    int warmup = frames / 10;
+    size_t next_event = 0;
+    for (int frame = 0; frame < warmup + frames; frame++)
+    {
+        bool measured = frame >= warmup;
+        uint64_t allocs_before = alloc_count.load(std::memory_order_relaxed);
+        uint64_t bytes_before = alloc_bytes.load(std::memory_order_relaxed);
+        double start = now_ms();
+
+        // recorded input, through the same manager as the key callback
+        int script_frame = frame % script_length;
+        if (script_frame == 0)
+        {
+            next_event = 0;
+        }
+        while (next_event < script.size() && script[next_event].frame == script_frame)
+        {
+            input_character_manager(script[next_event].key, script[next_event].action, frame * FRAME_DT);
+            next_event++;
+        }
+
+        GLStateCache::get().resetStats();
+        sprite_batch.resetStats();
+        level->resetStats();
+        frameArena().reset();
+
+        // expired projectiles go back to the pool, this frame's volley comes out of it
+        projectiles.forEach([&](Projectile *projectile)
+                            {
+                                if (!projectile->update(FRAME_DT))
+                                {
+                                    projectiles.release(projectile);
+                                }
+                            });
+        for (uint32_t i = 0; i < scenario.projectiles; i++)
+        {
+            glm::vec3 position(random_range(-1.0f, 1.0f), 0.5f, 0.0f);
+            glm::vec3 velocity(random_range(-0.5f, 0.5f), random_range(0.5f, 1.5f), 0.0f);
+            Projectile *projectile = projectiles.acquire(registry, position, velocity, PROJECTILE_LIFETIME);
+            if (!projectile)
+            {
+                break;
+            }
+            projectile->setScale(glm::vec3(0.01f));
+            projectile->setAcceleration(glm::vec3(0.0f, -9.81f / 2, 0.0f));
+            registry.addSprite(projectile->getEntity(), npc_animation, 2);
+        }
+
+        int ticks = timestep.advance(FRAME_DT);
+        double tick_dt = timestep.getTickDt();
+        double tick_time = (frame + 1) * FRAME_DT - timestep.getAlpha() * tick_dt - ticks * tick_dt;
+        animation_events.clear();
+        for (int i = 0; i < ticks; i++)
+        {
+            tick_time += tick_dt;
+            character.setInput(input_consume_tick(tick_time));
+            // a few npcs change their mind every tick
+            movement_pool_t &movement = registry.getMovement();
+            for (uint32_t n = 0; n < npcs.size() / 32 + 1 && !npcs.empty(); n++)
+            {
+                entity_t npc = npcs[(uint32_t)random_range(0.0f, (float)npcs.size()) % npcs.size()];
+                movement.input[movement.set.indexOf(npc)] = npc_actions[(uint32_t)random_range(0.0f, 6.0f) % 6];
+            }
+            simulationTick(registry, timestep.getTickDt(), &collision, &animations, &animation_events);
+        }
+
+        frame_uniforms.setView(camera.view());
+        frame_uniforms.setProjection(projection);
+        frame_uniforms.setViewport(FRAME_WIDTH, FRAME_HEIGHT);
+        frame_uniforms.setTime(frame * FRAME_DT, FRAME_DT);
+        frame_uniforms.upload();
+
+        glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        background.draw(parallax_shader, camera.visibleRect(projection), frame * FRAME_DT);
+
+        level->draw(sprite_shader, camera.visibleRect(projection));
+
+        // refilled every frame like the batch is, then one draw for all of them
+        if (!instanced_props.empty())
+        {
+            prop_instances.clear();
+            for (const shapes::instance_2d &prop : instanced_props)
+            {
+                prop_instances.push(prop);
+            }
+            prop_instances.upload();
+            instanced_shader.activate();
+            instanced_tex.set(0);
+            GLStateCache::get().bindTexture(GL_TEXTURE_2D, white_texture, 0);
+            Mesh::sharedQuad().drawInstanced(prop_instances);
+        }
+
+        sprite_batch.begin();
+        spriteSystem(registry, sprite_batch, sprite_shader, timestep.getAlpha());
+        sprite_batch.end();
+
+        glFinish();
+        double elapsed = now_ms() - start;
+
+        if (!measured)
+        {
+            continue;
+        }
+        const sprite_batch_stats_t &stats = sprite_batch.getStats();
+        const tilemap_stats_t &level_stats = level->getStats();
+        result.frame_ms.push_back(elapsed);
+        // + 1 for the background triangle
+        result.draws += stats.draws + level_stats.chunks_drawn + 1 + (instanced_props.empty() ? 0 : 1);
+        result.sprites += stats.sprites + prop_instances.getCount();
+        result.tiles += level_stats.tiles_drawn;
+        result.binds += GLStateCache::get().getStats().issued;
+        result.allocs += alloc_count.load(std::memory_order_relaxed) - allocs_before;
+        result.bytes += alloc_bytes.load(std::memory_order_relaxed) - bytes_before;
+    }
+
+    result.checksum = transform_checksum(registry);
+    // the level, batch and registry go away with this scope, while the context is still current
+    return result;
+}
+
+static double percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty())
+    {
+        return 0.0;
+    }
+    size_t index = (size_t)(p * (sorted.size() - 1) + 0.5);
+    return sorted[index < sorted.size() ? index : sorted.size() - 1];
+}
+
+static void report(FILE *json, const bench_scenario_t &scenario, int frames, const bench_result_t &result)
+{
+    std::vector<double> sorted = result.frame_ms;
+    std::sort(sorted.begin(), sorted.end());
+    double total = 0.0;
+    for (double ms : sorted)
+    {
+        total += ms;
+    }
+    double n = sorted.empty() ? 1.0 : (double)sorted.size();
+    double p50 = percentile(sorted, 0.5);
+    double p99 = percentile(sorted, 0.99);
+    double max = sorted.empty() ? 0.0 : sorted.back();
+
+    fprintf(json, "{\"bench\":\"game_loop\",\"scenario\":\"%s\",\"frames\":%d,\"npcs\":%u,\"props\":%u,\"projectiles\":%u,\"instanced\":%s,\"zoom\":%.3f,"
+                  "\"mean_ms\":%.4f,\"p50_ms\":%.4f,\"p99_ms\":%.4f,\"max_ms\":%.4f,"
+                  "\"draws\":%.1f,\"sprites\":%.1f,\"tiles\":%.1f,\"binds\":%.1f,"
+                  "\"allocs_per_frame\":%.2f,\"alloc_bytes_per_frame\":%.1f,\"checksum\":\"%08x\"}\n",
+            scenario.name, frames, scenario.npcs, scenario.props, scenario.projectiles, scenario.instanced ? "true" : "false", scenario.zoom,
+            total / n, p50, p99, max,
+            result.draws / n, result.sprites / n, result.tiles / n, result.binds / n,
+            result.allocs / n, result.bytes / n, result.checksum);
+    fflush(json);
+
+    printf("%-16s %8.3f %8.3f %8.3f %8.1f %8.1f %8.1f %8.2f %08x\n", scenario.name, p50, p99, max,
+           result.draws / n, result.sprites / n, result.tiles / n, result.allocs / n, result.checksum);
+}
+
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 600;
+    frames = frames > 0 ? frames : 600;
+
+    const char *json_path = argc > 2 ? argv[2] : "benchGameLoop.jsonl";
+
+    std::vector<script_event_t> script;
+    int script_length = default_script_length;
+    if (argc > 3 ? !load_script(argv[3], script, script_length) : !parse_script(default_script, script))
+    {
+        return 1;
+    }
+
+    bench_context_t ctx;
+    if (!create_context(ctx))
+    {
+        fprintf(stderr, "Bench: no OpenGL 3.3 context\n");
+        return 1;
+    }
+    fprintf(stderr, "Bench: %s, %s, %d frames per scenario\n",
+            (const char *)glGetString(GL_RENDERER), (const char *)glGetString(GL_VERSION), frames);
+
+    create_framebuffer(ctx);
+
+    // every sprite and tile samples one white texel, the background is the only asset loaded
+    GLuint white_texture;
+    const uint32_t white = 0xFFFFFFFF;
+    glGenTextures(1, &white_texture);
+    GLStateCache::get().bindTexture(GL_TEXTURE_2D, white_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, &white);
+
+    FILE *json = fopen(json_path, "a");
+    if (!json)
+    {
+        fprintf(stderr, "Bench: could not open %s\n", json_path);
+        return 1;
+    }
+
+    // no watcher thread competing with the measured frames
+    ShaderManager::get().setHotReload(false);
+
+    {
+        Shader sprite_shader("_vertex_sprite.vs", "_fragment_sprite.fs");
+        Shader sprite_opaque_shader("_vertex_sprite.vs", "_fragment_sprite.fs", "#define OPAQUE_PASS\n");
+        Shader parallax_shader("_vertex_parallax.vs", "_fragment_parallax.fs");
+        Shader instanced_shader("_vertex_instanced.vs", "_fragment.fs");
+        // the one main.cpp draws, decoded once for all scenarios
+        ParallaxBackground background;
+        if (!background.load("backgrounds/meadow.parallax"))
+        {
+            fprintf(stderr, "Bench: no background, run from the repository root\n");
+            fclose(json);
+            return 1;
+        }
+        std::vector<bench_result_t> results;
+        for (const bench_scenario_t &scenario : scenarios)
+        {
+            fprintf(stderr, "Bench: %s\n", scenario.name);
+            results.push_back(run(scenario, frames, script, script_length, sprite_shader, sprite_opaque_shader, white_texture,
+                                  background, parallax_shader, instanced_shader));
+            // the run's level is gone, its tiles with it
+            levelArena().release();
+        }
+
+        // after the runs, their setup logging would split the table
+        printf("%-16s %8s %8s %8s %8s %8s %8s %8s %8s\n", "scenario", "p50 ms", "p99 ms", "max ms", "draws", "sprites", "tiles", "allocs", "checksum");
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            report(json, scenarios[i], frames, results[i]);
+        }
+    }
+    fclose(json);
+
+    GLStateCache::get().forgetTexture(white_texture);
+    glDeleteTextures(1, &white_texture);
+    destroy_framebuffer(ctx);
+    destroy_context(ctx);
+    return 0;
+}
@@ -0,0 +1,218 @@
+/*
+    Microbenchmark: the old per-object actor update against the SoA batch
+    integrator and ground clamp at every SIMD level this CPU supports. The
+    clamp runs against a per-entity ground column like movementResolveSystem
+    without a CollisionWorld, every eighth entity has none (-FLT_MAX) like a
+    projectile in the moving partition.
+
+        benchIntegrator.exe [ticks]
+
+    The per-object path mirrors the pre-registry Character: one heap object
+    per actor with its physics next to name, matrices, GL handles and
+    animation state, updated through the movement switch with glm::vec3
+    temporaries.
+*/
+
+#include "simdIntegrator.h"
+
+#include <glm/glm.hpp>
+
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+static const float TICK_DT = 1.0f / 120.0f;
+static const float GROUND = 0.0f;
+
+// --------------------------------- Per-object path -------------------------------------
+
+enum legacy_state_t
+{
+    LEGACY_WALK,
+    LEGACY_JUMP,
+    LEGACY_FALL
+};
+
+struct legacy_region_t
+{
+    unsigned int texture;
+    glm::vec4 uv_rect;
+};
+
+struct legacy_actor_t
+{
+    unsigned int VAO, VBO;
+    std::vector<float> model_vertices;
+    glm::vec3 pos;
+    glm::vec3 vel;
+    glm::vec3 acceleration;
+    glm::mat4 scale_mat;
+    std::string name;
+    legacy_state_t state;
+    int walk_phase_index;
+    double frame_timer;
+    legacy_region_t frame_regions[8];
+};
+
+static void legacy_update(legacy_actor_t &a, double dt)
+{
+    switch (a.state)
+    {
+    case LEGACY_WALK:
+        a.pos = a.pos + glm::vec3(a.vel.x * dt, a.vel.y * dt, a.vel.z * dt);
+        break;
+    case LEGACY_JUMP:
+        a.pos = a.pos + glm::vec3(a.vel.x * dt, a.vel.y * dt, a.vel.z * dt);
+        a.vel = a.vel + glm::vec3(a.acceleration.x * dt, a.acceleration.y * dt, a.acceleration.z * dt);
+        if (a.vel.y < 0.0f)
+        {
+            a.state = LEGACY_FALL;
+        }
+        break;
+    case LEGACY_FALL:
+        a.pos = a.pos + glm::vec3(a.vel.x * dt, a.vel.y * dt, a.vel.z * dt);
+        a.vel = a.vel + glm::vec3(a.acceleration.x * dt, a.acceleration.y * dt, a.acceleration.z * dt);
+        if (a.pos.y < GROUND)
+        {
+            a.pos.y = GROUND;
+            a.vel.y = 0.0f;
+            a.state = LEGACY_WALK;
+        }
+        break;
+    }
+}
+
+// ------------------------------------ Setup --------------------------------------------
+
+struct initial_state_t
+{
+    std::vector<float> x, y, z, vx, vy, vz, ax, ay, az;
+    std::vector<float> ground;
+};
+
+static initial_state_t make_initial_state(uint32_t count)
+{
+    initial_state_t s;
+    srand(1234);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        s.x.push_back((rand() % 2000) / 1000.0f - 1.0f);
+        s.y.push_back((rand() % 1000) / 1000.0f);
+        s.z.push_back(0.0f);
+        s.vx.push_back((rand() % 400) / 1000.0f - 0.2f);
+        s.vy.push_back((rand() % 2500) / 1000.0f);
+        s.vz.push_back(0.0f);
+        s.ax.push_back(0.0f);
+        s.ay.push_back(-9.81f / 2);
+        s.az.push_back(0.0f);
+        s.ground.push_back(i % 8 == 7 ? -FLT_MAX : GROUND);
+    }
+    return s;
+}
+
+static double now_ms()
+{
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+static double bench_legacy(const initial_state_t &s, uint32_t count, int ticks)
+{
+    std::vector<std::unique_ptr<legacy_actor_t>> actors;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        actors.emplace_back(new legacy_actor_t());
+        legacy_actor_t &a = *actors.back();
+        a.name = "Character_Actor";
+        a.model_vertices.resize(30);
+        a.pos = glm::vec3(s.x[i], s.y[i], s.z[i]);
+        a.vel = glm::vec3(s.vx[i], s.vy[i], s.vz[i]);
+        a.acceleration = glm::vec3(s.ax[i], s.ay[i], s.az[i]);
+        a.state = LEGACY_JUMP;
+    }
+
+    double start = now_ms();
+    for (int t = 0; t < ticks; t++)
+    {
+        for (auto &actor : actors)
+        {
+            legacy_update(*actor, TICK_DT);
+        }
+    }
+    double elapsed = now_ms() - start;
+
+    // keep the result observable
+    volatile float sink = actors[count / 2]->pos.y;
+    (void)sink;
+    return elapsed;
+}
+
+static double bench_batch(const initial_state_t &s, uint32_t count, int ticks, simd_level_t level, std::vector<float> &out_y)
+{
+    initial_state_t w = s;
+    integrate_arrays_t arrays{w.x.data(), w.y.data(), w.z.data(),
+                              w.vx.data(), w.vy.data(), w.vz.data(),
+                              w.ax.data(), w.ay.data(), w.az.data(), count};
+
+    std::vector<uint8_t> contacts(count);
+
+    double start = now_ms();
+    for (int t = 0; t < ticks; t++)
+    {
+        integrateBatch(arrays, TICK_DT, level);
+        resolveGroundContact(w.y.data(), w.vy.data(), w.ground.data(), contacts.data(), count, level);
+    }
+    double elapsed = now_ms() - start;
+
+    out_y.swap(w.y);
+    return elapsed;
+}
+
+int main(int argc, char **argv)
+{
+    int ticks = argc > 1 ? atoi(argv[1]) : 600;
+    const uint32_t counts[] = {1000, 10000, 50000, 200000};
+    const simd_level_t levels[] = {SIMD_SCALAR, SIMD_SSE2, SIMD_AVX2};
+    simd_level_t best = detectSimdLevel();
+
+    printf("Integrator bench, %d ticks per run, dispatch picks %s\n", ticks, simdLevelName(best));
+    printf("%10s %12s %12s %12s %12s\n", "entities", "per-object", "scalar", "SSE2", "AVX2");
+
+    for (uint32_t count : counts)
+    {
+        initial_state_t s = make_initial_state(count);
+        double legacy = bench_legacy(s, count, ticks);
+        printf("%10u %9.2f ns", count, legacy * 1e6 / ((double)count * ticks));
+
+        std::vector<float> reference;
+        for (simd_level_t level : levels)
+        {
+            if (level > best)
+            {
+                printf(" %12s", "-");
+                continue;
+            }
+
+            std::vector<float> y;
+            double elapsed = bench_batch(s, count, ticks, level, y);
+            printf(" %9.2f ns", elapsed * 1e6 / ((double)count * ticks));
+
+            // every level has to produce the scalar result bit for bit
+            if (level == SIMD_SCALAR)
+            {
+                reference.swap(y);
+            }
+            else if (y != reference)
+            {
+                printf(" (MISMATCH)");
+            }
+        }
+        printf("   per entity and tick\n");
+    }
+    return 0;
+}
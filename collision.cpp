@@ -0,0 +1,549 @@
+#include "collision.h"
+#include "memoryArena.h"
+#include "tilemap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+bool COLLISION_DBG = false;
+
+// std::floor is a libm call without SSE4.1, this runs a dozen times per body
+static inline int32_t floor_to_int(float v)
+{
+    int32_t i = (int32_t)v;
+    return i - (v < (float)i ? 1 : 0);
+}
+
+// ----------------------------------- SpatialHash ---------------------------------------
+
+SpatialHash::SpatialHash(float cell_size)
+    : _boxes(nullptr), _count(0), _bucket_mask(0)
+{
+    setCellSize(cell_size);
+    _bucket_start.assign(2, 0);
+}
+
+void SpatialHash::setCellSize(float cell_size)
+{
+    _cell_size = cell_size;
+    _inv_cell_size = 1.0f / cell_size;
+}
+
+float SpatialHash::getCellSize() const
+{
+    return _cell_size;
+}
+
+SpatialHash::cell_range_t SpatialHash::cellRange(const glm::vec4 &box) const
+{
+    cell_range_t range;
+    range.x0 = floor_to_int(box.x * _inv_cell_size);
+    range.y0 = floor_to_int(box.y * _inv_cell_size);
+    range.x1 = floor_to_int(box.z * _inv_cell_size);
+    range.y1 = floor_to_int(box.w * _inv_cell_size);
+    return range;
+}
+
+uint32_t SpatialHash::bucketOf(int32_t cx, int32_t cy) const
+{
+    return (((uint32_t)cx * 73856093u) ^ ((uint32_t)cy * 19349663u)) & _bucket_mask;
+}
+
+// the entry just before its bucket's current start, or the spare one when !keep
+void SpatialHash::place(const entry_t &entry, uint32_t keep, uint32_t spare)
+{
+    uint32_t &start = _bucket_start[bucketOf(entry.cx, entry.cy)];
+    start -= keep;
+    _entries[keep ? start : spare] = entry;
+}
+
+void SpatialHash::build(const glm::vec4 *boxes, uint32_t count, uint32_t buckets)
+{
+    _boxes = boxes;
+    _count = count;
+    _ranges.resize(count);
+
+    uint32_t entries = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        _ranges[i] = cellRange(boxes[i]);
+        entries += (uint32_t)((_ranges[i].x1 - _ranges[i].x0 + 1) * (_ranges[i].y1 - _ranges[i].y0 + 1));
+    }
+
+    // a bucket or two per entry keeps unrelated cells apart
+    if (buckets == 0 || (buckets & (buckets - 1)) != 0)
+    {
+        buckets = 1;
+        while (buckets < entries)
+        {
+            buckets <<= 1;
+        }
+    }
+    _bucket_mask = buckets - 1;
+    _bucket_start.assign(buckets + 1, 0);
+    _entries.resize(entries + 1);
+    _shared.resize(buckets);
+
+    // counting sort: bucket sizes first, running totals give each bucket's
+    // end, then every cell is hashed again and placed back to front so ids
+    // stay ascending within a bucket. Cheaper than keeping the hashed cells
+    // around, most bodies touch two or three.
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const cell_range_t &r = _ranges[i];
+        if (r.x1 - r.x0 <= 1 && r.y1 - r.y0 <= 1)
+        {
+            // up to 2x2 cells without the loops, how many varies at random
+            // and the branches on it cost more than the hashing
+            uint32_t wide = r.x1 != r.x0 ? 1 : 0;
+            uint32_t tall = r.y1 != r.y0 ? 1 : 0;
+            _bucket_start[bucketOf(r.x0, r.y0)]++;
+            _bucket_start[bucketOf(r.x1, r.y0)] += wide;
+            _bucket_start[bucketOf(r.x0, r.y1)] += tall;
+            _bucket_start[bucketOf(r.x1, r.y1)] += wide & tall;
+            continue;
+        }
+        for (int32_t cy = r.y0; cy <= r.y1; cy++)
+        {
+            for (int32_t cx = r.x0; cx <= r.x1; cx++)
+            {
+                _bucket_start[bucketOf(cx, cy)]++;
+            }
+        }
+    }
+    uint32_t shared = 0, end = 0;
+    for (uint32_t b = 0; b < buckets; b++)
+    {
+        // no branch either, whether a bucket holds a pair is a coin flip
+        uint32_t size = _bucket_start[b];
+        _shared[shared] = b;
+        shared += size > 1 ? 1 : 0;
+        end += size;
+        _bucket_start[b] = end;
+    }
+    _shared.resize(shared);
+    _bucket_start[buckets] = entries;
+    for (uint32_t i = count; i-- > 0;)
+    {
+        const cell_range_t &r = _ranges[i];
+        if (r.x1 - r.x0 <= 1 && r.y1 - r.y0 <= 1)
+        {
+            // corners that repeat another go to the spare entry past the end
+            uint32_t wide = r.x1 != r.x0 ? 1 : 0;
+            uint32_t tall = r.y1 != r.y0 ? 1 : 0;
+            place(entry_t{i, r.x0, r.y0}, 1, entries);
+            place(entry_t{i, r.x1, r.y0}, wide, entries);
+            place(entry_t{i, r.x0, r.y1}, tall, entries);
+            place(entry_t{i, r.x1, r.y1}, wide & tall, entries);
+            continue;
+        }
+        for (int32_t cy = r.y0; cy <= r.y1; cy++)
+        {
+            for (int32_t cx = r.x0; cx <= r.x1; cx++)
+            {
+                place(entry_t{i, cx, cy}, 1, entries);
+            }
+        }
+    }
+}
+
+void SpatialHash::query(const glm::vec4 &rect, std::vector<uint32_t> &out) const
+{
+    cell_range_t r = cellRange(rect);
+    for (int32_t cy = r.y0; cy <= r.y1; cy++)
+    {
+        for (int32_t cx = r.x0; cx <= r.x1; cx++)
+        {
+            uint32_t bucket = bucketOf(cx, cy);
+            for (uint32_t e = _bucket_start[bucket]; e < _bucket_start[bucket + 1]; e++)
+            {
+                // other cells in this bucket, another body's or another of the same body's
+                const entry_t &entry = _entries[e];
+                if (entry.cx != cx || entry.cy != cy)
+                {
+                    continue;
+                }
+                uint32_t id = entry.id;
+                const cell_range_t &rb = _ranges[id];
+                // report from the first cell both share only
+                int32_t first_x = r.x0 > rb.x0 ? r.x0 : rb.x0;
+                int32_t first_y = r.y0 > rb.y0 ? r.y0 : rb.y0;
+                if (first_x != cx || first_y != cy)
+                {
+                    continue;
+                }
+                const glm::vec4 &box = _boxes[id];
+                if (rect.x <= box.z && box.x <= rect.z && rect.y <= box.w && box.y <= rect.w)
+                {
+                    out.push_back(id);
+                }
+            }
+        }
+    }
+}
+
+uint32_t SpatialHash::getEntryCount() const
+{
+    return _bucket_start[_bucket_mask + 1];
+}
+
+// ---------------------------------- Narrow phase ---------------------------------------
+
+/*
+    Swept AABB: box A moves by da, box B by db over one tick. Returns the
+    first time in [0, 1] they touch and the normal of the face A hit,
+    pointing towards A. Boxes overlapping at the start report time 0 and
+    the axis of least penetration.
+*/
+static bool sweep_boxes(glm::vec2 pa, glm::vec2 ha, glm::vec2 da,
+                        glm::vec2 pb, glm::vec2 hb, glm::vec2 db,
+                        float &time, glm::vec2 &normal)
+{
+    glm::vec2 ext = ha + hb;
+    glm::vec2 delta = pa - pb;
+    glm::vec2 motion = da - db;
+
+    if (std::fabs(delta.x) < ext.x && std::fabs(delta.y) < ext.y)
+    {
+        float pen_x = ext.x - std::fabs(delta.x);
+        float pen_y = ext.y - std::fabs(delta.y);
+        normal = pen_x < pen_y ? glm::vec2(delta.x < 0.0f ? -1.0f : 1.0f, 0.0f)
+                               : glm::vec2(0.0f, delta.y < 0.0f ? -1.0f : 1.0f);
+        time = 0.0f;
+        return true;
+    }
+
+    float t_enter = -1.0f, t_exit = 2.0f;
+    glm::vec2 hit_normal(0.0f);
+    for (int k = 0; k < 2; k++)
+    {
+        if (motion[k] == 0.0f)
+        {
+            if (std::fabs(delta[k]) >= ext[k])
+            {
+                return false; // never overlaps on this axis
+            }
+            continue;
+        }
+        float t0 = (-ext[k] - delta[k]) / motion[k];
+        float t1 = (ext[k] - delta[k]) / motion[k];
+        float side = motion[k] > 0.0f ? -1.0f : 1.0f;
+        if (t0 > t1)
+        {
+            float swap = t0;
+            t0 = t1;
+            t1 = swap;
+        }
+        if (t0 > t_enter)
+        {
+            t_enter = t0;
+            hit_normal = glm::vec2(0.0f);
+            hit_normal[k] = side;
+        }
+        t_exit = t1 < t_exit ? t1 : t_exit;
+    }
+
+    if (t_enter > t_exit || t_enter < 0.0f || t_enter > 1.0f)
+    {
+        return false;
+    }
+    time = t_enter;
+    normal = hit_normal;
+    return true;
+}
+
+// raw view of the level, resolveTiles() does a dozen lookups per body.
+// The solid mask rather than ids + flags: bodies are visited in no spatial
+// order and the mask of a wide level still fits in cache.
+struct tile_grid_t
+{
+    const uint64_t *solid_mask;
+    int32_t stride;
+    int32_t width, height;
+    float ox, oy, size, inv_size;
+
+    tile_grid_t(const TileMap &level)
+        : solid_mask(level.getSolidMask()), stride(level.getSolidStride()),
+          width(level.getWidth()), height(level.getHeight()),
+          size(level.getTileSize()), inv_size(1.0f / level.getTileSize())
+    {
+        glm::vec4 first = level.tileRect(0, 0);
+        ox = first.x;
+        oy = first.y;
+    }
+
+    int32_t column(float x) const
+    {
+        return floor_to_int((x - ox) * inv_size);
+    }
+
+    int32_t row(float y) const
+    {
+        return floor_to_int((y - oy) * inv_size);
+    }
+
+    bool solid(int32_t x, int32_t y) const
+    {
+        if (x < 0 || y < 0 || x >= width || y >= height)
+        {
+            return false;
+        }
+        return (solid_mask[(size_t)y * stride + x / 64] >> (x % 64)) & 1;
+    }
+
+    bool solidInColumn(int32_t x, int32_t y0, int32_t y1) const
+    {
+        for (int32_t y = y0; y <= y1; y++)
+        {
+            if (solid(x, y))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool solidInRow(int32_t y, int32_t x0, int32_t x1) const
+    {
+        for (int32_t x = x0; x <= x1; x++)
+        {
+            if (solid(x, y))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// ---------------------------------- CollisionWorld -------------------------------------
+
+CollisionWorld::CollisionWorld(float cell_size)
+    : _level(nullptr), _hash(cell_size), _boxes(nullptr), _transform_of(nullptr), _stats{}
+{
+}
+
+void CollisionWorld::setLevel(const TileMap *level)
+{
+    _level = level;
+}
+
+const TileMap *CollisionWorld::getLevel() const
+{
+    return _level;
+}
+
+void CollisionWorld::step(Registry &registry)
+{
+    collider_pool_t &colliders = registry.getColliders();
+    transform_pool_t &transforms = registry.getTransforms();
+
+    _contacts.clear();
+    _stats = collision_stats_t{};
+
+    uint32_t count = colliders.set.size();
+    _transform_of = frameArena().allocate<uint32_t>(count);
+    _boxes = frameArena().allocate<glm::vec4>(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        _transform_of[i] = transforms.set.indexOf(colliders.set.entityAt(i));
+    }
+    _stats.bodies = count;
+
+    // resolveTiles() replaces the flags itself, it reads last tick's floor bit first
+    if (_level)
+    {
+        resolveTiles(registry);
+    }
+    else
+    {
+        std::fill(colliders.contacts.begin(), colliders.contacts.end(), 0);
+    }
+    collideActors(registry);
+
+    if (COLLISION_DBG)
+    {
+        printf("collision: %u bodies, %u pairs, %u actor / %u tile contacts\n",
+               _stats.bodies, _stats.candidate_pairs, _stats.actor_contacts, _stats.tile_contacts);
+    }
+}
+
+/*
+    Move and slide through the tile grid, x first, then y at the resolved x.
+    Each axis scans the tile columns (rows) the leading edge enters and stops
+    at the first one with a solid tile in the body's span. The column the
+    edge starts in is the body's own and is not scanned, so a body moving
+    inside one tile costs no lookups at all. skin keeps faces that only touch
+    from counting as overlap.
+*/
+void CollisionWorld::resolveTiles(Registry &registry)
+{
+    collider_pool_t &colliders = registry.getColliders();
+    transform_pool_t &transforms = registry.getTransforms();
+    velocity_pool_t &velocities = registry.getVelocities();
+
+    const tile_grid_t grid(*_level);
+    float skin = grid.size * 1e-3f;
+
+    uint32_t count = colliders.set.size();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t slot = _transform_of[i];
+        if (slot >= transforms.moving_count)
+        {
+            colliders.contacts[i] = 0;
+            continue; // static bodies only meet tiles through level design
+        }
+        float hw = colliders.half_w[i];
+        float hh = colliders.half_h[i];
+        float x = transforms.prev_x[slot];
+        float y = transforms.prev_y[slot];
+        float dx = transforms.x[slot] - x;
+        float dy = transforms.y[slot] - y;
+
+        // standing still where it stood on the floor last tick, the tiles under it haven't moved
+        if (dx == 0.0f && dy == 0.0f && (colliders.contacts[i] & CONTACT_FLOOR) && velocities.vy[slot] <= 0.0f)
+        {
+            colliders.contacts[i] = CONTACT_FLOOR;
+            continue;
+        }
+        uint8_t flags = 0;
+
+        // ---- x ----
+        if (dx != 0.0f)
+        {
+            float edge = dx > 0.0f ? x + hw : x - hw;
+            int32_t step = dx > 0.0f ? 1 : -1;
+            int32_t column = grid.column(edge - step * skin) + step;
+            int32_t last = grid.column(edge + dx);
+            float new_x = x + dx;
+            if ((last - column) * step >= 0)
+            {
+                int32_t row0 = grid.row(y - hh + skin);
+                int32_t row1 = grid.row(y + hh - skin);
+                for (; (last - column) * step >= 0; column += step)
+                {
+                    if (grid.solidInColumn(column, row0, row1))
+                    {
+                        float wall = grid.ox + (dx > 0.0f ? column : column + 1) * grid.size;
+                        new_x = dx > 0.0f ? wall - hw : wall + hw;
+                        velocities.vx[slot] = 0.0f;
+                        flags |= dx > 0.0f ? CONTACT_WALL_RIGHT : CONTACT_WALL_LEFT;
+
+                        float time = (wall - edge) / dx;
+                        time = time < 0.0f ? 0.0f : (time > 1.0f ? 1.0f : time);
+                        _contacts.push_back({colliders.set.entityAt(i), NULL_ENTITY, glm::vec2(-(float)step, 0.0f), time});
+                        _stats.tile_contacts++;
+                        break;
+                    }
+                }
+            }
+            x = new_x;
+        }
+
+        // ---- y ----
+        int32_t col0 = grid.column(x - hw + skin);
+        int32_t col1 = grid.column(x + hw - skin);
+        if (dy != 0.0f)
+        {
+            float edge = dy > 0.0f ? y + hh : y - hh;
+            int32_t step = dy > 0.0f ? 1 : -1;
+            int32_t row = grid.row(edge - step * skin) + step;
+            int32_t last = grid.row(edge + dy);
+            float new_y = y + dy;
+            for (; (last - row) * step >= 0; row += step)
+            {
+                if (grid.solidInRow(row, col0, col1))
+                {
+                    float face = grid.oy + (dy > 0.0f ? row : row + 1) * grid.size;
+                    new_y = dy > 0.0f ? face - hh : face + hh;
+                    velocities.vy[slot] = 0.0f;
+                    flags |= dy > 0.0f ? CONTACT_CEILING : CONTACT_FLOOR;
+
+                    float time = (face - edge) / dy;
+                    time = time < 0.0f ? 0.0f : (time > 1.0f ? 1.0f : time);
+                    _contacts.push_back({colliders.set.entityAt(i), NULL_ENTITY, glm::vec2(0.0f, -(float)step), time});
+                    _stats.tile_contacts++;
+                    break;
+                }
+            }
+            y = new_y;
+        }
+
+        // resting on the ground is a floor contact too, just not an event
+        if (!(flags & CONTACT_FLOOR) && velocities.vy[slot] <= 0.0f)
+        {
+            if (grid.solidInRow(grid.row(y - hh - skin), col0, col1))
+            {
+                flags |= CONTACT_FLOOR;
+            }
+        }
+
+        transforms.x[slot] = x;
+        transforms.y[slot] = y;
+        colliders.contacts[i] = flags;
+    }
+}
+
+void CollisionWorld::collideActors(Registry &registry)
+{
+    collider_pool_t &colliders = registry.getColliders();
+    transform_pool_t &transforms = registry.getTransforms();
+
+    uint32_t count = colliders.set.size();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t slot = _transform_of[i];
+        float hw = colliders.half_w[i];
+        float hh = colliders.half_h[i];
+        float x0 = transforms.prev_x[slot], x1 = transforms.x[slot];
+        float y0 = transforms.prev_y[slot], y1 = transforms.y[slot];
+        _boxes[i] = glm::vec4((x0 < x1 ? x0 : x1) - hw, (y0 < y1 ? y0 : y1) - hh,
+                              (x0 > x1 ? x0 : x1) + hw, (y0 > y1 ? y0 : y1) + hh);
+    }
+
+    _hash.build(_boxes, count);
+    _stats.hash_entries = _hash.getEntryCount();
+
+    _hash.forEachPair([&](uint32_t a, uint32_t b)
+                      {
+        _stats.candidate_pairs++;
+        if (!(colliders.layer[a] & colliders.mask[b]) || !(colliders.layer[b] & colliders.mask[a]))
+        {
+            return;
+        }
+
+        uint32_t sa = _transform_of[a];
+        uint32_t sb = _transform_of[b];
+        glm::vec2 pa(transforms.prev_x[sa], transforms.prev_y[sa]);
+        glm::vec2 pb(transforms.prev_x[sb], transforms.prev_y[sb]);
+        glm::vec2 da(transforms.x[sa] - pa.x, transforms.y[sa] - pa.y);
+        glm::vec2 db(transforms.x[sb] - pb.x, transforms.y[sb] - pb.y);
+
+        float time;
+        glm::vec2 normal;
+        if (!sweep_boxes(pa, glm::vec2(colliders.half_w[a], colliders.half_h[a]), da,
+                         pb, glm::vec2(colliders.half_w[b], colliders.half_h[b]), db, time, normal))
+        {
+            return;
+        }
+
+        entity_t ea = colliders.set.entityAt(a);
+        entity_t eb = colliders.set.entityAt(b);
+        _contacts.push_back({ea, eb, normal, time});
+        _contacts.push_back({eb, ea, -normal, time});
+        colliders.contacts[a] |= CONTACT_ACTOR;
+        colliders.contacts[b] |= CONTACT_ACTOR;
+        _stats.actor_contacts++; });
+}
+
+const std::vector<contact_event_t> &CollisionWorld::getContacts() const
+{
+    return _contacts;
+}
+
+const collision_stats_t &CollisionWorld::getStats() const
+{
+    return _stats;
+}
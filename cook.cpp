@@ -0,0 +1,139 @@
+/*
+    Offline asset cook: .obj -> .gmesh (welded, cache ordered), .png -> .gtex
+    (full mip chain). Outputs land next to their sources, AssetLoader picks
+    them up through preferCooked(). Up to date outputs are skipped.
+
+    --bc block compresses the textures of the following arguments, BC1 when
+    opaque and BC3 otherwise, a quarter / half of the RGBA8 size. Meant for
+    painted art, pixel art keeps its exact texels without it.
+
+        cook.exe [--bc] <file or directory> ...
+*/
+
+#include "cookedAsset.h"
+#include "objectCreator.h"
+#include "stb/stb_image.h"
+
+#include <cstdio>
+#include <filesystem>
+
+static bool is_up_to_date(const std::filesystem::path &source, const std::filesystem::path &cooked)
+{
+    std::error_code ec;
+    auto cooked_time = std::filesystem::last_write_time(cooked, ec);
+    if (ec)
+    {
+        return false;
+    }
+    return std::filesystem::last_write_time(source, ec) <= cooked_time && !ec;
+}
+
+static bool cook_mesh(const std::string &source, const std::string &cooked)
+{
+    std::vector<shapes::vertex> vertices;
+    std::vector<uint32_t> indices;
+    if (Mesh::build_indexed_obj(source, vertices, indices) != 0)
+    {
+        printf("Cook: failed to parse %s\n", source.c_str());
+        return false;
+    }
+    return writeCookedMesh(cooked, vertices, indices);
+}
+
+static bool cook_texture(const std::string &source, const std::string &cooked, bool compress)
+{
+    int width, height, channels;
+    unsigned char *pixels = stbi_load(source.c_str(), &width, &height, &channels, 0);
+    if (!pixels)
+    {
+        printf("Cook: failed to decode %s\n", source.c_str());
+        return false;
+    }
+
+    // grey / grey+alpha sources are expanded, the runtime only knows RGB and RGBA
+    if (channels < 3)
+    {
+        stbi_image_free(pixels);
+        channels = (channels == 2) ? 4 : 3;
+        int file_channels;
+        pixels = stbi_load(source.c_str(), &width, &height, &file_channels, channels);
+        if (!pixels)
+        {
+            return false;
+        }
+    }
+
+    bool ok = writeCookedTexture(cooked, width, height, channels, pixels, compress);
+    stbi_image_free(pixels);
+    return ok;
+}
+
+// returns false only on a failed cook, unsupported files are ignored
+static bool cook_file(const std::filesystem::path &source, bool compress, int &cooked_count, int &skipped_count)
+{
+    std::string cooked = cookedPathFor(source.string());
+    if (cooked.empty())
+    {
+        return true;
+    }
+    if (is_up_to_date(source, cooked))
+    {
+        skipped_count++;
+        return true;
+    }
+
+    bool ok = source.extension() == ".obj" ? cook_mesh(source.string(), cooked)
+                                           : cook_texture(source.string(), cooked, compress);
+    if (ok)
+    {
+        printf("Cooked %s -> %s\n", source.string().c_str(), cooked.c_str());
+        cooked_count++;
+    }
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("usage: %s [--bc] <file or directory> ...\n", argv[0]);
+        return 1;
+    }
+
+    // same orientation as Texture2D, bottom row first
+    stbi_set_flip_vertically_on_load(true);
+
+    int cooked_count = 0;
+    int skipped_count = 0;
+    int failed_count = 0;
+    bool compress = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string(argv[i]) == "--bc")
+        {
+            compress = true;
+            continue;
+        }
+
+        std::filesystem::path input(argv[i]);
+        std::error_code ec;
+        if (std::filesystem::is_directory(input, ec))
+        {
+            for (const auto &entry : std::filesystem::recursive_directory_iterator(input, ec))
+            {
+                if (entry.is_regular_file() && !cook_file(entry.path(), compress, cooked_count, skipped_count))
+                {
+                    failed_count++;
+                }
+            }
+        }
+        else if (!cook_file(input, compress, cooked_count, skipped_count))
+        {
+            failed_count++;
+        }
+    }
+
+    printf("Cook: %d cooked, %d up to date, %d failed\n", cooked_count, skipped_count, failed_count);
+    return failed_count ? 1 : 0;
+}
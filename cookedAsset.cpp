@@ -0,0 +1,694 @@
+#include "cookedAsset.h"
+#include "textureCompression.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool COOKED_ASSET_DBG = false;
+
+// ----------------------------------- MappedFile ----------------------------------------
+
+MappedFile::MappedFile()
+    : _data(nullptr), _size(0)
+#ifdef _WIN32
+      ,
+      _file(nullptr), _mapping(nullptr)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string &path)
+{
+    close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    _file = file;
+    _mapping = mapping;
+    _data = (const unsigned char *)view;
+    _size = (size_t)size.QuadPart;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (_data)
+    {
+        UnmapViewOfFile(_data);
+        CloseHandle((HANDLE)_mapping);
+        CloseHandle((HANDLE)_file);
+    }
+    _data = nullptr;
+    _size = 0;
+    _file = nullptr;
+    _mapping = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const std::string &path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void *view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps its own reference to the file
+    ::close(fd);
+    if (view == MAP_FAILED)
+    {
+        return false;
+    }
+
+    // everything gets uploaded right away, start the page-in now
+    madvise(view, (size_t)st.st_size, MADV_WILLNEED);
+
+    _data = (const unsigned char *)view;
+    _size = (size_t)st.st_size;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (_data)
+    {
+        munmap((void *)_data, _size);
+    }
+    _data = nullptr;
+    _size = 0;
+}
+
+#endif
+
+const unsigned char *MappedFile::data() const
+{
+    return _data;
+}
+
+size_t MappedFile::size() const
+{
+    return _size;
+}
+
+// ------------------------------------- Paths -------------------------------------------
+
+static bool ends_with(const std::string &s, const char *suffix)
+{
+    size_t n = strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+bool isCookedPath(const std::string &path)
+{
+    return ends_with(path, COOKED_MESH_EXT) || ends_with(path, COOKED_TEXTURE_EXT) ||
+           ends_with(path, DDS_TEXTURE_EXT) || ends_with(path, KTX2_TEXTURE_EXT);
+}
+
+std::string cookedPathFor(const std::string &source_path)
+{
+    std::filesystem::path path(source_path);
+    std::string ext = path.extension().string();
+    if (ext == ".obj")
+    {
+        return path.replace_extension(COOKED_MESH_EXT).string();
+    }
+    if (ext == ".png")
+    {
+        return path.replace_extension(COOKED_TEXTURE_EXT).string();
+    }
+    return std::string();
+}
+
+std::string preferCooked(const std::string &source_path)
+{
+    std::string cooked = cookedPathFor(source_path);
+    if (cooked.empty())
+    {
+        return source_path;
+    }
+
+    std::error_code ec;
+    auto cooked_time = std::filesystem::last_write_time(cooked, ec);
+    if (ec)
+    {
+        return source_path;
+    }
+    auto source_time = std::filesystem::last_write_time(source_path, ec);
+    if (!ec && source_time > cooked_time)
+    {
+        printf("Cooked asset %s is stale, loading the source.\n", cooked.c_str());
+        return source_path;
+    }
+    return cooked;
+}
+
+// ------------------------------------ Reading ------------------------------------------
+
+static const cooked_header_t *check_header(const MappedFile &file, cooked_type_t type, size_t body_size)
+{
+    if (!file.data() || file.size() < sizeof(cooked_header_t) + body_size)
+    {
+        return nullptr;
+    }
+
+    const cooked_header_t *header = (const cooked_header_t *)file.data();
+    if (header->magic != COOKED_MAGIC || header->version != COOKED_VERSION ||
+        header->type != type || header->file_size != file.size())
+    {
+        printf("Cooked asset: bad header (magic %08x, version %u, type %u)\n",
+               header->magic, header->version, header->type);
+        return nullptr;
+    }
+    return header;
+}
+
+static bool in_bounds(const MappedFile &file, uint64_t offset, uint64_t size)
+{
+    return offset + size <= file.size();
+}
+
+static bool valid_size(uint32_t width, uint32_t height)
+{
+    return width > 0 && height > 0 && width <= COOKED_MAX_SIZE && height <= COOKED_MAX_SIZE;
+}
+
+// bytes of one level as stored: whole blocks, or rows padded to 4 like the cook writes them
+static uint64_t level_size(uint32_t format, uint32_t width, uint32_t height)
+{
+    if (blockBytes(format))
+    {
+        return compressedLevelSize(format, width, height);
+    }
+    uint64_t row = (uint64_t)width * (format == COOKED_RGBA8 ? 4 : 3);
+    return ((row + 3) & ~(uint64_t)3) * height;
+}
+
+const cooked_mesh_t *cookedMesh(const MappedFile &file)
+{
+    if (!check_header(file, COOKED_MESH, sizeof(cooked_mesh_t)))
+    {
+        return nullptr;
+    }
+
+    const cooked_mesh_t *mesh = (const cooked_mesh_t *)(file.data() + sizeof(cooked_header_t));
+    if ((mesh->index_size != 2 && mesh->index_size != 4) ||
+        !in_bounds(file, mesh->vertex_offset, (uint64_t)mesh->vertex_count * sizeof(shapes::vertex)) ||
+        !in_bounds(file, mesh->index_offset, (uint64_t)mesh->index_count * mesh->index_size))
+    {
+        printf("Cooked asset: mesh blobs out of bounds\n");
+        return nullptr;
+    }
+    return mesh;
+}
+
+const cooked_texture_t *cookedTexture(const MappedFile &file)
+{
+    if (!check_header(file, COOKED_TEXTURE, sizeof(cooked_texture_t)))
+    {
+        return nullptr;
+    }
+
+    const cooked_texture_t *texture = (const cooked_texture_t *)(file.data() + sizeof(cooked_header_t));
+    if (texture->mip_count == 0 || texture->mip_count > COOKED_MAX_MIPS)
+    {
+        printf("Cooked asset: bad mip count %u\n", texture->mip_count);
+        return nullptr;
+    }
+    if (texture->format < COOKED_RGB8 || texture->format > COOKED_BC7)
+    {
+        printf("Cooked asset: unknown pixel format %u\n", texture->format);
+        return nullptr;
+    }
+    if (!valid_size(texture->width, texture->height))
+    {
+        printf("Cooked asset: bad texture size %ux%u\n", texture->width, texture->height);
+        return nullptr;
+    }
+    for (uint32_t i = 0; i < texture->mip_count; i++)
+    {
+        // the upload reads the whole level from the mapping, a short one would read past it
+        const cooked_mip_t &mip = texture->mips[i];
+        if (!valid_size(mip.width, mip.height) || mip.size < level_size(texture->format, mip.width, mip.height) ||
+            !in_bounds(file, mip.offset, mip.size))
+        {
+            printf("Cooked asset: mip %u out of bounds\n", i);
+            return nullptr;
+        }
+    }
+    return texture;
+}
+
+// ------------------------------- DDS / KTX2 textures -----------------------------------
+
+#define DDS_MAGIC 0x20534444u // "DDS "
+#define DDS_FOURCC(a, b, c, d) ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+struct dds_header_t
+{
+    uint32_t size; // 124
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitch_or_linear_size;
+    uint32_t depth;
+    uint32_t mip_count;
+    uint32_t reserved1[11];
+    uint32_t pf_size;
+    uint32_t pf_flags;
+    uint32_t pf_fourcc;
+    uint32_t pf_bits[5];
+    uint32_t caps[4];
+    uint32_t reserved2;
+};
+
+struct dds_header_dx10_t
+{
+    uint32_t dxgi_format;
+    uint32_t dimension;
+    uint32_t misc_flags;
+    uint32_t array_size;
+    uint32_t misc_flags2;
+};
+
+struct ktx2_header_t
+{
+    unsigned char identifier[12];
+    uint32_t vk_format;
+    uint32_t type_size;
+    uint32_t width;
+    uint32_t height;
+    uint32_t depth;
+    uint32_t layer_count;
+    uint32_t face_count;
+    uint32_t level_count;
+    uint32_t supercompression;
+    uint32_t dfd_offset, dfd_length, kvd_offset, kvd_length;
+    uint64_t sgd_offset, sgd_length;
+};
+
+struct ktx2_level_t
+{
+    uint64_t offset;
+    uint64_t length;
+    uint64_t uncompressed_length;
+};
+
+static const unsigned char KTX2_IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+static uint32_t dds_format(const dds_header_t &header, const dds_header_dx10_t *dx10)
+{
+    if (dx10)
+    {
+        switch (dx10->dxgi_format)
+        {
+        case 71: // BC1_UNORM
+        case 72: // BC1_UNORM_SRGB
+            return COOKED_BC1;
+        case 77: // BC3_UNORM
+        case 78:
+            return COOKED_BC3;
+        case 98: // BC7_UNORM
+        case 99:
+            return COOKED_BC7;
+        }
+        return 0;
+    }
+    switch (header.pf_fourcc)
+    {
+    case DDS_FOURCC('D', 'X', 'T', '1'):
+        return COOKED_BC1;
+    case DDS_FOURCC('D', 'X', 'T', '5'):
+        return COOKED_BC3;
+    }
+    return 0;
+}
+
+static uint32_t ktx2_format(uint32_t vk_format)
+{
+    switch (vk_format)
+    {
+    case 131: // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+    case 132:
+    case 133: // VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+    case 134:
+        return COOKED_BC1;
+    case 137: // VK_FORMAT_BC3_UNORM_BLOCK
+    case 138:
+        return COOKED_BC3;
+    case 145: // VK_FORMAT_BC7_UNORM_BLOCK
+    case 146:
+        return COOKED_BC7;
+    }
+    return 0;
+}
+
+// levels follow the headers back to back, largest first
+static bool read_dds(const MappedFile &file, cooked_texture_t &texture)
+{
+    if (file.size() < 4 + sizeof(dds_header_t))
+    {
+        return false;
+    }
+    const dds_header_t &header = *(const dds_header_t *)(file.data() + 4);
+    size_t offset = 4 + sizeof(dds_header_t);
+
+    const dds_header_dx10_t *dx10 = nullptr;
+    if (header.pf_fourcc == DDS_FOURCC('D', 'X', '1', '0'))
+    {
+        if (file.size() < offset + sizeof(dds_header_dx10_t))
+        {
+            return false;
+        }
+        dx10 = (const dds_header_dx10_t *)(file.data() + offset);
+        offset += sizeof(dds_header_dx10_t);
+    }
+
+    texture.format = dds_format(header, dx10);
+    if (header.size != 124 || !texture.format || (dx10 && dx10->array_size > 1))
+    {
+        printf("DDS: unsupported layout or format (fourcc %08x)\n", header.pf_fourcc);
+        return false;
+    }
+
+    if (!valid_size(header.width, header.height))
+    {
+        printf("DDS: bad texture size %ux%u\n", header.width, header.height);
+        return false;
+    }
+    texture.width = header.width;
+    texture.height = header.height;
+    uint32_t levels = header.mip_count ? header.mip_count : 1;
+    texture.mip_count = levels < COOKED_MAX_MIPS ? levels : COOKED_MAX_MIPS;
+    for (uint32_t i = 0; i < texture.mip_count; i++)
+    {
+        cooked_mip_t &mip = texture.mips[i];
+        mip.width = texture.width >> i ? texture.width >> i : 1;
+        mip.height = texture.height >> i ? texture.height >> i : 1;
+        mip.size = compressedLevelSize(texture.format, mip.width, mip.height);
+        mip.offset = (uint32_t)offset;
+        if (!in_bounds(file, mip.offset, mip.size))
+        {
+            printf("DDS: mip %u out of bounds\n", i);
+            return false;
+        }
+        offset += mip.size;
+    }
+    return true;
+}
+
+static bool read_ktx2(const MappedFile &file, cooked_texture_t &texture)
+{
+    if (file.size() < sizeof(ktx2_header_t))
+    {
+        return false;
+    }
+    const ktx2_header_t &header = *(const ktx2_header_t *)file.data();
+
+    texture.format = ktx2_format(header.vk_format);
+    if (!texture.format || header.supercompression != 0 || header.depth > 1 || header.layer_count > 1 || header.face_count != 1)
+    {
+        printf("KTX2: unsupported layout or format (vkFormat %u, supercompression %u)\n", header.vk_format, header.supercompression);
+        return false;
+    }
+
+    if (!valid_size(header.width, header.height))
+    {
+        printf("KTX2: bad texture size %ux%u\n", header.width, header.height);
+        return false;
+    }
+    texture.width = header.width;
+    texture.height = header.height;
+    uint32_t levels = header.level_count ? header.level_count : 1;
+    if (!in_bounds(file, sizeof(ktx2_header_t), (uint64_t)levels * sizeof(ktx2_level_t)))
+    {
+        return false;
+    }
+    const ktx2_level_t *index = (const ktx2_level_t *)(file.data() + sizeof(ktx2_header_t));
+
+    texture.mip_count = levels < COOKED_MAX_MIPS ? levels : COOKED_MAX_MIPS;
+    for (uint32_t i = 0; i < texture.mip_count; i++)
+    {
+        cooked_mip_t &mip = texture.mips[i];
+        mip.width = texture.width >> i ? texture.width >> i : 1;
+        mip.height = texture.height >> i ? texture.height >> i : 1;
+        mip.size = compressedLevelSize(texture.format, mip.width, mip.height);
+        mip.offset = (uint32_t)index[i].offset;
+        if (index[i].length < mip.size || !in_bounds(file, index[i].offset, mip.size))
+        {
+            printf("KTX2: mip %u out of bounds\n", i);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool readTextureContainer(const MappedFile &file, cooked_texture_t &texture)
+{
+    if (!file.data() || file.size() < 16)
+    {
+        return false;
+    }
+
+    texture = cooked_texture_t{};
+    if (memcmp(file.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0)
+    {
+        return read_ktx2(file, texture);
+    }
+    if (*(const uint32_t *)file.data() == DDS_MAGIC)
+    {
+        return read_dds(file, texture);
+    }
+
+    const cooked_texture_t *cooked = cookedTexture(file);
+    if (cooked)
+    {
+        texture = *cooked;
+    }
+    return cooked != nullptr;
+}
+
+// ------------------------------------ Writing ------------------------------------------
+
+static uint32_t align_up(size_t offset)
+{
+    return (uint32_t)((offset + COOKED_ALIGNMENT - 1) & ~(size_t)(COOKED_ALIGNMENT - 1));
+}
+
+// blob goes to the aligned end of the buffer, returns its offset
+static uint32_t append_blob(std::vector<unsigned char> &out, const void *data, size_t size)
+{
+    uint32_t offset = align_up(out.size());
+    out.resize(offset + size, 0);
+    if (size)
+    {
+        memcpy(out.data() + offset, data, size);
+    }
+    return offset;
+}
+
+static bool write_file(const std::string &path, std::vector<unsigned char> &out, cooked_type_t type)
+{
+    cooked_header_t header{COOKED_MAGIC, COOKED_VERSION, (uint32_t)type, (uint32_t)out.size()};
+    memcpy(out.data(), &header, sizeof(header));
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file)
+    {
+        printf("Cook: could not open %s for writing\n", path.c_str());
+        return false;
+    }
+    bool ok = fwrite(out.data(), 1, out.size(), file) == out.size();
+    ok = (fclose(file) == 0) && ok;
+    if (!ok)
+    {
+        printf("Cook: failed writing %s\n", path.c_str());
+    }
+    return ok;
+}
+
+bool writeCookedMesh(const std::string &path, const std::vector<shapes::vertex> &vertices, const std::vector<uint32_t> &indices)
+{
+    std::vector<unsigned char> out(sizeof(cooked_header_t) + sizeof(cooked_mesh_t), 0);
+
+    cooked_mesh_t mesh{};
+    mesh.vertex_count = (uint32_t)vertices.size();
+    mesh.index_count = (uint32_t)indices.size();
+    mesh.index_size = vertices.size() <= 0xFFFF ? 2 : 4;
+    mesh.vertex_offset = append_blob(out, vertices.data(), vertices.size() * sizeof(shapes::vertex));
+
+    if (mesh.index_size == 2)
+    {
+        std::vector<uint16_t> short_indices(indices.begin(), indices.end());
+        mesh.index_offset = append_blob(out, short_indices.data(), short_indices.size() * sizeof(uint16_t));
+    }
+    else
+    {
+        mesh.index_offset = append_blob(out, indices.data(), indices.size() * sizeof(uint32_t));
+    }
+
+    memcpy(out.data() + sizeof(cooked_header_t), &mesh, sizeof(mesh));
+    return write_file(path, out, COOKED_MESH);
+}
+
+// 2x2 box filter, odd edges reuse the last row / column
+static void downsample(const unsigned char *src, int width, int height, int channels,
+                       unsigned char *dst, int dst_width, int dst_height)
+{
+    for (int y = 0; y < dst_height; y++)
+    {
+        int y0 = 2 * y;
+        int y1 = (2 * y + 1 < height) ? 2 * y + 1 : y0;
+        for (int x = 0; x < dst_width; x++)
+        {
+            int x0 = 2 * x;
+            int x1 = (2 * x + 1 < width) ? 2 * x + 1 : x0;
+            for (int c = 0; c < channels; c++)
+            {
+                int sum = src[(y0 * width + x0) * channels + c] + src[(y0 * width + x1) * channels + c] +
+                          src[(y1 * width + x0) * channels + c] + src[(y1 * width + x1) * channels + c];
+                dst[(y * dst_width + x) * channels + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+bool writeCookedTexture(const std::string &path, int width, int height, int channels, const unsigned char *pixels,
+                        bool compress)
+{
+    if (channels != 3 && channels != 4)
+    {
+        printf("Cook: %s has %d channels, expected 3 or 4\n", path.c_str(), channels);
+        return false;
+    }
+    if (!valid_size((uint32_t)width, (uint32_t)height))
+    {
+        printf("Cook: %s is %dx%d, the limit is %d\n", path.c_str(), width, height, COOKED_MAX_SIZE);
+        return false;
+    }
+
+    std::vector<unsigned char> out(sizeof(cooked_header_t) + sizeof(cooked_texture_t), 0);
+
+    cooked_texture_t texture{};
+    texture.width = (uint32_t)width;
+    texture.height = (uint32_t)height;
+    texture.format = channels == 4 ? COOKED_RGBA8 : COOKED_RGB8;
+    if (compress)
+    {
+        // decided on the full image, a mip can not turn opaque parts transparent
+        texture.format = isOpaque(pixels, width, height, channels) ? COOKED_BC1 : COOKED_BC3;
+    }
+
+    std::vector<unsigned char> level(pixels, pixels + (size_t)width * height * channels);
+    std::vector<unsigned char> next;
+    std::vector<unsigned char> padded;
+    int w = width;
+    int h = height;
+
+    while (texture.mip_count < COOKED_MAX_MIPS)
+    {
+        if (texture.format == COOKED_BC1)
+        {
+            padded.resize(compressedLevelSize(COOKED_BC1, w, h));
+            encodeBC1(level.data(), w, h, channels, padded.data());
+        }
+        else if (texture.format == COOKED_BC3)
+        {
+            padded.resize(compressedLevelSize(COOKED_BC3, w, h));
+            encodeBC3(level.data(), w, h, padded.data());
+        }
+        else
+        {
+            // pad rows so the default unpack alignment of 4 reads them as stored
+            size_t row = (size_t)w * channels;
+            size_t pitch = (row + 3) & ~(size_t)3;
+            padded.assign(pitch * h, 0);
+            for (int y = 0; y < h; y++)
+            {
+                memcpy(padded.data() + y * pitch, level.data() + y * row, row);
+            }
+        }
+
+        cooked_mip_t &mip = texture.mips[texture.mip_count++];
+        mip.width = (uint32_t)w;
+        mip.height = (uint32_t)h;
+        mip.size = (uint32_t)padded.size();
+        mip.offset = append_blob(out, padded.data(), padded.size());
+
+        if (w == 1 && h == 1)
+        {
+            break;
+        }
+
+        int next_w = w > 1 ? w / 2 : 1;
+        int next_h = h > 1 ? h / 2 : 1;
+        next.resize((size_t)next_w * next_h * channels);
+        downsample(level.data(), w, h, channels, next.data(), next_w, next_h);
+        level.swap(next);
+        w = next_w;
+        h = next_h;
+    }
+
+    if (COOKED_ASSET_DBG)
+    {
+        printf("Cook: %s %dx%d, %u mips, %zu bytes\n", path.c_str(), width, height, texture.mip_count, out.size());
+    }
+
+    memcpy(out.data() + sizeof(cooked_header_t), &texture, sizeof(texture));
+    return write_file(path, out, COOKED_TEXTURE);
+}
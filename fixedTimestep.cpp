@@ -0,0 +1,78 @@
+#include "fixedTimestep.h"
+
+#include <cmath>
+#include <cstdio>
+
+bool FIXED_TIMESTEP_DBG = false;
+
+FixedTimestep::FixedTimestep(double tick_rate, int max_ticks_per_frame, double max_frame_time)
+    : _tick_dt(1.0 / tick_rate), _max_ticks_per_frame(max_ticks_per_frame), _max_frame_time(max_frame_time),
+      _accumulator(0.0), _tick_count(0), _dropped_time(0.0)
+{
+}
+
+void FixedTimestep::setTickRate(double tick_rate)
+{
+    // keep the interpolation fraction, not the absolute leftover time
+    double alpha = _accumulator / _tick_dt;
+    _tick_dt = 1.0 / tick_rate;
+    _accumulator = alpha * _tick_dt;
+}
+
+int FixedTimestep::advance(double frame_dt)
+{
+    if (frame_dt < 0.0)
+    {
+        frame_dt = 0.0;
+    }
+    if (frame_dt > _max_frame_time)
+    {
+        _dropped_time += frame_dt - _max_frame_time;
+        frame_dt = _max_frame_time;
+    }
+
+    _accumulator += frame_dt;
+
+    int ticks = 0;
+    while (_accumulator >= _tick_dt && ticks < _max_ticks_per_frame)
+    {
+        _accumulator -= _tick_dt;
+        ticks++;
+    }
+
+    // still behind after the tick budget: drop whole ticks, keep the fraction
+    if (_accumulator >= _tick_dt)
+    {
+        double behind = _accumulator;
+        _accumulator = fmod(_accumulator, _tick_dt);
+        _dropped_time += behind - _accumulator;
+
+        if (FIXED_TIMESTEP_DBG)
+        {
+            printf("Fixed timestep: dropped %.1f ms\n", (behind - _accumulator) * 1000.0);
+        }
+    }
+
+    _tick_count += ticks;
+    return ticks;
+}
+
+double FixedTimestep::getTickDt() const
+{
+    return _tick_dt;
+}
+
+float FixedTimestep::getAlpha() const
+{
+    return (float)(_accumulator / _tick_dt);
+}
+
+uint64_t FixedTimestep::getTickCount() const
+{
+    return _tick_count;
+}
+
+double FixedTimestep::getDroppedTime() const
+{
+    return _dropped_time;
+}
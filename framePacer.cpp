@@ -0,0 +1,173 @@
+#include "framePacer.h"
+#include "input.h"
+
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+bool FRAME_PACER_DBG = false;
+
+FramePacer::FramePacer(GLFWwindow *window, frame_pacing_mode_t mode)
+    : _window(window), _mode(mode), _tear_control(false), _refresh_period(1.0 / 60.0), _target_period(1.0 / 60.0),
+      _next_deadline(0.0), _frame_start(0.0), _last_present(0.0), _work_estimate(0.0), _latency_sum(0.0), _stats{}
+{
+    // fullscreen windows know their monitor, windowed ones are assumed on the primary
+    GLFWmonitor *monitor = glfwGetWindowMonitor(window);
+    const GLFWvidmode *video_mode = glfwGetVideoMode(monitor ? monitor : glfwGetPrimaryMonitor());
+    if (video_mode && video_mode->refreshRate > 0)
+    {
+        _refresh_period = 1.0 / video_mode->refreshRate;
+    }
+    _target_period = _refresh_period;
+
+    _tear_control = glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear");
+
+    _last_present = glfwGetTime();
+    _next_deadline = _last_present;
+    setMode(mode);
+}
+
+void FramePacer::setMode(frame_pacing_mode_t mode)
+{
+    _mode = mode;
+    switch (mode)
+    {
+    case PACING_ADAPTIVE_VSYNC:
+        glfwSwapInterval(_tear_control ? -1 : 1);
+        if (!_tear_control)
+        {
+            printf("Frame pacing: no swap_control_tear, adaptive vsync runs as plain vsync\n");
+        }
+        break;
+    case PACING_LIMITER:
+        glfwSwapInterval(0);
+        _next_deadline = glfwGetTime();
+        break;
+    case PACING_VSYNC:
+    case PACING_LATE_LATCH:
+    default:
+        glfwSwapInterval(1);
+        break;
+    }
+    printf("Frame pacing: %s\n", modeName(mode));
+}
+
+frame_pacing_mode_t FramePacer::getMode() const
+{
+    return _mode;
+}
+
+const char *FramePacer::modeName(frame_pacing_mode_t mode)
+{
+    switch (mode)
+    {
+    case PACING_VSYNC:
+        return "vsync";
+    case PACING_ADAPTIVE_VSYNC:
+        return "adaptive vsync";
+    case PACING_LIMITER:
+        return "limiter";
+    case PACING_LATE_LATCH:
+        return "late latch";
+    default:
+        return "unknown";
+    }
+}
+
+void FramePacer::setTargetRate(double rate)
+{
+    _target_period = rate > 0.0 ? 1.0 / rate : _refresh_period;
+}
+
+// sleeps most of the way, the last FRAME_PACER_SPIN_MARGIN is spun for precision
+void FramePacer::sleepUntil(double deadline)
+{
+    double now = glfwGetTime();
+    double sleep = deadline - now - FRAME_PACER_SPIN_MARGIN;
+    if (sleep > 0.0)
+    {
+        std::this_thread::sleep_for(std::chrono::duration<double>(sleep));
+    }
+
+    double spin_begin = glfwGetTime();
+    now = spin_begin;
+    while (now < deadline)
+    {
+        std::this_thread::yield();
+        now = glfwGetTime();
+    }
+    _stats.spin_ms += (float)((now - spin_begin) * 1000.0);
+}
+
+void FramePacer::wait()
+{
+    double begin = glfwGetTime();
+    switch (_mode)
+    {
+    case PACING_LIMITER:
+    {
+        sleepUntil(_next_deadline);
+        // a frame later than a whole period restarts the schedule instead of bursting to catch up
+        double now = glfwGetTime();
+        _next_deadline += _target_period;
+        if (_next_deadline < now)
+        {
+            _next_deadline = now + _target_period;
+        }
+        break;
+    }
+    case PACING_LATE_LATCH:
+    {
+        // the previous swap returned at a vblank, the next one is a refresh later. Start
+        // just early enough that the frame's work still makes it.
+        double latch = _last_present + _refresh_period - _work_estimate - FRAME_PACER_LATCH_MARGIN;
+        sleepUntil(latch);
+        break;
+    }
+    default:
+        break;
+    }
+
+    _frame_start = glfwGetTime();
+    _stats.wait_ms += (float)((_frame_start - begin) * 1000.0);
+}
+
+void FramePacer::present()
+{
+    // work is tracked for every mode, switching to late latch starts with a fair estimate.
+    // Rises at once, decays slowly: one missed vblank costs a whole refresh.
+    double work = glfwGetTime() - _frame_start;
+    _work_estimate = work > _work_estimate ? work : _work_estimate + (work - _work_estimate) * 0.05;
+
+    glfwSwapBuffers(_window);
+    _last_present = glfwGetTime();
+
+    _stats.frames++;
+    double stamp = input_take_latency_stamp();
+    if (stamp >= 0.0)
+    {
+        float latency_ms = (float)((_last_present - stamp) * 1000.0);
+        _latency_sum += latency_ms;
+        _stats.latency_samples++;
+        _stats.latency_ms_avg = (float)(_latency_sum / _stats.latency_samples);
+        _stats.latency_ms_max = latency_ms > _stats.latency_ms_max ? latency_ms : _stats.latency_ms_max;
+
+        if (FRAME_PACER_DBG)
+        {
+            printf("Frame pacing: %s, input to swap %.2f ms, work %.2f ms\n", modeName(_mode), latency_ms, work * 1000.0);
+        }
+    }
+}
+
+const frame_pacing_stats_t &FramePacer::getStats() const
+{
+    return _stats;
+}
+
+void FramePacer::resetStats()
+{
+    _stats = frame_pacing_stats_t{};
+    _latency_sum = 0.0;
+}
@@ -0,0 +1,87 @@
+#include "frameUniforms.h"
+#include "glStateCache.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstdio>
+
+Camera2D::Camera2D()
+    : position(0.0f), zoom(1.0f)
+{
+}
+
+glm::mat4 Camera2D::view() const
+{
+    glm::mat4 view = glm::scale(glm::mat4(1.0f), glm::vec3(zoom, zoom, 1.0f));
+    return glm::translate(view, glm::vec3(-position.x, -position.y, 0.0f));
+}
+
+glm::vec4 Camera2D::visibleRect(const glm::mat4 &projection) const
+{
+    glm::mat4 inverse = glm::inverse(projection * view());
+    glm::vec2 min(1e30f), max(-1e30f);
+    const glm::vec2 corners[4] = {{-1.0f, -1.0f}, {1.0f, -1.0f}, {-1.0f, 1.0f}, {1.0f, 1.0f}};
+    for (const glm::vec2 &corner : corners)
+    {
+        glm::vec4 world = inverse * glm::vec4(corner.x, corner.y, 0.0f, 1.0f);
+        glm::vec2 p(world.x / world.w, world.y / world.w);
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    return glm::vec4(min.x, min.y, max.x, max.y);
+}
+
+FrameUniforms::FrameUniforms()
+{
+    _data.view = glm::mat4(1.0f);
+    _data.projection = glm::mat4(1.0f);
+    _data.viewport_time = glm::vec4(0.0f);
+
+    static_assert(sizeof(frame_uniforms_t) == 144, "frame_uniforms_t has to match the std140 block");
+
+    glGenBuffers(1, &_UBO);
+    GLStateCache::get().bindBuffer(GL_UNIFORM_BUFFER, _UBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(frame_uniforms_t), &_data, GL_DYNAMIC_DRAW);
+    GLStateCache::get().bindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, _UBO);
+}
+
+FrameUniforms::~FrameUniforms()
+{
+    GLStateCache::get().forgetBuffer(_UBO);
+    glDeleteBuffers(1, &_UBO);
+}
+
+void FrameUniforms::setView(const glm::mat4 &view)
+{
+    _data.view = view;
+}
+
+void FrameUniforms::setProjection(const glm::mat4 &projection)
+{
+    _data.projection = projection;
+}
+
+void FrameUniforms::setViewport(int width, int height)
+{
+    _data.viewport_time.x = (float)width;
+    _data.viewport_time.y = (float)height;
+}
+
+void FrameUniforms::setTime(double time, double dt)
+{
+    _data.viewport_time.z = (float)time;
+    _data.viewport_time.w = (float)dt;
+}
+
+// one upload per frame for all programs, orphaned so the previous frame can still read
+void FrameUniforms::upload()
+{
+    GLStateCache::get().bindBuffer(GL_UNIFORM_BUFFER, _UBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(frame_uniforms_t), nullptr, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(frame_uniforms_t), &_data);
+}
+
+const frame_uniforms_t &FrameUniforms::getData() const
+{
+    return _data;
+}
@@ -0,0 +1,225 @@
+#include "glStateCache.h"
+
+static const GLuint UNKNOWN = ~0u;
+
+GLStateCache &GLStateCache::get()
+{
+    static GLStateCache cache;
+    return cache;
+}
+
+GLStateCache::GLStateCache()
+    : _stats{}
+{
+    invalidate();
+}
+
+int GLStateCache::textureSlot(GLenum target)
+{
+    switch (target)
+    {
+    case GL_TEXTURE_2D:
+        return TARGET_2D;
+    case GL_TEXTURE_2D_ARRAY:
+        return TARGET_2D_ARRAY;
+    case GL_TEXTURE_CUBE_MAP:
+        return TARGET_CUBE_MAP;
+    default:
+        return -1;
+    }
+}
+
+// element array bindings live in the VAO and are not tracked here
+int GLStateCache::bufferSlot(GLenum target)
+{
+    switch (target)
+    {
+    case GL_ARRAY_BUFFER:
+        return BUFFER_ARRAY;
+    case GL_UNIFORM_BUFFER:
+        return BUFFER_UNIFORM;
+    case GL_PIXEL_UNPACK_BUFFER:
+        return BUFFER_PIXEL_UNPACK;
+    default:
+        return -1;
+    }
+}
+
+void GLStateCache::useProgram(GLuint program)
+{
+    if (_program == program)
+    {
+        _stats.skipped++;
+        return;
+    }
+    _program = program;
+    glUseProgram(program);
+    _stats.issued++;
+}
+
+void GLStateCache::bindVertexArray(GLuint vao)
+{
+    if (_vao == vao)
+    {
+        _stats.skipped++;
+        return;
+    }
+    _vao = vao;
+    glBindVertexArray(vao);
+    _stats.issued++;
+}
+
+void GLStateCache::activeTexture(int unit)
+{
+    if (_active_unit == unit)
+    {
+        _stats.skipped++;
+        return;
+    }
+    _active_unit = unit;
+    glActiveTexture(GL_TEXTURE0 + unit);
+    _stats.issued++;
+}
+
+void GLStateCache::bindTexture(GLenum target, GLuint texture)
+{
+    int slot = textureSlot(target);
+    if (slot < 0 || _active_unit < 0 || _active_unit >= MAX_TEXTURE_UNITS)
+    {
+        // unit not known, whichever one it was no longer matches the shadow copy
+        if (slot >= 0)
+        {
+            for (int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+            {
+                _textures[unit][slot] = UNKNOWN;
+            }
+        }
+        glBindTexture(target, texture);
+        _stats.issued++;
+        return;
+    }
+
+    if (_textures[_active_unit][slot] == texture)
+    {
+        _stats.skipped++;
+        return;
+    }
+    _textures[_active_unit][slot] = texture;
+    glBindTexture(target, texture);
+    _stats.issued++;
+}
+
+void GLStateCache::bindTexture(GLenum target, GLuint texture, int unit)
+{
+    // check first so an already bound texture does not cost the unit switch either
+    int slot = textureSlot(target);
+    if (slot >= 0 && unit >= 0 && unit < MAX_TEXTURE_UNITS && _textures[unit][slot] == texture)
+    {
+        _stats.skipped++;
+        return;
+    }
+    activeTexture(unit);
+    bindTexture(target, texture);
+}
+
+void GLStateCache::bindBuffer(GLenum target, GLuint buffer)
+{
+    int slot = bufferSlot(target);
+    if (slot < 0)
+    {
+        glBindBuffer(target, buffer);
+        _stats.issued++;
+        return;
+    }
+
+    if (_buffers[slot] == buffer)
+    {
+        _stats.skipped++;
+        return;
+    }
+    _buffers[slot] = buffer;
+    glBindBuffer(target, buffer);
+    _stats.issued++;
+}
+
+// indexed binds also replace the generic binding point
+void GLStateCache::bindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+    glBindBufferBase(target, index, buffer);
+    _stats.issued++;
+
+    int slot = bufferSlot(target);
+    if (slot >= 0)
+    {
+        _buffers[slot] = buffer;
+    }
+}
+
+void GLStateCache::forgetProgram(GLuint program)
+{
+    if (_program == program)
+    {
+        _program = UNKNOWN;
+    }
+}
+
+void GLStateCache::forgetVertexArray(GLuint vao)
+{
+    if (_vao == vao)
+    {
+        _vao = 0;
+    }
+}
+
+void GLStateCache::forgetTexture(GLuint texture)
+{
+    for (int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+    {
+        for (int slot = 0; slot < NUM_TEXTURE_TARGETS; slot++)
+        {
+            if (_textures[unit][slot] == texture)
+            {
+                _textures[unit][slot] = 0;
+            }
+        }
+    }
+}
+
+void GLStateCache::forgetBuffer(GLuint buffer)
+{
+    for (int slot = 0; slot < NUM_BUFFER_TARGETS; slot++)
+    {
+        if (_buffers[slot] == buffer)
+        {
+            _buffers[slot] = 0;
+        }
+    }
+}
+
+void GLStateCache::invalidate()
+{
+    _program = UNKNOWN;
+    _vao = UNKNOWN;
+    _active_unit = -1;
+    for (int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+    {
+        for (int slot = 0; slot < NUM_TEXTURE_TARGETS; slot++)
+        {
+            _textures[unit][slot] = UNKNOWN;
+        }
+    }
+    for (int slot = 0; slot < NUM_BUFFER_TARGETS; slot++)
+    {
+        _buffers[slot] = UNKNOWN;
+    }
+}
+
+const gl_state_stats_t &GLStateCache::getStats() const
+{
+    return _stats;
+}
+
+void GLStateCache::resetStats()
+{
+    _stats = gl_state_stats_t{};
+}
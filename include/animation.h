@@ -0,0 +1,90 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "textureUtil.h"
+#include "registry.h"
+
+class TextureAtlas;
+
+// clip 0 of every library: one untextured frame, unknown clip names resolve to it
+#define CLIP_NONE 0
+#define CLIP_EVENT_NONE 0
+
+enum clip_loop_t
+{
+    CLIP_LOOP,
+    CLIP_ONCE,      // holds the last frame
+    CLIP_PING_PONG  // forward, then backward
+};
+
+struct clip_frame_t
+{
+    TextureRegion region;
+    float duration; // seconds
+    uint16_t event; // raised when the frame is entered, CLIP_EVENT_NONE for none
+};
+
+// frames [first_frame, first_frame + frame_count) of the library
+struct animation_clip_t
+{
+    uint32_t first_frame;
+    uint16_t frame_count;
+    uint8_t loop; // clip_loop_t
+    float length; // sum of the frame durations
+};
+
+struct animation_event_t
+{
+    entity_t entity;
+    uint16_t event;
+};
+
+/*
+    Shared, immutable clip data. Entities only keep a clip id and a time
+    (sprite_pool_t), every frame lookup goes through here. Clips come from
+    .anim text files, frame regions are TextureAtlas names:
+
+        # clip <name> <loop|once|pingpong>
+        # frame <atlas region> <seconds> [event]
+        clip gary/walk_left loop
+        frame assets_gary_walk_cycle/left1_ 0.15 footstep
+        frame assets_gary_walk_cycle/idle 0.15
+
+    Clips are only ever appended, ids stay valid for the library's lifetime.
+*/
+class AnimationLibrary
+{
+public:
+    AnimationLibrary();
+
+    // appends the clips of a .anim file, false if it could not be read or parsed
+    bool load(const std::string &path, const TextureAtlas &atlas);
+    uint16_t addClip(const std::string &name, clip_loop_t loop, const std::vector<clip_frame_t> &frames);
+
+    uint16_t find(const std::string &name) const; // CLIP_NONE if unknown
+    uint16_t findEvent(const std::string &name);  // registers unknown names
+    const std::string &getEventName(uint16_t event) const;
+
+    const animation_clip_t &getClip(uint16_t clip) const;
+    const clip_frame_t &getFrame(uint32_t frame) const;
+    uint16_t getClipCount() const;
+
+    // library frame index shown time seconds into the clip
+    uint32_t frameAt(uint16_t clip, float time) const;
+
+private:
+    std::vector<animation_clip_t> _clips;
+    std::vector<clip_frame_t> _frames;
+    std::unordered_map<std::string, uint16_t> _clip_ids;
+    std::vector<std::string> _event_names;
+    std::unordered_map<std::string, uint16_t> _event_ids;
+};
+
+#endif
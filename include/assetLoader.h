@@ -0,0 +1,91 @@
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include <glad/glad.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "textureUtil.h"
+#include "objectCreator.h"
+#include "cookedAsset.h"
+
+/*
+    Decodes images and parses OBJ files on a worker pool. Paths with a fresh
+    cooked sibling (see cookedAsset.h) are mapped instead and uploaded
+    straight from the mapping. load*() returns a
+    usable object right away (transparent texture / unit quad), update()
+    on the GL thread swaps in finished results within a time budget.
+    Images go through a small ring of pixel unpack buffers so the copy to
+    the GPU does not stall the frame. Every finished texture logs its
+    format and estimated video memory.
+*/
+class AssetLoader
+{
+public:
+    AssetLoader(int num_workers = 0);
+    ~AssetLoader();
+
+    Texture2D *loadTexture(const std::string &path);
+    Mesh *loadMesh(const std::string &path);
+
+    // GL thread, once per frame. Returns the number of assets that finished.
+    int update(double budget_ms);
+
+    int getPendingCount() const;
+    bool isIdle() const;
+
+private:
+    enum asset_type_t
+    {
+        ASSET_TEXTURE,
+        ASSET_MESH
+    };
+
+    struct asset_job_t
+    {
+        asset_type_t type;
+        std::string path;
+        Texture2D *texture;
+        Mesh *mesh;
+
+        // filled in by the worker
+        bool ok;
+        int width, height;
+        unsigned char *pixels; // RGBA
+        std::vector<shapes::vertex> vertices;
+        std::vector<uint32_t> indices;
+        std::unique_ptr<MappedFile> cooked;
+        cooked_texture_t cooked_texture; // .gtex / .dds / .ktx2 levels inside the mapping
+    };
+
+    static const int NUM_UPLOAD_BUFFERS = 4;
+
+    void workerLoop();
+    void decode(asset_job_t &job);
+    void decodeSource(asset_job_t &job);
+    void uploadTexture(asset_job_t &job);
+
+    std::vector<std::thread> _workers;
+    mutable std::mutex _mutex;
+    std::condition_variable _wake;
+    bool _stop;
+
+    std::deque<asset_job_t *> _queued;
+    std::deque<asset_job_t *> _finished;
+    int _in_flight; // queued + decoding + finished but not uploaded
+
+    GLuint _upload_buffers[NUM_UPLOAD_BUFFERS];
+    int _next_upload_buffer;
+
+    // handles stay owned by the loader and live as long as it does
+    std::vector<std::unique_ptr<Texture2D>> _textures;
+    std::vector<std::unique_ptr<Mesh>> _meshes;
+};
+
+#endif
@@ -0,0 +1,191 @@
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "registry.h"
+
+class TileMap;
+
+// about two character widths, most bodies touch 1-4 cells
+#define COLLISION_CELL_SIZE 0.1f
+
+// collider_pool_t::contacts bits
+enum contact_flag_t : uint8_t
+{
+    CONTACT_FLOOR = 1 << 0, // standing on or landed on a solid tile
+    CONTACT_CEILING = 1 << 1,
+    CONTACT_WALL_LEFT = 1 << 2,
+    CONTACT_WALL_RIGHT = 1 << 3,
+    CONTACT_ACTOR = 1 << 4
+};
+
+/*
+    One impact during the last tick. Actor pairs produce one event per
+    side, tile hits have other == NULL_ENTITY. The normal points away from
+    what was hit, towards entity; time is the fraction of the tick at
+    which the swept boxes first touched (0 = already overlapping).
+*/
+struct contact_event_t
+{
+    entity_t entity;
+    entity_t other;
+    glm::vec2 normal;
+    float time;
+};
+
+struct collision_stats_t
+{
+    uint32_t bodies;
+    uint32_t hash_entries;
+    uint32_t candidate_pairs; // from the broad phase, before the exact test
+    uint32_t actor_contacts;
+    uint32_t tile_contacts;
+};
+
+/*
+    Uniform grid broad phase. Boxes are binned into every cell they touch,
+    cells are hashed into a bucket table sized to the entry count and the
+    whole thing is rebuilt per tick with a counting sort: two linear passes,
+    no per-cell allocation, no bookkeeping for bodies that moved.
+*/
+class SpatialHash
+{
+public:
+    explicit SpatialHash(float cell_size = COLLISION_CELL_SIZE);
+
+    void setCellSize(float cell_size);
+    float getCellSize() const;
+
+    // boxes as (min x, min y, max x, max y), body ids are indices into this array.
+    // buckets 0 sizes the table to the entries, otherwise a power of two (1 puts every cell in one bucket)
+    void build(const glm::vec4 *boxes, uint32_t count, uint32_t buckets = 0);
+
+    // every overlapping pair (a < b) once, even when they share several cells
+    template <typename F>
+    void forEachPair(F &&visit) const;
+
+    // ids of the boxes overlapping rect, appended to out
+    void query(const glm::vec4 &rect, std::vector<uint32_t> &out) const;
+
+    uint32_t getEntryCount() const;
+
+private:
+    struct cell_range_t
+    {
+        int32_t x0, y0, x1, y1;
+    };
+
+    // one body in one cell
+    struct entry_t
+    {
+        uint32_t id;
+        int32_t cx, cy;
+    };
+
+    cell_range_t cellRange(const glm::vec4 &box) const;
+    uint32_t bucketOf(int32_t cx, int32_t cy) const;
+    void place(const entry_t &entry, uint32_t keep, uint32_t spare);
+
+    float _cell_size, _inv_cell_size;
+    const glm::vec4 *_boxes;
+    uint32_t _count;
+    uint32_t _bucket_mask;
+
+    std::vector<cell_range_t> _ranges;   // per body
+    std::vector<uint32_t> _bucket_start; // bucket -> first entry, one past the end at [buckets]
+    std::vector<entry_t> _entries;       // grouped by bucket, ids ascending within one, one spare at the end
+    std::vector<uint32_t> _shared;       // buckets with two or more entries
+};
+
+/*
+    Walks the buckets holding more than one entry instead of every body's
+    cells: only entries of the same cell can pair up, and of those only the
+    first cell both bodies share reports them. Cells of other bodies hashed
+    into the bucket, and a second cell of the same body landing there, fail
+    the cell compare.
+*/
+template <typename F>
+void SpatialHash::forEachPair(F &&visit) const
+{
+    for (uint32_t bucket : _shared)
+    {
+        uint32_t begin = _bucket_start[bucket];
+        uint32_t end = _bucket_start[bucket + 1];
+        for (uint32_t i = begin; i < end; i++)
+        {
+            const entry_t &ea = _entries[i];
+            for (uint32_t j = i + 1; j < end; j++)
+            {
+                // ascending ids within a bucket, so a <= b
+                const entry_t &eb = _entries[j];
+                if (ea.cx != eb.cx || ea.cy != eb.cy || ea.id == eb.id)
+                {
+                    continue;
+                }
+                const cell_range_t &ra = _ranges[ea.id];
+                const cell_range_t &rb = _ranges[eb.id];
+                int32_t first_x = ra.x0 > rb.x0 ? ra.x0 : rb.x0;
+                int32_t first_y = ra.y0 > rb.y0 ? ra.y0 : rb.y0;
+                if (first_x != ea.cx || first_y != ea.cy)
+                {
+                    continue;
+                }
+                const glm::vec4 &box_a = _boxes[ea.id];
+                const glm::vec4 &box_b = _boxes[eb.id];
+                if (box_a.x <= box_b.z && box_b.x <= box_a.z && box_a.y <= box_b.w && box_b.y <= box_a.w)
+                {
+                    visit(ea.id, eb.id);
+                }
+            }
+        }
+    }
+}
+
+/*
+    Per tick collision for every entity with a collider, run after
+    integration (see simulationTick()):
+
+      1. moving bodies are swept against the solid tiles of the level, one
+         axis at a time. They stop at the first tile in their path, the
+         velocity on that axis is zeroed and CONTACT_* flags are set.
+      2. the swept boxes (previous to current position) of all colliders go
+         into the spatial hash, candidate pairs get an exact swept AABB test
+         on their relative motion. Hits become contact events for both
+         sides, actors are not pushed apart.
+
+    The movement systems read the flags and events, nothing else does.
+    The per tick scratch comes from frameArena(), every step() of a frame
+    adds to it until the game loop resets it.
+*/
+class CollisionWorld
+{
+public:
+    explicit CollisionWorld(float cell_size = COLLISION_CELL_SIZE);
+
+    void setLevel(const TileMap *level);
+    const TileMap *getLevel() const;
+
+    void step(Registry &registry);
+
+    const std::vector<contact_event_t> &getContacts() const;
+    const collision_stats_t &getStats() const;
+
+private:
+    void resolveTiles(Registry &registry);
+    void collideActors(Registry &registry);
+
+    const TileMap *_level;
+    SpatialHash _hash;
+
+    // per tick scratch from frameArena(), valid until the game loop resets it
+    glm::vec4 *_boxes;       // per collider slot, swept over the tick
+    uint32_t *_transform_of; // collider slot -> transform slot
+    std::vector<contact_event_t> _contacts;
+    collision_stats_t _stats;
+};
+
+#endif
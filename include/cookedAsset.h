@@ -0,0 +1,140 @@
+#ifndef COOKED_ASSET_H
+#define COOKED_ASSET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "objectCreator.h"
+
+/*
+    Binary container written by the offline cook tool (cook.cpp) and read back
+    through a memory mapping. Every blob starts on a COOKED_ALIGNMENT boundary
+    and is stored exactly as GL wants it, so loading is a header check plus
+    glBufferData / glTexImage2D straight from the mapped pages.
+
+        cooked_header_t
+        cooked_mesh_t | cooked_texture_t
+        blobs ...
+
+    Bump COOKED_VERSION whenever a layout changes, stale files are rejected
+    and the loaders fall back to the source asset.
+
+    Block compressed textures from other tools (.dds, .ktx2 without
+    supercompression) are mapped the same way and described by the same
+    cooked_texture_t, see readTextureContainer(). They are expected bottom
+    row first like everything else (texconv -vflip, toktx
+    --lower_left_maps_to_s0t0), sRGB variants load as their UNORM twins.
+*/
+
+#define COOKED_MAGIC 0x444B4347u // "GCKD"
+#define COOKED_VERSION 1
+#define COOKED_ALIGNMENT 16
+#define COOKED_MAX_MIPS 16
+#define COOKED_MAX_SIZE 16384 // texture width / height, the usual GL_MAX_TEXTURE_SIZE
+
+#define COOKED_MESH_EXT ".gmesh"
+#define COOKED_TEXTURE_EXT ".gtex"
+#define DDS_TEXTURE_EXT ".dds"
+#define KTX2_TEXTURE_EXT ".ktx2"
+
+enum cooked_type_t : uint32_t
+{
+    COOKED_MESH = 1,
+    COOKED_TEXTURE = 2
+};
+
+enum cooked_pixel_format_t : uint32_t
+{
+    COOKED_RGB8 = 1,
+    COOKED_RGBA8 = 2,
+    COOKED_BC1 = 3, // 4 bpp, opaque or 1 bit alpha
+    COOKED_BC3 = 4, // 8 bpp, BC1 color plus interpolated alpha
+    COOKED_BC7 = 5  // 8 bpp, loaded from .dds / .ktx2 only, the cook tool does not encode it
+};
+
+struct cooked_header_t
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t type;      // cooked_type_t
+    uint32_t file_size; // whole file, catches truncated writes
+};
+
+// vertices are shapes::vertex, indices 16 or 32 bit, offsets from the start of the file
+struct cooked_mesh_t
+{
+    uint32_t vertex_count;
+    uint32_t index_count;
+    uint32_t index_size; // 2 or 4
+    uint32_t vertex_offset;
+    uint32_t index_offset;
+};
+
+struct cooked_mip_t
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t offset;
+    uint32_t size; // rows padded to 4 bytes, the default GL_UNPACK_ALIGNMENT. Compressed: whole blocks.
+};
+
+// bottom row first, like stbi with flip on load
+struct cooked_texture_t
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t format; // cooked_pixel_format_t
+    uint32_t mip_count;
+    cooked_mip_t mips[COOKED_MAX_MIPS];
+};
+
+/*
+    Read-only view of a whole file. mmap on POSIX, a file mapping object on
+    Windows. The pointer stays valid until close() or destruction.
+*/
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool open(const std::string &path);
+    void close();
+
+    const unsigned char *data() const;
+    size_t size() const;
+
+private:
+    const unsigned char *_data;
+    size_t _size;
+#ifdef _WIN32
+    void *_file;
+    void *_mapping;
+#endif
+};
+
+bool isCookedPath(const std::string &path);
+
+// "dir/name.png" -> "dir/name.gtex" etc., empty for extensions the cook tool does not handle
+std::string cookedPathFor(const std::string &source_path);
+
+// the cooked sibling when it exists and is not older than the source, else the source itself
+std::string preferCooked(const std::string &source_path);
+
+// nullptr when the mapping is not a valid cooked file of that type
+const cooked_mesh_t *cookedMesh(const MappedFile &file);
+const cooked_texture_t *cookedTexture(const MappedFile &file);
+
+// .gtex, .dds or .ktx2 by their magic, mip offsets relative to file.data(). False if not a usable texture.
+bool readTextureContainer(const MappedFile &file, cooked_texture_t &texture);
+
+// writers, used by the cook tool. compress: BC1 for opaque images, BC3 with alpha.
+bool writeCookedMesh(const std::string &path, const std::vector<shapes::vertex> &vertices, const std::vector<uint32_t> &indices);
+bool writeCookedTexture(const std::string &path, int width, int height, int channels, const unsigned char *pixels,
+                        bool compress = false);
+
+#endif
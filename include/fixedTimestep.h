@@ -0,0 +1,45 @@
+#ifndef FIXED_TIMESTEP_H
+#define FIXED_TIMESTEP_H
+
+#include <cstdint>
+
+// simulation rate, independent of the display refresh
+#define DEFAULT_TICK_RATE 120.0
+
+/*
+    Accumulator for a fixed-step simulation. Every frame feeds its measured
+    time into advance(), which returns how many ticks of getTickDt() to run.
+    Whatever is left over is exposed as getAlpha() for interpolating render
+    state between the previous and the current tick.
+
+    Frames longer than max_frame_time (debugger, window drag, hitch) are
+    clamped and at most max_ticks_per_frame ticks run, so a slow frame can
+    not snowball into ever more simulation work (spiral of death). Time
+    lost this way is dropped, the game slows down instead.
+*/
+class FixedTimestep
+{
+public:
+    FixedTimestep(double tick_rate = DEFAULT_TICK_RATE, int max_ticks_per_frame = 8, double max_frame_time = 0.25);
+
+    void setTickRate(double tick_rate);
+
+    // returns the number of ticks to simulate this frame
+    int advance(double frame_dt);
+
+    double getTickDt() const;
+    float getAlpha() const;       // [0, 1), fraction of a tick still in the accumulator
+    uint64_t getTickCount() const; // ticks simulated since start
+    double getDroppedTime() const; // seconds discarded by the clamps
+
+private:
+    double _tick_dt;
+    int _max_ticks_per_frame;
+    double _max_frame_time;
+
+    double _accumulator;
+    uint64_t _tick_count;
+    double _dropped_time;
+};
+
+#endif
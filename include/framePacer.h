@@ -0,0 +1,80 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <cstdint>
+
+struct GLFWwindow;
+
+// the limiter sleeps until this close to its deadline and spins the rest,
+// sleep_for overshoots by up to a scheduler quantum
+#define FRAME_PACER_SPIN_MARGIN 0.002
+
+// late latch polls input this long before the predicted vblank, on top of the measured frame work
+#define FRAME_PACER_LATCH_MARGIN 0.003
+
+enum frame_pacing_mode_t
+{
+    PACING_VSYNC,          // swap interval 1, the driver blocks in the swap
+    PACING_ADAPTIVE_VSYNC, // swap interval -1, late frames tear instead of waiting a whole refresh
+    PACING_LIMITER,        // swap interval 0, sleep plus spin to a target rate
+    PACING_LATE_LATCH,     // vsync, the frame starts as late as the last frames allow
+    NUM_PACING_MODES
+};
+
+struct frame_pacing_stats_t
+{
+    uint32_t frames;
+    uint32_t latency_samples; // frames that consumed at least one input event
+    float latency_ms_avg;     // key callback to swap return, oldest event of the frame
+    float latency_ms_max;
+    float wait_ms;            // spent in wait(), sleeping or spinning
+    float spin_ms;            // part of wait_ms burnt busy waiting
+};
+
+/*
+    Decides when a frame starts and when it is shown. The loop calls wait()
+    first, then polls events and simulates, then present() swaps.
+
+    Latency is measured from the timestamp key_callback put on the oldest
+    input event a frame consumed (input_take_latency_stamp()) to the return
+    of glfwSwapBuffers. With vsync that return is close to the start of
+    scanout, so this is input-to-photon up to the display's own delay.
+*/
+class FramePacer
+{
+public:
+    FramePacer(GLFWwindow *window, frame_pacing_mode_t mode = PACING_VSYNC);
+
+    void setMode(frame_pacing_mode_t mode);
+    frame_pacing_mode_t getMode() const;
+    static const char *modeName(frame_pacing_mode_t mode);
+
+    // limiter target, defaults to the monitor refresh rate
+    void setTargetRate(double rate);
+
+    void wait();
+    void present();
+
+    const frame_pacing_stats_t &getStats() const;
+    void resetStats();
+
+private:
+    void sleepUntil(double deadline);
+
+    GLFWwindow *_window;
+    frame_pacing_mode_t _mode;
+    bool _tear_control; // swap interval -1 is supported
+
+    double _refresh_period;
+    double _target_period;
+    double _next_deadline; // limiter
+
+    double _frame_start;   // after wait()
+    double _last_present;  // swap return of the previous frame
+    double _work_estimate; // wait() return to swap call, smoothed
+
+    double _latency_sum;
+    frame_pacing_stats_t _stats;
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// every program with a FrameUniforms block is bound here after link
+#define FRAME_UNIFORMS_BINDING 0
+
+// mirrors the std140 FrameUniforms block in the vertex shaders, keep both in sync
+struct frame_uniforms_t
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec4 viewport_time; // xy viewport size in pixels, z time, w frame dt
+};
+
+struct Camera2D
+{
+    glm::vec2 position;
+    float zoom;
+
+    Camera2D();
+    glm::mat4 view() const;
+    // world rect (x0, y0, x1, y1) this camera shows through projection
+    glm::vec4 visibleRect(const glm::mat4 &projection) const;
+};
+
+/*
+    Per-frame data shared by all shaders. Written once per frame into a
+    uniform buffer bound at FRAME_UNIFORMS_BINDING, instead of one
+    glUniformMatrix4fv per shader and matrix.
+*/
+class FrameUniforms
+{
+public:
+    FrameUniforms();
+    ~FrameUniforms();
+
+    void setView(const glm::mat4 &view);
+    void setProjection(const glm::mat4 &projection);
+    void setViewport(int width, int height);
+    void setTime(double time, double dt);
+    void upload();
+
+    const frame_uniforms_t &getData() const;
+
+private:
+    GLuint _UBO;
+    frame_uniforms_t _data;
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+
+struct gl_state_stats_t
+{
+    uint32_t issued;  // calls that reached the driver
+    uint32_t skipped; // calls dropped because the state was already set
+};
+
+/*
+    Shadow copy of the bind points the renderer touches. Every Shader,
+    Texture2D, Mesh, Quad and batcher binds through here, so driver calls
+    scale with state changes instead of object count. Code that calls
+    glBind* directly has to invalidate() afterwards.
+*/
+class GLStateCache
+{
+public:
+    static const int MAX_TEXTURE_UNITS = 16;
+
+    static GLStateCache &get();
+
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vao);
+    void activeTexture(int unit);
+    void bindTexture(GLenum target, GLuint texture);
+    void bindTexture(GLenum target, GLuint texture, int unit);
+    void bindBuffer(GLenum target, GLuint buffer);
+    void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+
+    // deleted objects are unbound by GL, the shadow copy has to follow
+    void forgetProgram(GLuint program);
+    void forgetVertexArray(GLuint vao);
+    void forgetTexture(GLuint texture);
+    void forgetBuffer(GLuint buffer);
+
+    void invalidate();
+
+    const gl_state_stats_t &getStats() const;
+    void resetStats();
+
+private:
+    GLStateCache();
+
+    enum texture_target_t
+    {
+        TARGET_2D,
+        TARGET_2D_ARRAY,
+        TARGET_CUBE_MAP,
+        NUM_TEXTURE_TARGETS
+    };
+
+    enum buffer_target_t
+    {
+        BUFFER_ARRAY,
+        BUFFER_UNIFORM,
+        BUFFER_PIXEL_UNPACK,
+        NUM_BUFFER_TARGETS
+    };
+
+    static int textureSlot(GLenum target);
+    static int bufferSlot(GLenum target);
+
+    // ~0u marks "unknown", the next bind always goes through
+    GLuint _program;
+    GLuint _vao;
+    int _active_unit;
+    GLuint _textures[MAX_TEXTURE_UNITS][NUM_TEXTURE_TARGETS];
+    GLuint _buffers[NUM_BUFFER_TARGETS];
+
+    gl_state_stats_t _stats;
+};
+
+#endif
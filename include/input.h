@@ -0,0 +1,80 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "objectCreator.h"
+
+#include <atomic>
+#include <cstdint>
+
+// events the queue holds, power of two. At 1000 Hz polling this is a quarter
+// second of input, far more than one frame ever collects
+#define INPUT_QUEUE_SIZE 256
+
+struct input_event_t
+{
+    double time;    // seconds, same clock as the fixed tick times it is consumed against
+    uint8_t action; // button_action_t
+};
+
+/*
+    Lock-free single producer / single consumer ring of button actions. The
+    producer is whoever turns keys into actions (the GLFW key callback, a
+    polling thread, a replayed script), the consumer is the simulation. The
+    producer only writes _tail and the consumer only writes _head, each
+    publishes with release ordering after touching the slot. When the ring
+    is full the new event is dropped and counted.
+*/
+class InputQueue
+{
+public:
+    InputQueue();
+
+    bool push(button_action_t action, double time); // producer
+    bool peek(input_event_t &event) const;         // consumer, oldest event
+    void pop();                                     // consumer, after peek()
+    void clear();                                   // consumer
+
+    uint32_t getDropped() const;
+
+private:
+    input_event_t _events[INPUT_QUEUE_SIZE];
+    std::atomic<uint32_t> _head; // next event to consume
+    std::atomic<uint32_t> _tail; // next free slot
+    std::atomic<uint32_t> _dropped;
+};
+
+/*
+    Keyboard state shared by the window callbacks and the game loop. The
+    managers take GLFW key / action codes, so anything that can produce
+    those (the key callback, a recorded input script) drives the game the
+    same way. Arrow keys become timestamped events in input_queue, every
+    fixed tick takes at most one of them with input_consume_tick(), so a
+    tap (press and release within one frame) still reaches the movement
+    state machine as two actions on consecutive ticks.
+*/
+
+extern InputQueue input_queue;
+
+extern button_action_t debug_key_press;
+extern button_action_t button_action_state; // last action handed to the simulation, fed to the character every tick
+extern button_action_t button_walk_state;
+extern uint32_t input_keys_down; // bit (action >> 1) per held key, as of the last consumed event
+
+// F2 writes profile.json (chrome://tracing), F3 toggles the frame time graph, F4 cycles frame pacing modes,
+// F5 toggles the overdraw view
+extern bool profile_export_requested;
+extern bool show_frame_graph;
+extern bool frame_pacing_cycle_requested;
+extern bool show_overdraw;
+
+void input_character_manager(int button, int action, double time);
+void input_debug_manager(int button, int action);
+
+// consumer side, once per fixed tick with the time the tick ends at
+button_action_t input_consume_tick(double tick_time);
+bool input_key_down(button_action_t action);
+
+// timestamp of the oldest event consumed since the last call, -1 if none. Taken once per presented frame.
+double input_take_latency_stamp();
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef INSTANCING_H
+#define INSTANCING_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// first per-instance attribute location, 0-2 are position / uv / tint of the meshes
+#define INSTANCE_ATTRIB_FIRST 3
+
+enum instance_layout_t
+{
+    INSTANCE_2D,     // _vertex_instanced.vs
+    INSTANCE_MATRIX  // _vertex_model_instanced.vs
+};
+
+namespace shapes
+{
+    // 48 bytes, locations 3-5
+    struct instance_2d
+    {
+        float x, y, z, rotation; // rotation in radians around the mesh origin
+        float scale_x, scale_y;  // half extents for the -1..1 unit quad
+        float flip;              // 1 mirrors u, like the "invert" uniform of _vertex.vs
+        float unused;
+        glm::vec4 uv_rect; // (u0, v0, u1, v1), (0, 0, 1, 1) for the whole texture
+    };
+
+    // 96 bytes, locations 3-8
+    struct instance_matrix
+    {
+        glm::mat4 model;
+        glm::vec4 uv_rect;
+        float flip;
+        float unused[3];
+    };
+}
+
+/*
+    Per-instance attributes for Mesh::drawInstanced() / Model::drawInstanced().
+    Fill it every frame (clear, push, upload), then draw any number of meshes
+    with it: every instance costs one struct in the buffer, the whole set one
+    draw call.
+
+        InstanceBuffer coins(INSTANCE_2D);
+        coins.clear();
+        for (...) coins.push(shapes::instance_2d{x, y, 0, 0, s, s, 0, 0, uv});
+        coins.upload();
+        coin_shader.activate();
+        Mesh::sharedQuad().drawInstanced(coins);
+
+    The GPU buffer is orphaned on upload and only grows, so a frame never
+    waits for the draw of the previous one.
+*/
+class InstanceBuffer
+{
+public:
+    InstanceBuffer(instance_layout_t layout, uint32_t capacity = 256);
+    ~InstanceBuffer();
+    InstanceBuffer(const InstanceBuffer &) = delete;
+    InstanceBuffer &operator=(const InstanceBuffer &) = delete;
+
+    void clear();
+    void push(const shapes::instance_2d &instance);     // INSTANCE_2D only
+    void push(const shapes::instance_matrix &instance); // INSTANCE_MATRIX only
+    void upload();
+
+    // points the per-instance locations of the bound VAO at this buffer
+    void bindAttributes() const;
+
+    instance_layout_t getLayout() const;
+    uint32_t getCount() const;
+    GLuint getBuffer() const;
+
+private:
+    instance_layout_t _layout;
+    GLuint _VBO;
+    uint32_t _capacity; // instances the GPU buffer holds
+    uint32_t _count;    // instances of the last upload()
+
+    std::vector<shapes::instance_2d> _instances_2d;
+    std::vector<shapes::instance_matrix> _instances_matrix;
+};
+
+#endif
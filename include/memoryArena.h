@@ -0,0 +1,214 @@
+#ifndef MEMORY_ARENA_H
+#define MEMORY_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// block size of frameArena() / levelArena(), the first block is taken on first use
+#define FRAME_ARENA_BLOCK_SIZE (256 * 1024)
+#define LEVEL_ARENA_BLOCK_SIZE (4 * 1024 * 1024)
+
+// adds up over every arena and pool, main thread only like the arenas themselves
+struct memory_stats_t
+{
+    uint64_t heap_blocks;    // blocks the arenas took from operator new, 0 per frame once warmed up
+    uint64_t heap_bytes;
+    uint64_t arena_allocs;   // allocate() calls served from a block
+    uint64_t arena_bytes;
+    uint64_t pool_acquires;
+    uint64_t pool_releases;
+    uint64_t pool_exhausted; // acquire() on a full pool, returned nullptr
+};
+
+const memory_stats_t &memoryStats();
+void resetMemoryStats();
+
+// ObjectPool counters, every instantiation adds to the same ones
+void memoryCountPoolAcquire();
+void memoryCountPoolRelease();
+void memoryCountPoolExhausted();
+
+/*
+    Linear allocator over a chain of blocks. allocate() bumps a pointer,
+    nothing is freed on its own: reset() rewinds to the first block and
+    keeps every block for the next round, release() hands all of them back
+    to the heap at once. Requests larger than a block get a block of their
+    own. Only trivially destructible types, nothing runs destructors.
+
+    After the first few rounds the chain is as long as the largest round
+    needed and reset() / allocate() never touch the heap again.
+*/
+class MemoryArena
+{
+public:
+    MemoryArena(const char *name, size_t block_size);
+    ~MemoryArena();
+    MemoryArena(const MemoryArena &) = delete;
+    MemoryArena &operator=(const MemoryArena &) = delete;
+
+    // uninitialized, align a power of two
+    void *allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+    template <typename T>
+    T *allocate(size_t count)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "arena memory is never destructed");
+        return (T *)allocate(sizeof(T) * count, alignof(T));
+    }
+
+    void reset();   // everything allocated so far is gone, blocks are kept
+    void release(); // reset() and back to the heap
+
+    size_t getUsed() const;     // bytes handed out since the last reset, padding included
+    size_t getPeak() const;     // largest getUsed() seen
+    size_t getCapacity() const; // bytes of every block held
+    const char *getName() const;
+
+private:
+    struct block_t
+    {
+        block_t *next;
+        size_t size; // usable bytes after the header
+    };
+
+    block_t *newBlock(size_t size);
+
+    const char *_name;
+    size_t _block_size;
+
+    block_t *_first;
+    block_t *_current;
+    size_t _offset;      // into _current
+    size_t _used_before; // bytes of the blocks before _current
+    size_t _peak;
+};
+
+// reset by the game loop once per frame, scratch that does not outlive the frame
+MemoryArena &frameArena();
+
+// tiles and everything else sized by the level, released when the level is unloaded
+MemoryArena &levelArena();
+
+/*
+    Fixed number of T in one allocation made up front. acquire() constructs
+    in a free slot and release() destructs it again, both O(1) through a
+    free list threaded through the unused slots. A full pool returns
+    nullptr instead of growing, spawning code decides what to drop.
+*/
+template <typename T>
+class ObjectPool
+{
+public:
+    explicit ObjectPool(uint32_t capacity)
+        : _capacity(capacity), _live(0), _peak(0), _free_head(0)
+    {
+        _slots = (slot_t *)::operator new(sizeof(slot_t) * capacity);
+        _used = (uint8_t *)::operator new(capacity);
+        for (uint32_t i = 0; i < capacity; i++)
+        {
+            _slots[i].next_free = i + 1 < capacity ? i + 1 : NO_SLOT;
+            _used[i] = 0;
+        }
+        _free_head = capacity > 0 ? 0 : NO_SLOT;
+    }
+
+    ~ObjectPool()
+    {
+        for (uint32_t i = 0; i < _capacity; i++)
+        {
+            if (_used[i])
+            {
+                ((T *)_slots[i].storage)->~T();
+            }
+        }
+        ::operator delete(_slots);
+        ::operator delete(_used);
+    }
+
+    ObjectPool(const ObjectPool &) = delete;
+    ObjectPool &operator=(const ObjectPool &) = delete;
+
+    template <typename... Args>
+    T *acquire(Args &&...args)
+    {
+        if (_free_head == NO_SLOT)
+        {
+            memoryCountPoolExhausted();
+            return nullptr;
+        }
+        uint32_t index = _free_head;
+        _free_head = _slots[index].next_free;
+        _used[index] = 1;
+        _live++;
+        _peak = _live > _peak ? _live : _peak;
+        memoryCountPoolAcquire();
+        return new (_slots[index].storage) T(std::forward<Args>(args)...);
+    }
+
+    void release(T *object)
+    {
+        uint32_t index = object ? (uint32_t)((slot_t *)object - _slots) : NO_SLOT;
+        if (index >= _capacity || !_used[index])
+        {
+            printf("ObjectPool: release of an object not from this pool\n");
+            return;
+        }
+        object->~T();
+        _used[index] = 0;
+        _slots[index].next_free = _free_head;
+        _free_head = index;
+        _live--;
+        memoryCountPoolRelease();
+    }
+
+    // every live object, in slot order. fn may release the object it is given.
+    template <typename F>
+    void forEach(F fn)
+    {
+        for (uint32_t i = 0; i < _capacity; i++)
+        {
+            if (_used[i])
+            {
+                fn((T *)_slots[i].storage);
+            }
+        }
+    }
+
+    uint32_t getLive() const
+    {
+        return _live;
+    }
+
+    uint32_t getPeak() const
+    {
+        return _peak;
+    }
+
+    uint32_t getCapacity() const
+    {
+        return _capacity;
+    }
+
+private:
+    static const uint32_t NO_SLOT = 0xFFFFFFFFu;
+
+    // storage first so a T * is also the slot's address
+    union slot_t
+    {
+        alignas(T) unsigned char storage[sizeof(T)];
+        uint32_t next_free;
+    };
+
+    slot_t *_slots;
+    uint8_t *_used;
+    uint32_t _capacity;
+    uint32_t _live;
+    uint32_t _peak;
+    uint32_t _free_head;
+};
+
+#endif
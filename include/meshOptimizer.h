@@ -0,0 +1,40 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "objectCreator.h"
+
+struct mesh_memory_report_t
+{
+    size_t vertex_count;
+    size_t index_count;
+    size_t vertex_bytes;
+    size_t index_bytes;
+    float acmr; // average cache miss ratio, post-transform misses per triangle
+};
+
+// collapses bitwise equal (position, uv) vertices of a triangle soup into an indexed mesh
+void weldVertices(const std::vector<shapes::vertex> &soup,
+                  std::vector<shapes::vertex> &vertices, std::vector<uint32_t> &indices);
+
+// reorders triangles for the post-transform cache (Forsyth, linear speed)
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertex_count);
+
+// renumbers vertices in first-use order so fetches walk memory linearly
+void optimizeVertexFetch(std::vector<shapes::vertex> &vertices, std::vector<uint32_t> &indices);
+
+// weld + cache order + fetch order
+void optimizeMesh(const std::vector<shapes::vertex> &soup,
+                  std::vector<shapes::vertex> &vertices, std::vector<uint32_t> &indices);
+
+// FIFO cache simulation, 3.0 means every triangle misses all of its vertices
+float computeACMR(const std::vector<uint32_t> &indices, size_t vertex_count, int cache_size = 16);
+
+mesh_memory_report_t soupReport(const std::vector<shapes::vertex> &soup);
+mesh_memory_report_t indexedReport(const std::vector<shapes::vertex> &vertices, const std::vector<uint32_t> &indices);
+void printMeshReport(const char *name, const mesh_memory_report_t &before, const mesh_memory_report_t &after);
+
+#endif
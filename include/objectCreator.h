@@ -0,0 +1,191 @@
+#ifndef OBJECT_CREATOR_H
+#define OBJECT_CREATOR_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "shader.h"
+#include "textureUtil.h"
+
+class AnimationLibrary;
+class InstanceBuffer;
+class Registry;
+struct cooked_mesh_t;
+
+typedef uint32_t entity_t; // see registry.h
+
+#define NUM_INPUTS 8
+
+// Actor::setName() buffer, terminator included
+#define ACTOR_NAME_LENGTH 32
+
+// the movement state machine (systems.cpp) takes the first NUM_INPUTS entries
+enum button_action_t
+{
+    LEFTP,
+    LEFTR,
+    RIGHTP,
+    RIGHTR,
+    UPP,
+    UPR,
+    DOWNP,
+    DOWNR,
+    SPACEP,
+    SPACER,
+    OFF
+};
+
+enum movement_state_t
+{
+    STAND,
+    WALK_L,
+    WALK_R,
+    JUMP_UP,
+    FALL,
+    JUMP_L,
+    JUMP_R,
+    DUCK,
+    NUM_MOVEMENT_STATES
+};
+
+enum mesh_primitive_t
+{
+    QUAD,
+    BOX,
+    SPHERE,
+    CAPSULE
+};
+
+namespace shapes
+{
+    struct vertex
+    {
+        float x, y, z;
+        float u, v;
+    };
+}
+
+class Quad
+{
+public:
+    Quad();
+
+    void draw();
+    void setPosition(glm::vec2 pos);
+    void setVelocity(glm::vec2 vel);
+    glm::vec2 getPosition();
+    glm::vec2 getVelocity();
+
+private:
+    GLuint VAO, VBO;
+    glm::vec2 _position;
+    glm::vec2 _velocity;
+};
+
+class Model
+{
+public:
+    Model(const std::string path);
+
+    void draw();
+    void drawInstanced(const InstanceBuffer &instances);
+
+private:
+    std::string _model_path;
+    std::vector<shapes::vertex> _model_vertices;
+    std::vector<uint32_t> _indices;
+    GLuint VAO, VBO, EBO;
+    GLenum _index_type;
+};
+
+/* === New definitions === */
+
+class Mesh
+{
+public:
+    Mesh();
+    Mesh(mesh_primitive_t mp);
+    Mesh(const std::string path_to_obj); // .obj, or .gmesh from the cook tool
+
+    void draw();
+    void drawInstanced(const InstanceBuffer &instances);
+    void setGeometry(std::vector<shapes::vertex> &&vertices, std::vector<uint32_t> &&indices);
+
+    // one unit quad for everything that does not need its own geometry
+    static Mesh &sharedQuad();
+    void setGeometry(const cooked_mesh_t &mesh, const unsigned char *file_base);
+    static int parse_obj(const std::string &path_to_obj, std::vector<shapes::vertex> &vertices);
+    static int build_indexed_obj(const std::string &path_to_obj, std::vector<shapes::vertex> &vertices, std::vector<uint32_t> &indices);
+
+protected:
+    GLuint _VAO, _VBO, _EBO;
+    GLenum _index_type;
+    GLsizei _index_count;
+    std::vector<shapes::vertex> _model_vertices; // empty for cooked meshes, those upload from the mapping
+    std::vector<uint32_t> _indices;
+
+private:
+    void build_quad();
+    int load_model(const std::string path_to_obj);
+    void set_vertex_attrib_config();
+    void upload_geometry();
+};
+
+/*
+    Handle to an entity in a Registry. The actor owns the entity (destroyed
+    with it), all of its state lives in the registry's component pools.
+*/
+class Actor
+{
+public:
+    Actor(Registry &registry);
+    ~Actor();
+    Actor(const Actor &) = delete;
+    Actor &operator=(const Actor &) = delete;
+
+    entity_t getEntity() const;
+    void setPosition(glm::vec3 position);
+    glm::vec3 getPosition() const;
+    void setScale(glm::vec3 scale);
+    void setAcceleration(glm::vec3 acceleration);
+    void setCollider(glm::vec2 half_size); // AABB around the position, see collision.h
+    void setName(const char *name); // truncated to ACTOR_NAME_LENGTH - 1 characters
+
+protected:
+    Registry &_registry;
+    entity_t _entity;
+    char _name[ACTOR_NAME_LENGTH]; // inline, spawning an actor does not touch the heap
+};
+
+// player controlled actor, movement and animation run in the systems of systems.h
+class Character : public Actor
+{
+public:
+    Character(Registry &registry);
+
+    void setInput(button_action_t button_action);
+    void setAnimations(const AnimationLibrary &animations, const std::string &prefix);
+
+private:
+    uint16_t _animation_set;
+    uint16_t _movement_profile;
+};
+
+// short lived actor flying on its launch velocity, spawned from an ObjectPool (memoryArena.h)
+class Projectile : public Actor
+{
+public:
+    Projectile(Registry &registry, glm::vec3 position, glm::vec3 velocity, float lifetime);
+
+    // false once the lifetime is used up, the owner releases it then
+    bool update(float dt);
+
+private:
+    float _lifetime;
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef PARALLAX_H
+#define PARALLAX_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+#include "shader.h"
+
+// size of the per layer arrays in _fragment_parallax.fs, keep both in sync
+#define PARALLAX_MAX_LAYERS 8
+
+/*
+    Scrolling background of up to PARALLAX_MAX_LAYERS layers. Every layer is
+    one slice of a GL_TEXTURE_2D_ARRAY. One full-screen triangle samples all
+    of them in the fragment shader and blends them back to front, so N
+    layers cost the fill of one quad instead of N overdrawn ones.
+
+    A layer moves by scroll_factor times the camera movement, 0 stays put
+    (sky) and 1 moves with the level. drift adds a constant scroll in
+    screens per second (clouds). Layers repeat horizontally and clamp
+    vertically. One screen width shows one layer width.
+
+    Slices share one size, layers of another size are resampled (nearest)
+    to the first one's. Layer files are decoded synchronously in build().
+*/
+class ParallaxBackground
+{
+public:
+    ParallaxBackground();
+    ~ParallaxBackground();
+    ParallaxBackground(const ParallaxBackground &) = delete;
+    ParallaxBackground &operator=(const ParallaxBackground &) = delete;
+
+    // back to front. Returns the layer index, -1 when full.
+    int addLayer(const std::string &image_path, glm::vec2 scroll_factor, glm::vec2 drift = glm::vec2(0.0f));
+
+    // "layer <image> <factor x> <factor y> [<drift x> <drift y>]" lines, # comments, then build()
+    bool load(const std::string &path);
+
+    // decodes every layer and uploads the array, call again after adding layers
+    bool build();
+
+    void setScrollFactor(int layer, glm::vec2 scroll_factor);
+    int getLayerCount() const;
+
+    // view_rect = world (x0, y0, x1, y1), see Camera2D::visibleRect()
+    void draw(Shader &shader, const glm::vec4 &view_rect, double time);
+
+private:
+    struct layer_t
+    {
+        std::string image_path;
+        glm::vec2 scroll_factor;
+        glm::vec2 drift;
+    };
+
+    std::vector<layer_t> _layers;
+    int _built_layers; // slices in _texture
+
+    GLuint _texture;
+    GLuint _VAO; // no attributes, the vertex shader derives the triangle from gl_VertexID
+
+    glm::vec2 _offsets[PARALLAX_MAX_LAYERS];
+
+    // handles of the shader draw() was last given
+    Shader *_uniform_shader;
+    Uniform<int> _layers_uniform;
+    Uniform<int> _layer_count_uniform;
+    Uniform<glm::vec2> _layer_offset_uniform;
+};
+
+#endif
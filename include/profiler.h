@@ -0,0 +1,165 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class SpriteBatch;
+class Shader;
+
+// events kept per thread, older ones are overwritten
+#define PROFILER_RING_SIZE 16384
+// frames a GPU query has to finish before its result is read back
+#define PROFILER_GPU_LATENCY 3
+#define PROFILER_MAX_GPU_PASSES 16
+// frames in the on-screen graph
+#define PROFILER_HISTORY 240
+
+#define PROFILER_CONCAT_(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_(a, b)
+
+// CPU time of the enclosing block, name has to be a string literal
+#define PROFILE_SCOPE(name) ProfileScope PROFILER_CONCAT(_profile_scope_, __LINE__)(name)
+// GPU time of the enclosing block, render thread only, no nesting
+#define PROFILE_GPU_SCOPE(name) GpuProfileScope PROFILER_CONCAT(_gpu_profile_scope_, __LINE__)(name)
+
+struct profile_event_t
+{
+    const char *name;
+    uint64_t begin_ns;
+    uint64_t end_ns;
+};
+
+/*
+    Single producer ring: only the owning thread writes, the exporter reads.
+    The write index is published with release ordering after the slot is
+    filled, readers copy a window and drop whatever may have been
+    overwritten while they copied. Nothing ever blocks the writer.
+*/
+struct profile_thread_t
+{
+    std::string name;
+    uint32_t id;
+    std::atomic<uint64_t> written{0};
+    profile_event_t events[PROFILER_RING_SIZE];
+};
+
+struct gpu_pass_t
+{
+    const char *name;
+    GLuint queries[PROFILER_GPU_LATENCY];
+    uint64_t issued_frame[PROFILER_GPU_LATENCY]; // frame the query was started in, 0 = free
+    uint64_t cpu_begin_ns[PROFILER_GPU_LATENCY]; // placement in the exported trace
+    float last_ms;
+};
+
+struct profiler_frame_t
+{
+    float cpu_ms; // beginFrame to beginFrame
+    float gpu_ms; // sum of the latest pass results, up to PROFILER_GPU_LATENCY frames late
+};
+
+/*
+    Frame profiler. CPU scopes from any thread go into per-thread rings,
+    GPU passes are GL_TIME_ELAPSED queries read back a few frames later
+    with GL_QUERY_RESULT_AVAILABLE, so nothing waits on the GPU. A query
+    slot that is still busy is skipped for that frame instead.
+
+        Profiler::get().beginFrame();      // once per frame, render thread
+        { PROFILE_SCOPE("update"); ... }
+        { PROFILE_GPU_SCOPE("background"); ... draw ... }
+        Profiler::get().drawGraph(batch, shader, rect);
+        Profiler::get().exportChromeTrace("profile.json"); // chrome://tracing, ui.perfetto.dev
+*/
+class Profiler
+{
+public:
+    static Profiler &get();
+
+    // names the calling thread in the trace, optional
+    void setThreadName(const std::string &name);
+    void record(const char *name, uint64_t begin_ns, uint64_t end_ns);
+    uint64_t now() const; // ns since the profiler started
+
+    void beginFrame();
+    void gpuBegin(const char *name);
+    void gpuEnd();
+
+    float getPassMs(const char *name) const;
+    const profiler_frame_t &getLastFrame() const;
+
+    // rolling frame time bars inside rect (x0, y0, x1, y1, world units), green under
+    // budget_ms, yellow up to twice that, red above
+    void drawGraph(SpriteBatch &batch, Shader &shader, const glm::vec4 &rect, float budget_ms = 1000.0f / 60.0f);
+
+    bool exportChromeTrace(const std::string &path);
+
+    // releases the queries and the graph texture, call while the context still exists
+    void shutdown();
+
+private:
+    Profiler();
+    ~Profiler();
+    Profiler(const Profiler &) = delete;
+    Profiler &operator=(const Profiler &) = delete;
+
+    profile_thread_t *createRing(const std::string &name);
+    profile_thread_t &threadRing();
+    gpu_pass_t *findPass(const char *name);
+    void collectGpuResults();
+
+    uint64_t _epoch_ns;
+
+    std::mutex _threads_mutex; // registration and export only, never on the record path
+    std::vector<profile_thread_t *> _threads;
+
+    // render thread only
+    uint64_t _frame;
+    uint64_t _frame_begin_ns;
+    gpu_pass_t _passes[PROFILER_MAX_GPU_PASSES];
+    int _num_passes;
+    gpu_pass_t *_active_pass;
+    profile_thread_t *_gpu_ring; // finished GPU passes, shown as their own track in the trace
+    profiler_frame_t _history[PROFILER_HISTORY];
+    uint32_t _history_head;
+    GLuint _white_texture;
+};
+
+// one CPU event from construction to destruction
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const char *name)
+        : _name(name), _begin(Profiler::get().now())
+    {
+    }
+    ~ProfileScope()
+    {
+        Profiler::get().record(_name, _begin, Profiler::get().now());
+    }
+
+private:
+    const char *_name;
+    uint64_t _begin;
+};
+
+class GpuProfileScope
+{
+public:
+    explicit GpuProfileScope(const char *name)
+    {
+        Profiler::get().gpuBegin(name);
+    }
+    ~GpuProfileScope()
+    {
+        Profiler::get().gpuEnd();
+    }
+};
+
+#endif
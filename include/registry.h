@@ -0,0 +1,169 @@
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "objectCreator.h"
+
+// low bits index the sparse arrays, high bits count reuses of that index
+typedef uint32_t entity_t;
+#define ENTITY_INDEX_BITS 24
+#define ENTITY_INDEX_MASK ((1u << ENTITY_INDEX_BITS) - 1)
+#define NULL_ENTITY 0xFFFFFFFFu
+
+/*
+    entity -> dense slot map. Dense slots are packed [0, size()), removal
+    moves the last entity into the hole so iteration never sees gaps.
+*/
+class SparseSet
+{
+public:
+    bool contains(entity_t entity) const;
+    uint32_t indexOf(entity_t entity) const; // entity has to be contained
+    uint32_t size() const;
+    entity_t entityAt(uint32_t slot) const;
+
+    uint32_t insert(entity_t entity); // appends, returns the new slot
+    void reserve(uint32_t entities);
+    void swapRemove(uint32_t slot);
+    void swapSlots(uint32_t a, uint32_t b);
+
+private:
+    std::vector<uint32_t> _sparse;
+    std::vector<entity_t> _dense;
+};
+
+// ------------------------------------ Pools --------------------------------------------
+// One column per field, slot i of every column belongs to set.entityAt(i).
+
+struct transform_pool_t
+{
+    SparseSet set;
+    std::vector<float> x, y, z;
+    std::vector<float> prev_x, prev_y, prev_z; // previous tick, for render interpolation
+    std::vector<float> half_w, half_h;
+
+    // slots [0, moving_count) also have a velocity, stored at the same slot
+    uint32_t moving_count = 0;
+};
+
+struct velocity_pool_t
+{
+    std::vector<float> vx, vy, vz;
+    std::vector<float> ax, ay, az;
+    std::vector<float> ground; // profile ground_height with a movement component, -FLT_MAX without
+};
+
+// AnimationLibrary clip per movement state, shared by every entity of one kind,
+// referenced by index from sprite_pool_t
+struct animation_set_t
+{
+    uint16_t clips[NUM_MOVEMENT_STATES];
+};
+
+struct sprite_pool_t
+{
+    SparseSet set;
+    std::vector<uint16_t> animation_set;
+    std::vector<uint16_t> clip;    // AnimationLibrary clip playing
+    std::vector<float> clip_time;  // seconds into it
+    std::vector<uint32_t> frame;   // library frame shown, entering a new one raises its event
+    std::vector<uint32_t> texture; // frame resolved by animationSystem, read by spriteSystem
+    std::vector<glm::vec4> uv_rect;
+    std::vector<uint8_t> flip;
+    std::vector<uint8_t> layer;
+    std::vector<uint32_t> tint;
+    std::vector<uint8_t> alpha_mode; // alpha_mode_t of the frame, picks the batch pass
+};
+
+// tuning shared by every entity of one kind, referenced by index from movement_pool_t
+struct movement_profile_t
+{
+    glm::vec3 walk_L_velocity;
+    glm::vec3 walk_R_velocity;
+    glm::vec3 jump_velocity;
+    glm::vec3 gravity;
+    float ground_height;
+};
+
+struct movement_pool_t
+{
+    SparseSet set;
+    std::vector<uint8_t> state;       // movement_state_t
+    std::vector<uint8_t> input;       // button_action_t, written by whoever controls the entity
+    std::vector<uint8_t> walk_button; // last left/right action, picks the state after landing
+    std::vector<uint16_t> profile;
+};
+
+// axis aligned box around the transform position, see collision.h
+struct collider_pool_t
+{
+    SparseSet set;
+    std::vector<float> half_w, half_h;
+    std::vector<uint8_t> layer;    // bits this collider is on
+    std::vector<uint8_t> mask;     // layers it collides with
+    std::vector<uint8_t> contacts; // contact_flag_t bits of the last tick, written by CollisionWorld
+};
+
+/*
+    Entities and their components. Components live in dense structure-of-
+    arrays pools so systems (see systems.h) run as linear loops over plain
+    float / byte columns. Velocity is kept slot-aligned with the transform
+    pool: moving entities sit at the front of it, so integration needs no
+    lookups at all.
+*/
+class Registry
+{
+public:
+    entity_t create();
+    void destroy(entity_t entity);
+    bool alive(entity_t entity) const;
+    uint32_t getEntityCount() const;
+
+    // every pool sized for this many entities, creating and destroying below it never reallocates
+    void reserve(uint32_t entities);
+
+    void addTransform(entity_t entity, glm::vec3 position, glm::vec2 half_size);
+    void addVelocity(entity_t entity, glm::vec3 velocity, glm::vec3 acceleration);
+    void addSprite(entity_t entity, uint16_t animation_set, uint8_t layer);
+    void addMovement(entity_t entity, uint16_t profile);
+    void addCollider(entity_t entity, glm::vec2 half_size, uint8_t layer = 1, uint8_t mask = 0xFF);
+
+    void removeTransform(entity_t entity);
+    void removeVelocity(entity_t entity);
+    void removeSprite(entity_t entity);
+    void removeMovement(entity_t entity);
+    void removeCollider(entity_t entity);
+
+    uint16_t addAnimationSet(const animation_set_t &set);
+    animation_set_t &getAnimationSet(uint16_t id);
+    uint16_t addMovementProfile(const movement_profile_t &profile);
+    const movement_profile_t &getMovementProfile(uint16_t id) const;
+
+    transform_pool_t &getTransforms();
+    velocity_pool_t &getVelocities();
+    sprite_pool_t &getSprites();
+    movement_pool_t &getMovement();
+    collider_pool_t &getColliders();
+
+private:
+    void swapTransformSlots(uint32_t a, uint32_t b);
+
+    std::vector<uint8_t> _generations;
+    std::vector<uint32_t> _free_indices;
+    uint32_t _entity_count = 0;
+
+    transform_pool_t _transforms;
+    velocity_pool_t _velocities;
+    sprite_pool_t _sprites;
+    movement_pool_t _movement;
+    collider_pool_t _colliders;
+
+    std::vector<animation_set_t> _animation_sets;
+    std::vector<movement_profile_t> _movement_profiles;
+};
+
+#endif
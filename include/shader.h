@@ -0,0 +1,137 @@
+#ifndef SHADER_H
+#define SHADER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Shader;
+
+// process wide id for a uniform name, 0 is never handed out
+uint32_t internUniformName(const char *name);
+
+// id of a name some program has reflected, 0 if none has. Never adds to the table.
+uint32_t lookupUniformName(const char *name);
+
+/*
+    Handle to one reflected uniform of a shader. Resolved once, then set()
+    costs a compare against the last uploaded value and, only if it changed,
+    one glUniform* call. The owning shader has to be active.
+*/
+template <typename T>
+class Uniform
+{
+public:
+    Uniform() : _shader(nullptr), _slot(-1) {}
+
+    void set(const T &value);
+    void setArray(const T *values, int count); // see Shader::setUniformArray
+
+    bool valid() const
+    {
+        return _slot >= 0;
+    }
+
+private:
+    friend class Shader;
+    Uniform(Shader *shader, int slot) : _shader(shader), _slot(slot) {}
+
+    Shader *_shader;
+    int _slot;
+};
+
+class Shader
+{
+public:
+    // defines: "#define NAME\n" lines inserted after #version in both stages, one file builds several variants
+    Shader(const char *vertexShader, const char *fragmentShader, const char *defines = "");
+    ~Shader();
+
+    // registered with the ShaderManager by address
+    Shader(const Shader &) = delete;
+    Shader &operator=(const Shader &) = delete;
+
+    void activate();
+    GLuint getProgramID() const;
+    const std::string &getVertexPath() const;
+    const std::string &getFragmentPath() const;
+
+    // rebuilds from the files, the old program stays on failure. Slots and handles survive.
+    bool reload();
+
+    void setMatrix(const char *uniform_name, float *matrix);
+    void setInt(const char *uniform_name, int value);
+    void setBool(const char *uniform_name, bool value);
+
+    // name based setters look the name up on every call, keep a Uniform<T> for anything per frame
+    template <typename T>
+    Uniform<T> getUniform(const char *uniform_name)
+    {
+        return Uniform<T>(this, findUniform(uniform_name));
+    }
+
+    int findUniform(const char *uniform_name) const;
+    int findUniform(uint32_t name_id) const;
+
+    // slot based uploads, skipped when the value matches the last upload
+    void setUniform(int slot, int value);
+    void setUniform(int slot, bool value);
+    void setUniform(int slot, float value);
+    void setUniform(int slot, const glm::vec2 &value);
+    void setUniform(int slot, const glm::vec3 &value);
+    void setUniform(int slot, const glm::vec4 &value);
+    void setUniform(int slot, const glm::mat4 &value);
+
+    // whole array from element 0, sent every call, never compared or restored
+    void setUniformArray(int slot, const glm::vec2 *values, int count);
+
+private:
+    struct uniform_slot_t
+    {
+        uint32_t name_id;
+        GLint location;
+        GLenum type;
+        bool uploaded;
+        unsigned char value[64]; // last uploaded value, large enough for a mat4
+    };
+
+    GLuint build();
+    void setupProgram();
+    void reflectUniforms();
+    void restoreUniforms();
+    bool storeUniform(int slot, const void *data, size_t size);
+
+    GLuint shaderProgID;
+    std::string _vertex_path;
+    std::string _fragment_path;
+    std::string _defines;
+
+    // reflected after link: slots plus an open addressing table name_id -> slot
+    std::vector<uniform_slot_t> _uniforms;
+    std::vector<uint32_t> _table_keys;
+    std::vector<int> _table_slots;
+    uint32_t _table_mask;
+};
+
+template <typename T>
+void Uniform<T>::set(const T &value)
+{
+    if (_slot >= 0)
+    {
+        _shader->setUniform(_slot, value);
+    }
+}
+
+template <typename T>
+void Uniform<T>::setArray(const T *values, int count)
+{
+    if (_slot >= 0)
+    {
+        _shader->setUniformArray(_slot, values, count);
+    }
+}
+
+#endif
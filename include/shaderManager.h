@@ -0,0 +1,94 @@
+#ifndef SHADER_MANAGER_H
+#define SHADER_MANAGER_H
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Shader;
+
+// written binaries go here, one file per source / driver combination
+#define SHADER_CACHE_DIRECTORY "shader_cache"
+
+// a burst of writes (editor save, git checkout) settles before anything is rebuilt
+#define SHADER_RELOAD_DEBOUNCE_MS 100
+
+/*
+    Linked program cache and shader hot reload.
+
+    Programs are keyed by a hash of both sources and the driver strings
+    (vendor, renderer, version), so an edited shader or a driver update
+    simply misses. A hit goes through glProgramBinary and skips compile
+    and link; a binary the driver refuses falls back to compiling. The
+    cache needs GL_ARB_get_program_binary and at least one binary format,
+    without them every program is compiled as before.
+
+    Every Shader registers its two files here. A watcher thread waits for
+    them to change (inotify on Linux, modification times elsewhere) and
+    queues the paths; update() on the GL thread rebuilds the affected
+    shaders in place. A program that fails to build keeps the old one.
+*/
+class ShaderManager
+{
+public:
+    static ShaderManager &get();
+    ~ShaderManager();
+
+    // GL thread, before the first Shader. Off: no watcher thread, programs never change
+    void setHotReload(bool enabled);
+
+    // 0 on a miss, otherwise a linked program
+    GLuint loadProgram(uint64_t key);
+    void storeProgram(uint64_t key, GLuint program);
+    uint64_t programKey(const std::string &vertex_code, const std::string &fragment_code);
+    // before glLinkProgram, lets the driver keep the binary around
+    void prepareProgram(GLuint program);
+
+    void watch(Shader *shader);
+    void unwatch(Shader *shader);
+
+    // GL thread, once per frame. Returns the number of shaders rebuilt.
+    int update();
+    void shutdown();
+
+private:
+    ShaderManager();
+
+    struct watched_file_t
+    {
+        std::string path;
+        std::filesystem::file_time_type modified; // polling fallback only
+    };
+
+    bool initCache();
+    void watchLoop();
+    void fileChanged(const std::string &path);
+
+    // program binary cache, GL thread only
+    bool _cache_checked;
+    bool _cache_enabled;
+    uint64_t _driver_hash;
+
+    // GL thread only
+    bool _hot_reload;
+    std::vector<Shader *> _shaders;
+
+    // shared with the watcher
+    std::mutex _mutex;
+    std::vector<watched_file_t> _files;
+    bool _files_dirty; // watcher has to pick up new files
+    std::vector<std::string> _changed;
+    std::chrono::steady_clock::time_point _changed_at;
+
+    std::thread _watcher;
+    std::atomic<bool> _stop;
+};
+
+#endif
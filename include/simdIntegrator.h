@@ -0,0 +1,43 @@
+#ifndef SIMD_INTEGRATOR_H
+#define SIMD_INTEGRATOR_H
+
+#include <cstdint>
+
+enum simd_level_t
+{
+    SIMD_SCALAR,
+    SIMD_SSE2,
+    SIMD_AVX2
+};
+
+// SoA columns, all of length count. Positions and velocities are updated in place.
+struct integrate_arrays_t
+{
+    float *x, *y, *z;
+    float *vx, *vy, *vz;
+    const float *ax, *ay, *az;
+    uint32_t count;
+};
+
+// best level this CPU runs, detected once
+simd_level_t detectSimdLevel();
+const char *simdLevelName(simd_level_t level);
+
+/*
+    Explicit Euler over a batch: p += v * dt, then v += a * dt.
+    Every level does the same mul + add in the same order (no FMA), so the
+    result is bit identical whichever path the dispatch picks.
+*/
+void integrateBatch(const integrate_arrays_t &arrays, float dt);
+void integrateBatch(const integrate_arrays_t &arrays, float dt, simd_level_t level);
+
+/*
+    Ground contact against a per-entry ground height: y[i] below ground[i]
+    is clamped to it and vy[i] zeroed. contact[i] is set to 1 for clamped
+    entries, 0 otherwise. A ground of -FLT_MAX never clamps. Returns the
+    number of contacts, bit identical on every level like the integrator.
+*/
+uint32_t resolveGroundContact(float *y, float *vy, const float *ground, uint8_t *contact, uint32_t count);
+uint32_t resolveGroundContact(float *y, float *vy, const float *ground, uint8_t *contact, uint32_t count, simd_level_t level);
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef SPRITE_BATCH_H
+#define SPRITE_BATCH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "shader.h"
+#include "textureUtil.h"
+
+namespace shapes
+{
+    // streamed per sprite corner, 24 bytes
+    struct sprite_vertex
+    {
+        float x, y, z;
+        float u, v;
+        uint32_t tint; // RGBA8, normalized in the vertex fetch
+    };
+}
+
+// one quad as seen by the batcher: centre/half extents in world units,
+// uv_rect = (u0, v0, u1, v1) into the bound texture
+struct Sprite
+{
+    glm::vec3 position;
+    glm::vec2 half_size;
+    glm::vec4 uv_rect;
+    uint32_t tint;
+    bool flip; // mirror horizontally (replaces the per-draw "invert" uniform)
+    uint8_t alpha_mode = ALPHA_TEST; // alpha_mode_t of the texels, a tint alpha below 255 blends regardless
+};
+
+struct sprite_batch_stats_t
+{
+    uint32_t draws;
+    uint32_t sprites;
+    uint32_t vertices;
+    uint32_t state_changes;
+    uint32_t fence_waits;
+    uint32_t opaque;  // sprites drawn front to back without discard
+    uint32_t blended; // sprites drawn back to front with blending
+};
+
+uint32_t packColor(glm::vec4 color);
+
+/*
+    Collects every sprite of a frame, sorts them by (layer, shader, texture)
+    and streams their corners into one ring buffer. A frame costs one draw per
+    state change instead of one per object.
+
+    The ring is split into segments guarded by fences. With GL_ARB_buffer_storage
+    the buffer is persistently mapped, otherwise each segment is mapped
+    unsynchronized while it is being filled.
+
+    Each flush draws in up to three passes picked by alpha_mode. The sorted
+    order becomes a depth per sprite, later ones nearer. Opaque sprites go
+    first, front to back, with depth writes and no discard, so texels they
+    cover later in the order are rejected before shading. Alpha tested ones
+    follow in sorted order with depth writes, blended ones last, back to
+    front, tested but not written. The depth buffer is cleared and used
+    only inside end(), what is drawn outside the batch is not affected.
+    position.z is replaced, the projection has to keep z in [-1, 1].
+*/
+class SpriteBatch
+{
+public:
+    static const int SPRITES_PER_SEGMENT = 8192;
+    static const int NUM_SEGMENTS = 4;
+
+    SpriteBatch();
+    ~SpriteBatch();
+
+    void begin();
+    void draw(Shader &shader, GLuint texture, const Sprite &sprite, uint8_t layer = 0);
+    void end();
+
+    // drawn instead of shader for the sprites of one alpha_mode, e.g. the OPAQUE_PASS build of the same files
+    void setVariant(Shader &shader, alpha_mode_t mode, Shader &variant);
+
+    // non-null: every pass uses this program and adds up with (GL_ONE, GL_ONE), blending is left on after end()
+    void setOverdrawShader(Shader *shader);
+
+    // stats add up over every begin/end pair until reset, once per frame
+    const sprite_batch_stats_t &getStats() const;
+    void resetStats();
+    bool isPersistent() const;
+
+private:
+    struct command_t
+    {
+        uint64_t key;
+        uint32_t index;
+    };
+
+    struct state_t
+    {
+        Shader *shader;
+        GLuint texture;
+    };
+
+    struct variant_t
+    {
+        Shader *shader;
+        Shader *variant;
+        uint8_t mode;
+    };
+
+    // "tex" of every program the batch has drawn with, resolved the first time it is seen
+    struct sampler_t
+    {
+        Shader *shader;
+        Uniform<int> tex;
+    };
+
+    // consecutive sprites of one segment sharing a state
+    struct run_t
+    {
+        uint32_t command; // first command of the run
+        int first;
+        int count;
+        uint8_t mode; // alpha_mode_t, runs never span two passes
+    };
+
+    void flush();
+    void applyPass(uint8_t mode);
+    Shader *passShader(Shader *shader, uint8_t mode) const;
+    Uniform<int> &samplerOf(Shader *shader);
+    void beginSegment();
+    void endSegment();
+    void writeSprite(shapes::sprite_vertex *dst, const Sprite &sprite);
+
+    GLuint _VAO, _VBO, _EBO;
+    bool _persistent;
+    shapes::sprite_vertex *_mapped;
+
+    GLsync _segment_fence[NUM_SEGMENTS];
+    int _segment;
+    int _segment_used; // sprites written into the current segment
+    shapes::sprite_vertex *_segment_ptr;
+
+    std::vector<command_t> _commands;
+    std::vector<Sprite> _sprites;
+    std::vector<state_t> _states;
+    std::vector<run_t> _runs;
+    std::vector<uint32_t> _order; // indices into _commands, pass by pass
+
+    std::vector<variant_t> _variants;
+    std::vector<sampler_t> _samplers;
+    Shader *_overdraw_shader;
+
+    sprite_batch_stats_t _stats;
+};
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef STATE_MACHINE_H
+#define STATE_MACHINE_H
+
+#include <cstddef>
+#include <cstdint>
+
+// rule wildcards: any input / any state, and "keep the current state" as target
+#define FSM_ANY 0xFF
+#define FSM_STAY 0xFF
+
+struct fsm_rule_t
+{
+    uint8_t input; // input index or FSM_ANY
+    uint8_t from;  // state or FSM_ANY
+    uint8_t to;    // state or FSM_STAY
+};
+
+/*
+    Transition table built at compile time from a list of rules:
+
+        static constexpr fsm_rule_t rules[] = {
+            {FSM_ANY, FALL, FSM_STAY},  // falling ignores input
+            {LEFTP, STAND, WALK_L},
+            ...
+        };
+        static constexpr auto table = fsm_build<NUM_INPUTS, NUM_STATES>(rules);
+        static_assert(fsm_valid(table), "rule names an unknown input or state");
+        static_assert(fsm_complete(table), "some input is unhandled in some state");
+
+    Rules apply in order, a later rule overrides an earlier one for the
+    cells both cover, so wildcards go first. A cell nobody wrote to fails
+    fsm_complete(): staying put has to be asked for with FSM_STAY, it is
+    never a silent default. Lookups are one load, next[input][state], with
+    no branches on either.
+*/
+template <int NumInputs, int NumStates>
+struct fsm_table_t
+{
+    static_assert(NumInputs > 0 && NumInputs < FSM_ANY && NumStates > 0 && NumStates < FSM_STAY, "fsm indices are bytes");
+
+    uint8_t next[NumInputs][NumStates];
+    bool covered[NumInputs][NumStates];
+    bool valid; // every rule named existing inputs and states
+
+    constexpr uint8_t operator()(uint8_t input, uint8_t state) const
+    {
+        return next[input][state];
+    }
+};
+
+template <int NumInputs, int NumStates, size_t NumRules>
+constexpr fsm_table_t<NumInputs, NumStates> fsm_build(const fsm_rule_t (&rules)[NumRules])
+{
+    fsm_table_t<NumInputs, NumStates> table{};
+    table.valid = true;
+    for (int input = 0; input < NumInputs; input++)
+    {
+        for (int state = 0; state < NumStates; state++)
+        {
+            table.next[input][state] = (uint8_t)state;
+            table.covered[input][state] = false;
+        }
+    }
+
+    for (size_t r = 0; r < NumRules; r++)
+    {
+        const fsm_rule_t &rule = rules[r];
+        bool input_ok = rule.input == FSM_ANY || rule.input < NumInputs;
+        bool from_ok = rule.from == FSM_ANY || rule.from < NumStates;
+        bool to_ok = rule.to == FSM_STAY || rule.to < NumStates;
+        if (!input_ok || !from_ok || !to_ok)
+        {
+            table.valid = false;
+            continue;
+        }
+
+        int input_begin = rule.input == FSM_ANY ? 0 : rule.input;
+        int input_end = rule.input == FSM_ANY ? NumInputs : rule.input + 1;
+        int state_begin = rule.from == FSM_ANY ? 0 : rule.from;
+        int state_end = rule.from == FSM_ANY ? NumStates : rule.from + 1;
+        for (int input = input_begin; input < input_end; input++)
+        {
+            for (int state = state_begin; state < state_end; state++)
+            {
+                table.next[input][state] = rule.to == FSM_STAY ? (uint8_t)state : rule.to;
+                table.covered[input][state] = true;
+            }
+        }
+    }
+    return table;
+}
+
+template <int NumInputs, int NumStates>
+constexpr bool fsm_valid(const fsm_table_t<NumInputs, NumStates> &table)
+{
+    return table.valid;
+}
+
+template <int NumInputs, int NumStates>
+constexpr bool fsm_complete(const fsm_table_t<NumInputs, NumStates> &table)
+{
+    for (int input = 0; input < NumInputs; input++)
+    {
+        for (int state = 0; state < NumStates; state++)
+        {
+            if (!table.covered[input][state])
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/*
+    Per-state behaviour lives in a descriptor array indexed by state, each
+    descriptor naming its own state first. fsm_states_ordered() checks that
+    the array lists every state exactly once and in enum order, so a new
+    state can not be added to the enum without its descriptor.
+*/
+template <int NumStates, typename Desc, size_t N>
+constexpr bool fsm_states_ordered(const Desc (&states)[N])
+{
+    if ((int)N != NumStates)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < N; i++)
+    {
+        if (states[i].state != i)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif
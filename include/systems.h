@@ -0,0 +1,50 @@
+#ifndef SYSTEMS_H
+#define SYSTEMS_H
+
+#include "registry.h"
+
+#include <vector>
+
+class SpriteBatch;
+class Shader;
+class CollisionWorld;
+class AnimationLibrary;
+struct animation_event_t;
+
+/*
+    Systems over the Registry pools. Each one is a loop over dense columns,
+    simulationTick() runs the per-tick ones in order:
+
+        storePreviousTransforms -> movementInputSystem -> integrateSystem
+        -> CollisionWorld::step -> movementResolveSystem -> animationSystem
+*/
+
+// prev_* = current, render interpolation blends the two
+void storePreviousTransforms(Registry &registry);
+
+// input -> movement state, velocity / acceleration of the new state
+void movementInputSystem(Registry &registry);
+
+// explicit Euler over the moving partition of the transform pool, SIMD batched
+void integrateSystem(Registry &registry, double dt);
+
+// jump apex -> fall, landing on the ground. With collision the contact flags
+// decide (floor under the feet, head against a ceiling, stomping an actor);
+// without it the ground is the profile's ground_height (velocity_pool_t::ground),
+// clamped for the whole moving partition in one resolveGroundContact() batch.
+void movementResolveSystem(Registry &registry, const CollisionWorld *collision = nullptr);
+
+// movement state -> clip and facing, then every sprite's clip is advanced by dt
+// and its frame resolved to the texture / uv rect spriteSystem draws. Frames
+// with an event append it to events when they are entered.
+void animationSystem(Registry &registry, const AnimationLibrary &animations, double dt,
+                     std::vector<animation_event_t> *events = nullptr);
+
+// sprites keep their last frame without an animation library, clip events are appended to events when given
+void simulationTick(Registry &registry, double dt, CollisionWorld *collision = nullptr,
+                    const AnimationLibrary *animations = nullptr, std::vector<animation_event_t> *events = nullptr);
+
+// every sprite entity into the batch, positions interpolated by alpha (FixedTimestep::getAlpha())
+void spriteSystem(Registry &registry, SpriteBatch &batch, Shader &shader, float alpha);
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "textureUtil.h"
+
+// bottom-left skyline bin packer
+class SkylinePacker
+{
+public:
+    SkylinePacker(int width, int height);
+
+    bool insert(int width, int height, int &out_x, int &out_y);
+
+private:
+    struct skyline_node_t
+    {
+        int x, y, width;
+    };
+
+    int fit(size_t index, int width, int height) const;
+
+    int _width, _height;
+    std::vector<skyline_node_t> _skyline;
+};
+
+struct AtlasRegion
+{
+    std::string name; // "<directory>/<file stem>", e.g. "assets_gary_moves/jump"
+    int x, y, width, height;
+    glm::vec4 uv_rect;
+    uint8_t alpha_mode; // alpha_mode_t of the image's pixels
+};
+
+/*
+    Packs a set of images into one RGBA texture at startup. Frames of an
+    animation become uv rectangles of the same texture, so switching frames
+    no longer needs a texture bind.
+*/
+class TextureAtlas
+{
+public:
+    TextureAtlas(int max_size = 4096, int padding = 2);
+
+    void addImage(const std::string &path);
+    void addDirectory(const std::string &directory);
+    bool build();
+
+    int findIndex(const std::string &name) const;
+    const AtlasRegion *find(const std::string &name) const;
+    const AtlasRegion &getRegion(int index) const;
+    TextureRegion region(const std::string &name) const;
+    int getRegionCount() const;
+
+    GLuint getTextureID() const;
+    int getWidth() const;
+    int getHeight() const;
+
+private:
+    struct pending_image_t
+    {
+        std::string name;
+        int width, height;
+        unsigned char *pixels; // RGBA, bottom row first
+    };
+
+    bool pack(int width, int height, std::vector<glm::ivec2> &positions) const;
+    void blit(std::vector<unsigned char> &atlas_pixels, const pending_image_t &image, int x, int y) const;
+
+    int _max_size;
+    int _padding;
+    int _width, _height;
+
+    std::vector<pending_image_t> _pending;
+    std::vector<AtlasRegion> _regions;
+    std::unordered_map<std::string, int> _lookup;
+    std::unique_ptr<Texture2D> _texture;
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef TEXTURE_COMPRESSION_H
+#define TEXTURE_COMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+    CPU side of the block compressed formats, no GL in here so the cook tool
+    can use it without a context. Blocks are 4x4 texels, 8 bytes for BC1 and
+    16 for BC3 / BC7, stored row of blocks by row of blocks in the same
+    order as the pixels (bottom row first for everything this repo writes).
+
+    The encoder is a fast range fit along the principal axis of each block,
+    good for painted backgrounds, not for pixel art. Only BC1 and BC3 can be
+    decoded here, that is the runtime fallback for drivers without S3TC.
+*/
+
+// bytes of one 4x4 block, 0 for formats that are not block compressed (cooked_pixel_format_t)
+uint32_t blockBytes(uint32_t format);
+
+// bytes of a whole level, partial blocks at the edges count as full ones
+uint32_t compressedLevelSize(uint32_t format, uint32_t width, uint32_t height);
+
+// true if every alpha is 255, BC1 then holds the image without loss of the alpha channel
+bool isOpaque(const unsigned char *pixels, int width, int height, int channels);
+
+// pixels: 3 or 4 channels, out: compressedLevelSize(COOKED_BC1 / COOKED_BC3) bytes
+void encodeBC1(const unsigned char *pixels, int width, int height, int channels, unsigned char *out);
+void encodeBC3(const unsigned char *pixels, int width, int height, unsigned char *out);
+
+// out: width * height RGBA texels
+void decodeBC1(const unsigned char *blocks, int width, int height, unsigned char *out);
+void decodeBC3(const unsigned char *blocks, int width, int height, unsigned char *out);
+
+#endif
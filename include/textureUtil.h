@@ -0,0 +1,86 @@
+#ifndef TEXTURE_UTIL_H
+#define TEXTURE_UTIL_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct cooked_texture_t;
+
+// cooked_pixel_format_t the driver can sample directly, checked once against the extension list
+bool textureFormatSupported(uint32_t format);
+
+// estimated video memory of every live Texture2D, mips included
+size_t textureMemoryTotal();
+
+// how a texture's alpha has to be rendered, picks the sprite pass (see SpriteBatch)
+enum alpha_mode_t : uint8_t
+{
+    ALPHA_OPAQUE, // every alpha 255, no discard and no blending needed
+    ALPHA_TEST,   // alpha below the shader's 0.1 cutoff or 255, discard does the edges
+    ALPHA_BLEND,  // partial alpha, needs blending back to front
+    NUM_ALPHA_MODES
+};
+
+// rgba: 4 channels, stride in pixels between rows
+alpha_mode_t classifyAlpha(const unsigned char *rgba, int width, int height, int stride);
+
+// texture plus the sub-rectangle to sample, uv_rect = (u0, v0, u1, v1)
+struct TextureRegion
+{
+    GLuint texture;
+    glm::vec4 uv_rect;
+    uint8_t alpha_mode = ALPHA_TEST; // alpha_mode_t, unknown content keeps the discard path
+};
+
+class Texture2D
+{
+public:
+    Texture2D();
+    Texture2D(const char *texturePath); // .png etc. through stb_image, .gtex / .dds / .ktx2 mapped
+    Texture2D(int width, int height, int channels, const unsigned char *pixels);
+    ~Texture2D();
+    // owns the GL texture, handed around as Texture2D * / unique_ptr
+    Texture2D(const Texture2D &) = delete;
+    Texture2D &operator=(const Texture2D &) = delete;
+
+    void setImage(int width, int height, int channels, const unsigned char *pixels);
+    // block compressed levels go to the driver as they are, BC1 / BC3 are decoded on the CPU
+    // when it lacks S3TC. False if nothing could be uploaded, the old image stays.
+    bool setCooked(const cooked_texture_t &texture, const unsigned char *file_base);
+
+    GLuint getTextureID() const;
+    int getWidth() const;
+    int getHeight() const;
+    TextureRegion region() const;
+
+    size_t getMemoryBytes() const;
+    const char *getFormatName() const;
+
+private:
+    void upload(int width, int height, int channels, const unsigned char *pixels);
+    void setMemory(size_t bytes, const char *format_name);
+
+    GLuint textureID;
+    int _width, _height;
+    size_t _memory_bytes;
+    const char *_format_name;
+};
+
+class TextureCube
+{
+public:
+    TextureCube(std::vector<std::string> faces);
+
+    GLuint getTextureID() const;
+
+private:
+    GLuint textureID;
+};
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef TILEMAP_H
+#define TILEMAP_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "memoryArena.h"
+#include "shader.h"
+#include "spriteBatch.h"
+
+// tiles per chunk side, a chunk is one VBO and one draw
+#define TILEMAP_CHUNK_SIZE 32
+
+// draw() calls a chunk may go unseen before its VBO is freed
+#define TILEMAP_EVICT_DRAWS 300
+
+// 0 is always empty, ids 1.. index the tileset left to right, top to bottom
+typedef uint16_t tile_t;
+#define TILE_EMPTY 0
+
+enum tile_flag_t : uint8_t
+{
+    TILE_SOLID = 1 << 0
+};
+
+struct tilemap_stats_t
+{
+    uint32_t chunks_visible;
+    uint32_t chunks_drawn;
+    uint32_t chunks_rebuilt;
+    uint32_t tiles_patched;
+    uint32_t tiles_drawn;
+    uint32_t chunks_evicted;
+};
+
+/*
+    Large tile grid baked into static per-chunk geometry. Chunks are built
+    the first time they become visible and rebuilt only when one of their
+    tiles appears or disappears; swapping one tile for another rewrites the
+    four vertices of that tile in place. draw() walks just the chunk range
+    under the view rectangle, so cost follows the screen, not the level size.
+    A chunk left unseen for TILEMAP_EVICT_DRAWS draws loses its VBO and is
+    built again when it comes back, GPU memory follows the recently seen
+    area rather than everything explored.
+
+    Tile (0, 0) is the bottom left, y grows upwards like the world.
+    No GL object exists before the first draw(), so a map can be loaded
+    and queried (collision, tools) without a context.
+    Vertices use the sprite layout, the sprite shader draws them as is.
+
+    Tiles, flags and chunk tables come from the arena given at construction
+    (the level arena by default) and are never freed one by one. Quad
+    tables are taken when a chunk is built and recycled when it is evicted.
+    Release that arena only after the map is destroyed.
+*/
+class TileMap
+{
+public:
+    TileMap(int width, int height, float tile_size, glm::vec2 origin = glm::vec2(0.0f), MemoryArena &arena = levelArena());
+    ~TileMap();
+    TileMap(const TileMap &) = delete;
+    TileMap &operator=(const TileMap &) = delete;
+
+    // comma separated ids, one row per line, first line is the top row (Tiled CSV export)
+    static std::unique_ptr<TileMap> loadCSV(const std::string &path, float tile_size, glm::vec2 origin = glm::vec2(0.0f),
+                                            MemoryArena &arena = levelArena());
+
+    void setTileset(GLuint texture, int columns, int rows);
+    void setTileFlags(tile_t tile, uint8_t flags);
+
+    tile_t getTile(int x, int y) const;
+    void setTile(int x, int y, tile_t tile);
+    void fill(int x0, int y0, int x1, int y1, tile_t tile); // inclusive rect
+
+    bool isSolid(int x, int y) const;
+    glm::ivec2 tileAt(glm::vec2 world) const;
+    glm::vec4 tileRect(int x, int y) const; // world (x0, y0, x1, y1)
+
+    // view_rect = world (x0, y0, x1, y1), see Camera2D::visibleRect()
+    void draw(Shader &shader, const glm::vec4 &view_rect);
+
+    // row major, width * height ids, and the per id flags, for tight query loops
+    const tile_t *getTiles() const;
+    const uint8_t *getTileFlags() const;
+
+    // one bit per tile, TILE_SOLID of (x, y) is bit x % 64 of word y * getSolidStride() + x / 64.
+    // Kept up to date by every tile and flag change, a level is 1/16 the size of its ids.
+    const uint64_t *getSolidMask() const;
+    int getSolidStride() const;
+
+    int getWidth() const;
+    int getHeight() const;
+    float getTileSize() const;
+    uint32_t getResidentChunks() const; // chunks holding GL objects
+    const tilemap_stats_t &getStats() const;
+    void resetStats();
+
+private:
+    struct chunk_t
+    {
+        GLuint VAO, VBO;
+        uint32_t quad_count;
+        uint32_t last_drawn; // _draw_count of the last draw() that saw it
+        bool built;
+        bool dirty;
+        uint16_t *quad_of_tile; // tile in chunk -> quad slot in the VBO, 0xFFFF = none, set while built
+    };
+
+    chunk_t &chunkOf(int x, int y);
+    void createChunkBuffers(chunk_t &chunk);
+    void releaseChunk(chunk_t &chunk);
+    void evictChunks();
+    void updateSolid(int x, int y);
+    void rebuildSolidMask();
+    void rebuildChunk(int cx, int cy);
+    void writeTileQuad(shapes::sprite_vertex *dst, int x, int y, tile_t tile) const;
+
+    int _width, _height;
+    int _chunks_x, _chunks_y;
+    float _tile_size;
+    glm::vec2 _origin;
+
+    // arena memory
+    tile_t *_tiles;
+    uint8_t *_tile_flags; // per tile id
+    uint64_t *_solid;
+    int _solid_stride; // words per row
+    chunk_t *_chunks;
+    size_t _chunk_count;
+    MemoryArena &_arena;
+
+    std::vector<uint32_t> _resident;      // indices of built chunks
+    std::vector<uint16_t *> _free_tables; // quad tables of evicted chunks
+    uint32_t _draw_count;
+
+    // sampler handle of the shader draw() was last given
+    Shader *_tex_shader;
+    Uniform<int> _tex_uniform;
+
+    GLuint _EBO; // quad index pattern shared by every chunk
+    GLuint _tileset;
+    int _tileset_columns, _tileset_rows;
+
+    std::vector<shapes::sprite_vertex> _scratch;
+    tilemap_stats_t _stats;
+};
+
+#endif
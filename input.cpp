@@ -0,0 +1,213 @@
+#include "input.h"
+
+#include <GLFW/glfw3.h>
+
+#include <cstdio>
+
+bool INPUT_DBG = false;
+
+/* === InputQueue === */
+
+InputQueue::InputQueue()
+    : _head(0), _tail(0), _dropped(0)
+{
+    static_assert((INPUT_QUEUE_SIZE & (INPUT_QUEUE_SIZE - 1)) == 0, "INPUT_QUEUE_SIZE has to be a power of two");
+}
+
+bool InputQueue::push(button_action_t action, double time)
+{
+    uint32_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail - _head.load(std::memory_order_acquire) == INPUT_QUEUE_SIZE)
+    {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    _events[tail & (INPUT_QUEUE_SIZE - 1)] = input_event_t{time, (uint8_t)action};
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+bool InputQueue::peek(input_event_t &event) const
+{
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    if (head == _tail.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+    event = _events[head & (INPUT_QUEUE_SIZE - 1)];
+    return true;
+}
+
+void InputQueue::pop()
+{
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    if (head != _tail.load(std::memory_order_acquire))
+    {
+        _head.store(head + 1, std::memory_order_release);
+    }
+}
+
+void InputQueue::clear()
+{
+    _head.store(_tail.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+uint32_t InputQueue::getDropped() const
+{
+    return _dropped.load(std::memory_order_relaxed);
+}
+
+/* === Key state === */
+
+InputQueue input_queue;
+
+button_action_t debug_key_press;
+button_action_t button_action_state = LEFTR;
+button_action_t button_walk_state = LEFTR;
+uint32_t input_keys_down = 0;
+
+bool profile_export_requested = false;
+bool show_frame_graph = true;
+bool frame_pacing_cycle_requested = false;
+bool show_overdraw = false;
+
+static double input_latency_stamp = -1.0;
+
+// producer side: key action -> queued button action, nothing is applied here
+void input_character_manager(int button, int action, double time)
+{
+    switch (button)
+    {
+    case GLFW_KEY_LEFT:
+        if (action == GLFW_PRESS)
+        {
+            input_queue.push(LEFTP, time);
+        }
+        if (action == GLFW_RELEASE)
+        {
+            input_queue.push(LEFTR, time);
+        }
+        break;
+    case GLFW_KEY_RIGHT:
+        if (action == GLFW_PRESS)
+        {
+            input_queue.push(RIGHTP, time);
+        }
+        if (action == GLFW_RELEASE)
+        {
+            input_queue.push(RIGHTR, time);
+        }
+        break;
+    case GLFW_KEY_UP:
+        if (action == GLFW_PRESS)
+        {
+            input_queue.push(UPP, time);
+        }
+        if (action == GLFW_RELEASE)
+        {
+            input_queue.push(UPR, time);
+        }
+        break;
+    case GLFW_KEY_DOWN:
+        if (action == GLFW_PRESS)
+        {
+            input_queue.push(DOWNP, time);
+        }
+        if (action == GLFW_RELEASE)
+        {
+            input_queue.push(DOWNR, time);
+        }
+        break;
+        // case GLFW_KEY_SPACE:
+        //     if (action == GLFW_PRESS)
+        //     {
+        //         debug_key_press = SPACEP;
+        //     }
+        //     if (action == GLFW_RELEASE)
+        //     {
+        //         debug_key_press = SPACER;
+        //     }
+        //     break;
+    }
+    // std::cout << "Button-Action: " << button_action_state << "\n";
+}
+
+void input_debug_manager(int button, int action)
+{
+    if (action != GLFW_PRESS)
+    {
+        return;
+    }
+    switch (button)
+    {
+    case GLFW_KEY_F2:
+        profile_export_requested = true;
+        break;
+    case GLFW_KEY_F3:
+        show_frame_graph = !show_frame_graph;
+        break;
+    case GLFW_KEY_F4:
+        frame_pacing_cycle_requested = true;
+        break;
+    case GLFW_KEY_F5:
+        show_overdraw = !show_overdraw;
+        break;
+    }
+}
+
+// one event per tick keeps every edge visible to the state machine, the
+// rest wait for the following ticks
+button_action_t input_consume_tick(double tick_time)
+{
+    input_event_t event;
+    if (!input_queue.peek(event) || event.time > tick_time)
+    {
+        return button_action_state;
+    }
+    input_queue.pop();
+    if (input_latency_stamp < 0.0)
+    {
+        input_latency_stamp = event.time;
+    }
+
+    button_action_t action = (button_action_t)event.action;
+    uint32_t key_bit = 1u << (action >> 1);
+    // P / R alternate, releases are the odd actions
+    if (action & 1)
+    {
+        input_keys_down &= ~key_bit;
+    }
+    else
+    {
+        input_keys_down |= key_bit;
+    }
+
+    // letting go of one direction while the other is still held walks that way
+    if (action == LEFTR && input_key_down(RIGHTP))
+    {
+        action = RIGHTP;
+    }
+    else if (action == RIGHTR && input_key_down(LEFTP))
+    {
+        action = LEFTP;
+    }
+
+    if (INPUT_DBG)
+    {
+        printf("Input: action %d at %.4f, consumed at %.4f, keys %02x\n", event.action, event.time, tick_time, input_keys_down);
+    }
+    button_action_state = action;
+    return action;
+}
+
+bool input_key_down(button_action_t action)
+{
+    return (input_keys_down >> (action >> 1)) & 1u;
+}
+
+double input_take_latency_stamp()
+{
+    double stamp = input_latency_stamp;
+    input_latency_stamp = -1.0;
+    return stamp;
+}
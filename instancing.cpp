@@ -0,0 +1,138 @@
+#include "instancing.h"
+#include "glStateCache.h"
+
+#include <cstdio>
+
+bool INSTANCING_DBG = false;
+
+static size_t stride_of(instance_layout_t layout)
+{
+    return layout == INSTANCE_2D ? sizeof(shapes::instance_2d) : sizeof(shapes::instance_matrix);
+}
+
+InstanceBuffer::InstanceBuffer(instance_layout_t layout, uint32_t capacity)
+    : _layout(layout), _capacity(capacity > 0 ? capacity : 1), _count(0)
+{
+    static_assert(sizeof(shapes::instance_2d) == 48, "instance_2d has to match _vertex_instanced.vs");
+    static_assert(sizeof(shapes::instance_matrix) == 96, "instance_matrix has to match _vertex_model_instanced.vs");
+
+    glGenBuffers(1, &_VBO);
+    GLStateCache::get().bindBuffer(GL_ARRAY_BUFFER, _VBO);
+    glBufferData(GL_ARRAY_BUFFER, _capacity * stride_of(_layout), nullptr, GL_STREAM_DRAW);
+}
+
+InstanceBuffer::~InstanceBuffer()
+{
+    GLStateCache::get().forgetBuffer(_VBO);
+    glDeleteBuffers(1, &_VBO);
+}
+
+void InstanceBuffer::clear()
+{
+    _instances_2d.clear();
+    _instances_matrix.clear();
+}
+
+void InstanceBuffer::push(const shapes::instance_2d &instance)
+{
+    if (_layout != INSTANCE_2D)
+    {
+        printf("InstanceBuffer: 2D instance pushed into a matrix buffer\n");
+        return;
+    }
+    _instances_2d.push_back(instance);
+}
+
+void InstanceBuffer::push(const shapes::instance_matrix &instance)
+{
+    if (_layout != INSTANCE_MATRIX)
+    {
+        printf("InstanceBuffer: matrix instance pushed into a 2D buffer\n");
+        return;
+    }
+    _instances_matrix.push_back(instance);
+}
+
+void InstanceBuffer::upload()
+{
+    uint32_t count;
+    const void *data;
+    if (_layout == INSTANCE_2D)
+    {
+        count = (uint32_t)_instances_2d.size();
+        data = _instances_2d.data();
+    }
+    else
+    {
+        count = (uint32_t)_instances_matrix.size();
+        data = _instances_matrix.data();
+    }
+    _count = count;
+
+    size_t stride = stride_of(_layout);
+    GLStateCache::get().bindBuffer(GL_ARRAY_BUFFER, _VBO);
+    if (count > _capacity)
+    {
+        while (_capacity < count)
+        {
+            _capacity *= 2;
+        }
+        if (INSTANCING_DBG)
+        {
+            printf("InstanceBuffer: grown to %u instances\n", _capacity);
+        }
+    }
+    // orphan: the driver hands out fresh storage if the old one is still in flight
+    glBufferData(GL_ARRAY_BUFFER, _capacity * stride, nullptr, GL_STREAM_DRAW);
+    if (count > 0)
+    {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, count * stride, data);
+    }
+}
+
+void InstanceBuffer::bindAttributes() const
+{
+    GLStateCache::get().bindBuffer(GL_ARRAY_BUFFER, _VBO);
+
+    if (_layout == INSTANCE_2D)
+    {
+        GLsizei stride = sizeof(shapes::instance_2d);
+        for (int i = 0; i < 3; i++)
+        {
+            GLuint location = INSTANCE_ATTRIB_FIRST + i;
+            glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, stride, (void *)(i * 4 * sizeof(float)));
+            glEnableVertexAttribArray(location);
+            glVertexAttribDivisor(location, 1);
+        }
+        return;
+    }
+
+    // a mat4 attribute takes four locations, one per column, then uv_rect and flip
+    GLsizei stride = sizeof(shapes::instance_matrix);
+    for (int i = 0; i < 5; i++)
+    {
+        GLuint location = INSTANCE_ATTRIB_FIRST + i;
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, stride, (void *)(i * 4 * sizeof(float)));
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+    GLuint flip_location = INSTANCE_ATTRIB_FIRST + 5;
+    glVertexAttribPointer(flip_location, 1, GL_FLOAT, GL_FALSE, stride, (void *)(20 * sizeof(float)));
+    glEnableVertexAttribArray(flip_location);
+    glVertexAttribDivisor(flip_location, 1);
+}
+
+instance_layout_t InstanceBuffer::getLayout() const
+{
+    return _layout;
+}
+
+uint32_t InstanceBuffer::getCount() const
+{
+    return _count;
+}
+
+GLuint InstanceBuffer::getBuffer() const
+{
+    return _VBO;
+}
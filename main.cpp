@@ -12,24 +12,38 @@
 #include <vector>
 #include <cstdio>
 #include <cstdint>
+#include <memory>
 
 #include "shader.h"
+#include "shaderManager.h"
 #include "textureUtil.h"
 #include "objectCreator.h"
+#include "spriteBatch.h"
+#include "textureAtlas.h"
+#include "frameUniforms.h"
+#include "glStateCache.h"
+#include "assetLoader.h"
+#include "fixedTimestep.h"
+#include "registry.h"
+#include "systems.h"
+#include "tilemap.h"
+#include "collision.h"
+#include "profiler.h"
+#include "input.h"
+#include "animation.h"
+#include "framePacer.h"
+#include "parallax.h"
+#include "memoryArena.h"
 
 // GLFW Util Functions
 void frame_buffer_callback(GLFWwindow *window, int width, int height);
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods);
-void input_character_manager(int button, int action);
 void poll_buttons(GLFWwindow *window);
+void run_scene(GLFWwindow *window);
 
 int window_width = 900;
 int window_height = 900;
 
-button_action_t debug_key_press;
-button_action_t button_action_state = LEFTR;
-button_action_t button_walk_state = LEFTR;
-
 int main()
 {
     // ----------------------------------------------------------------
@@ -70,42 +84,90 @@ int main()
     glfwSetFramebufferSizeCallback(window, frame_buffer_callback);
     glfwSetKeyCallback(window, key_callback);
 
-    // -----------------------------------------------------------------------------------
-    // Basic geometries
-    Quad background_quad;
+    // GL objects live in run_scene so they are released while the context still exists
+    run_scene(window);
+
+    glfwTerminate();
+    return 0;
+}
 
+void run_scene(GLFWwindow *window)
+{
     // -----------------------------------------------------------------------------------
     // Shader creations
-    Shader quad_shader("_vertex.vs", "_fragment.fs");
-    Shader background_shader("_vertex_background.vs", "_fragment_background.fs");
+    Shader sprite_shader("_vertex_sprite.vs", "_fragment_sprite.fs");
+    Shader parallax_shader("_vertex_parallax.vs", "_fragment_parallax.fs");
+    // same files, opaque sprites without discard and the F5 overdraw view
+    Shader sprite_opaque_shader("_vertex_sprite.vs", "_fragment_sprite.fs", "#define OPAQUE_PASS\n");
+    Shader sprite_overdraw_shader("_vertex_sprite.vs", "_fragment_sprite.fs", "#define OVERDRAW\n");
+    Shader parallax_overdraw_shader("_vertex_parallax.vs", "_fragment_parallax.fs", "#define OVERDRAW\n");
+
+    // -----------------------------------------------------------------------------------
+    // Camera and per-frame shader data
+    Camera2D camera;
+    FrameUniforms frame_uniforms;
+    glm::mat4 projection = glm::ortho(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f);
+
+    // -----------------------------------------------------------------------------------
+    // Sprite batching, everything visible goes through here
+    SpriteBatch sprite_batch;
+    sprite_batch.setVariant(sprite_shader, ALPHA_OPAQUE, sprite_opaque_shader);
 
     // -----------------------------------------------------------------------------------
-    // Basic textures
-    Texture2D background("textures/background/grass_landscape.png");
-    // Texture2D background("textures/background/Blue_tile.png");
-
-    // ------------------------------ Walk Animation -------------------------------------
-    Texture2D idle_sprite("assets_gary_walk_cycle/idle.png");
-    Texture2D l1_sprite("assets_gary_walk_cycle/left1_.png");
-    Texture2D l2_sprite("assets_gary_walk_cycle/left2_.png");
-    Texture2D r1_sprite("assets_gary_walk_cycle/right1_.png");
-    Texture2D r2_sprite("assets_gary_walk_cycle/right2_.png");
-    Texture2D jump_sprite("assets_gary_moves/jump.png");
-    Texture2D duck_sprite("assets_gary_moves/duck.png");
-
-    // Walk vector
-    std::vector<Texture2D *> walk_textures;
-    walk_textures.push_back(&idle_sprite);
-    walk_textures.push_back(&l1_sprite);
-    walk_textures.push_back(&l2_sprite);
-    walk_textures.push_back(&r1_sprite);
-    walk_textures.push_back(&r2_sprite);
-
-    // --------------------------------- Character Object --------------------------------
-    Character character;
-
-    // Background
-    glm::mat4 base = glm::mat4(1.0f);
+    // Asset streaming, decoded on worker threads and uploaded a little every frame
+    AssetLoader asset_loader;
+
+    // -----------------------------------------------------------------------------------
+    // Background, every layer composited in one full screen draw
+    ParallaxBackground background;
+    background.load("backgrounds/meadow.parallax");
+
+    // ------------------------------ Character Sprites ----------------------------------
+    // walk cycle and moves share one texture, animation frames are uv rects
+    TextureAtlas character_atlas;
+    character_atlas.addDirectory("assets_gary_walk_cycle");
+    character_atlas.addDirectory("assets_gary_moves");
+    character_atlas.build();
+
+    // --------------------------------- Entities ----------------------------------------
+    // component storage for everything simulated, see registry.h / systems.h
+    Registry registry;
+
+    // clips shared by everything animated, frames are regions of the atlas above
+    AnimationLibrary animations;
+    animations.load("animations/gary.anim", character_atlas);
+
+    Character character(registry);
+    character.setAnimations(animations, "gary");
+
+    // clip events of the ticks of one frame, handled after the update
+    std::vector<animation_event_t> animation_events;
+    uint16_t footstep_event = animations.findEvent("footstep");
+    uint32_t footsteps = 0;
+
+    // ---------------------------------- Level ------------------------------------------
+    // one tile per character height, ground top at the character's feet (y = -0.05)
+    // tiles and chunk tables live in levelArena(), released with the level
+    const float tile_size = 0.05f;
+    const glm::vec2 level_origin(-1.0f, -0.25f);
+    std::unique_ptr<TileMap> level = TileMap::loadCSV("levels/level1.csv", tile_size, level_origin);
+    if (!level)
+    {
+        // flat ground with a few platforms
+        level.reset(new TileMap(4096, 64, tile_size, level_origin));
+        level->fill(0, 0, level->getWidth() - 1, 2, 2);
+        level->fill(0, 3, level->getWidth() - 1, 3, 1);
+        for (int x = 48; x < level->getWidth(); x += 24)
+        {
+            level->fill(x, 8 + x % 5, x + 5, 8 + x % 5, 3);
+        }
+    }
+    Texture2D *tileset = asset_loader.loadTexture("textures/tiles/tileset.png");
+
+    // actors against the level and each other
+    CollisionWorld collision;
+    collision.setLevel(level.get());
+
     // -----------------------------------------------------------------------------------
 
     glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
@@ -117,49 +179,181 @@ int main()
     double t2;
     double dt;
 
-    // glEnable(GL_DEPTH_TEST);
+    // simulation runs at a fixed rate, rendering interpolates between ticks
+    FixedTimestep timestep(DEFAULT_TICK_RATE);
+
+    // swap interval and frame start, F4 cycles the modes
+    FramePacer pacer(window, PACING_VSYNC);
+
+    double stats_timer = 0.0;
+    char window_title[384];
 
     // ---------------------------- Render/Game Loop -------------------------------------
     while (!glfwWindowShouldClose(window))
     {
 
+        Profiler::get().beginFrame();
+
+        // last frame's scratch is gone, its blocks are reused
+        frameArena().reset();
+
+        {
+            PROFILE_SCOPE("pacing");
+            pacer.wait();
+        }
+
+        // input is sampled right before it is simulated, not a whole frame earlier after the swap
+        glfwPollEvents();
+        poll_buttons(window);
+
+        if (frame_pacing_cycle_requested)
+        {
+            pacer.setMode((frame_pacing_mode_t)((pacer.getMode() + 1) % NUM_PACING_MODES));
+            frame_pacing_cycle_requested = false;
+        }
+
         // delta time
         t2 = glfwGetTime();
         dt = t2 - t1;
         t1 = t2;
 
-        // printf("dt: %f\n", dt);
+        GLStateCache::get().resetStats();
+        sprite_batch.resetStats();
+        level->resetStats();
 
-        poll_buttons(window);
+        {
+            PROFILE_SCOPE("assets");
+            asset_loader.update(2.0);
+        }
+
+        // edited .vs / .fs files are rebuilt here, between frames
+        ShaderManager::get().update();
+
+        /* === Update === */
+
+        {
+            PROFILE_SCOPE("update");
+            int ticks = timestep.advance(dt);
+            double tick_dt = timestep.getTickDt();
+            // the last tick ends alpha ticks before now, key events are stamped on the same clock
+            double tick_time = t2 - timestep.getAlpha() * tick_dt - ticks * tick_dt;
+            animation_events.clear();
+            for (int i = 0; i < ticks; i++)
+            {
+                tick_time += tick_dt;
+                character.setInput(input_consume_tick(tick_time));
+                simulationTick(registry, tick_dt, &collision, &animations, &animation_events);
+            }
+            // no audio yet, footsteps are counted for the stats line
+            for (const animation_event_t &event : animation_events)
+            {
+                if (event.event == footstep_event)
+                {
+                    footsteps++;
+                }
+            }
+        }
+
+        frame_uniforms.setView(camera.view());
+        frame_uniforms.setProjection(projection);
+        frame_uniforms.setViewport(window_width, window_height);
+        frame_uniforms.setTime(t2, dt);
+        frame_uniforms.upload();
 
         /* ===  Clear screen === */
-        glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
-        // glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // depth is cleared by the sprite batch, the only user
+        if (show_overdraw)
+        {
+            // everything below adds one step per shaded fragment on black
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_ONE, GL_ONE);
+        }
+        else
+        {
+            glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+        }
         glClear(GL_COLOR_BUFFER_BIT);
+        sprite_batch.setOverdrawShader(show_overdraw ? &sprite_overdraw_shader : nullptr);
 
         /* === Background === */
+        {
+            PROFILE_SCOPE("background draw");
+            PROFILE_GPU_SCOPE("background");
+            background.draw(show_overdraw ? parallax_overdraw_shader : parallax_shader, camera.visibleRect(projection), t2);
+        }
 
-        background_shader.activate();
-        background_shader.setMatrix("model", glm::value_ptr(base));
-        background_shader.setInt("tex", 0);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, background.getTextureID());
-        background_quad.draw();
+        /* === Level === */
+        {
+            PROFILE_SCOPE("level draw");
+            PROFILE_GPU_SCOPE("level");
+            // texture id changes once the asset loader has uploaded the tileset
+            level->setTileset(tileset->getTextureID(), 8, 8);
+            level->draw(show_overdraw ? sprite_overdraw_shader : sprite_shader, camera.visibleRect(projection));
+        }
 
         /* === Character === */
+        {
+            PROFILE_SCOPE("character draw");
+            PROFILE_GPU_SCOPE("character");
+            sprite_batch.begin();
+            spriteSystem(registry, sprite_batch, sprite_shader, timestep.getAlpha());
+            if (show_frame_graph)
+            {
+                // bottom left corner, NDC like the rest of the scene
+                Profiler::get().drawGraph(sprite_batch, sprite_shader, glm::vec4(-0.98f, -0.98f, -0.38f, -0.78f));
+            }
+            sprite_batch.end();
+        }
+
+        if (show_overdraw)
+        {
+            glDisable(GL_BLEND);
+        }
 
-        character.updateMovementState(button_action_state, dt);
-        character.draw(quad_shader, walk_textures, jump_sprite, idle_sprite, duck_sprite);
+        if (profile_export_requested)
+        {
+            Profiler::get().exportChromeTrace("profile.json");
+            profile_export_requested = false;
+        }
+
+        // batch report, once per second
+        stats_timer += dt;
+        if (stats_timer > 1.0)
+        {
+            const sprite_batch_stats_t &stats = sprite_batch.getStats();
+            const gl_state_stats_t &gl_stats = GLStateCache::get().getStats();
+            const tilemap_stats_t &level_stats = level->getStats();
+            const profiler_frame_t &frame = Profiler::get().getLastFrame();
+            const frame_pacing_stats_t &pacing = pacer.getStats();
+            snprintf(window_title, sizeof(window_title), "Platformer | cpu: %.2f ms gpu: %.2f ms | draws: %u sprites: %u (%u opaque, %u blended) vertices: %u | binds: %u skipped: %u | chunks: %u/%u (%u resident) tiles: %u | %s latency: %.1f/%.1f ms wait: %.0f%% | tex: %.1f MiB | arena: %zu/%zu KiB +%llu blocks | steps: %u",
+                     frame.cpu_ms, frame.gpu_ms, stats.draws, stats.sprites, stats.opaque, stats.blended, stats.vertices, gl_stats.issued, gl_stats.skipped,
+                     level_stats.chunks_drawn, level_stats.chunks_visible, level->getResidentChunks(), level_stats.tiles_drawn,
+                     FramePacer::modeName(pacer.getMode()), pacing.latency_ms_avg, pacing.latency_ms_max,
+                     stats_timer > 0.0 ? pacing.wait_ms / (stats_timer * 10.0) : 0.0, textureMemoryTotal() / (1024.0 * 1024.0),
+                     frameArena().getPeak() / 1024, levelArena().getUsed() / 1024, (unsigned long long)memoryStats().heap_blocks, footsteps);
+            glfwSetWindowTitle(window, window_title);
+            pacer.resetStats();
+            resetMemoryStats();
+            footsteps = 0;
+            stats_timer = 0.0;
+        }
 
         /* === Displat all === */
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
-        // glfwWaitEvents();
+        {
+            PROFILE_SCOPE("present");
+            pacer.present();
+        }
     }
 
-    glfwTerminate();
-    return 0;
+    // unload the level: the map goes first, then its memory in one piece
+    collision.setLevel(nullptr);
+    level.reset();
+    levelArena().release();
+
+    Profiler::get().shutdown();
+    ShaderManager::get().shutdown();
 }
 
 // ------------------------------- End -------------------------------------
@@ -183,63 +377,6 @@ void frame_buffer_callback(GLFWwindow *window, int width, int height)
 
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods)
 {
-    input_character_manager(key, action);
-}
-
-void input_character_manager(int button, int action)
-{
-    switch (button)
-    {
-    case GLFW_KEY_LEFT:
-        if (action == GLFW_PRESS)
-        {
-            button_action_state = LEFTP;
-        }
-        if (action == GLFW_RELEASE)
-        {
-            button_action_state = LEFTR;
-        }
-        break;
-    case GLFW_KEY_RIGHT:
-        if (action == GLFW_PRESS)
-        {
-            button_action_state = RIGHTP;
-        }
-        if (action == GLFW_RELEASE)
-        {
-            button_action_state = RIGHTR;
-        }
-        break;
-    case GLFW_KEY_UP:
-        if (action == GLFW_PRESS)
-        {
-            button_action_state = UPP;
-        }
-        if (action == GLFW_RELEASE)
-        {
-            button_action_state = UPR;
-        }
-        break;
-    case GLFW_KEY_DOWN:
-        if (action == GLFW_PRESS)
-        {
-            button_action_state = DOWNP;
-        }
-        if (action == GLFW_RELEASE)
-        {
-            button_action_state = DOWNR;
-        }
-        break;
-        // case GLFW_KEY_SPACE:
-        //     if (action == GLFW_PRESS)
-        //     {
-        //         debug_key_press = SPACEP;
-        //     }
-        //     if (action == GLFW_RELEASE)
-        //     {
-        //         debug_key_press = SPACER;
-        //     }
-        //     break;
-    }
-    // std::cout << "Button-Action: " << button_action_state << "\n";
+    input_character_manager(key, action, glfwGetTime());
+    input_debug_manager(key, action);
 }
@@ -0,0 +1,158 @@
+#include "memoryArena.h"
+
+bool MEMORY_DBG = false;
+
+static memory_stats_t memory_stats = {};
+
+const memory_stats_t &memoryStats()
+{
+    return memory_stats;
+}
+
+void resetMemoryStats()
+{
+    memory_stats = memory_stats_t{};
+}
+
+void memoryCountPoolAcquire()
+{
+    memory_stats.pool_acquires++;
+}
+
+void memoryCountPoolRelease()
+{
+    memory_stats.pool_releases++;
+}
+
+void memoryCountPoolExhausted()
+{
+    memory_stats.pool_exhausted++;
+}
+
+// ------------------------------------ Arena --------------------------------------------
+
+// header padded so the first allocation of a block is max_align_t aligned
+static const size_t BLOCK_HEADER = (16 + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+
+MemoryArena::MemoryArena(const char *name, size_t block_size)
+    : _name(name), _block_size(block_size), _first(nullptr), _current(nullptr), _offset(0), _used_before(0), _peak(0)
+{
+}
+
+MemoryArena::~MemoryArena()
+{
+    release();
+}
+
+MemoryArena::block_t *MemoryArena::newBlock(size_t size)
+{
+    // operator new rather than malloc, the bench's allocation hook sees arena growth too
+    block_t *block = (block_t *)::operator new(BLOCK_HEADER + size);
+    block->next = nullptr;
+    block->size = size;
+
+    memory_stats.heap_blocks++;
+    memory_stats.heap_bytes += BLOCK_HEADER + size;
+    if (MEMORY_DBG)
+    {
+        printf("Arena %s: new block of %zu KiB\n", _name, size / 1024);
+    }
+    return block;
+}
+
+void *MemoryArena::allocate(size_t size, size_t align)
+{
+    if (!_current)
+    {
+        _first = _current = newBlock(size + align > _block_size ? size + align : _block_size);
+    }
+
+    for (;;)
+    {
+        // the address is aligned, operator new only guarantees 16 for the block itself
+        unsigned char *base = (unsigned char *)_current + BLOCK_HEADER;
+        uintptr_t address = (uintptr_t)(base + _offset);
+        size_t start = (size_t)(((address + align - 1) & ~(uintptr_t)(align - 1)) - (uintptr_t)base);
+        if (start + size <= _current->size)
+        {
+            _offset = start + size;
+            size_t used = _used_before + _offset;
+            _peak = used > _peak ? used : _peak;
+            memory_stats.arena_allocs++;
+            memory_stats.arena_bytes += size;
+            return base + start;
+        }
+
+        // on to the next kept block, or a new one at the end of the chain
+        if (!_current->next)
+        {
+            _current->next = newBlock(size + align > _block_size ? size + align : _block_size);
+        }
+        _used_before += _current->size;
+        _current = _current->next;
+        _offset = 0;
+    }
+}
+
+void MemoryArena::reset()
+{
+    _current = _first;
+    _offset = 0;
+    _used_before = 0;
+}
+
+void MemoryArena::release()
+{
+    block_t *block = _first;
+    while (block)
+    {
+        block_t *next = block->next;
+        ::operator delete(block);
+        block = next;
+    }
+    _first = _current = nullptr;
+    _offset = 0;
+    _used_before = 0;
+
+    if (MEMORY_DBG)
+    {
+        printf("Arena %s: released, peak %zu KiB\n", _name, _peak / 1024);
+    }
+}
+
+size_t MemoryArena::getUsed() const
+{
+    return _used_before + _offset;
+}
+
+size_t MemoryArena::getPeak() const
+{
+    return _peak;
+}
+
+size_t MemoryArena::getCapacity() const
+{
+    size_t capacity = 0;
+    for (block_t *block = _first; block; block = block->next)
+    {
+        capacity += block->size;
+    }
+    return capacity;
+}
+
+const char *MemoryArena::getName() const
+{
+    return _name;
+}
+
+MemoryArena &frameArena()
+{
+    static MemoryArena arena("frame", FRAME_ARENA_BLOCK_SIZE);
+    return arena;
+}
+
+MemoryArena &levelArena()
+{
+    static MemoryArena arena("level", LEVEL_ARENA_BLOCK_SIZE);
+    return arena;
+}
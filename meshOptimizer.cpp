@@ -0,0 +1,322 @@
+#include "meshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+// ----------------------------------- Welding -----------------------------------------
+
+// -0.0f and 0.0f compare equal but hash differently, fold them before hashing
+static inline uint32_t float_bits(float f)
+{
+    if (f == 0.0f)
+    {
+        f = 0.0f;
+    }
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+static inline uint32_t hash_vertex(const shapes::vertex &v)
+{
+    // FNV-1a over the five components
+    uint32_t h = 2166136261u;
+    uint32_t words[5] = {float_bits(v.x), float_bits(v.y), float_bits(v.z), float_bits(v.u), float_bits(v.v)};
+    for (int i = 0; i < 5; i++)
+    {
+        h ^= words[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static inline bool same_vertex(const shapes::vertex &a, const shapes::vertex &b)
+{
+    return a.x == b.x && a.y == b.y && a.z == b.z && a.u == b.u && a.v == b.v;
+}
+
+void weldVertices(const std::vector<shapes::vertex> &soup,
+                  std::vector<shapes::vertex> &vertices, std::vector<uint32_t> &indices)
+{
+    vertices.clear();
+    indices.clear();
+    vertices.reserve(soup.size() / 2);
+    indices.reserve(soup.size());
+
+    // open addressing table of indices into vertices, at most half full
+    size_t capacity = 16;
+    while (capacity < soup.size() * 2)
+    {
+        capacity *= 2;
+    }
+    const uint32_t EMPTY = ~0u;
+    std::vector<uint32_t> table(capacity, EMPTY);
+    size_t mask = capacity - 1;
+
+    for (const auto &v : soup)
+    {
+        size_t bucket = hash_vertex(v) & mask;
+        while (table[bucket] != EMPTY && !same_vertex(vertices[table[bucket]], v))
+        {
+            bucket = (bucket + 1) & mask;
+        }
+
+        if (table[bucket] == EMPTY)
+        {
+            table[bucket] = (uint32_t)vertices.size();
+            vertices.push_back(v);
+        }
+        indices.push_back(table[bucket]);
+    }
+}
+
+// ------------------------------ Vertex cache order -----------------------------------
+
+static const int FORSYTH_CACHE_SIZE = 32;
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float LAST_TRI_SCORE = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+
+static float vertex_score(int cache_position, int remaining_triangles)
+{
+    if (remaining_triangles == 0)
+    {
+        return -1.0f; // no triangle needs it any more
+    }
+
+    float score = 0.0f;
+    if (cache_position >= 0)
+    {
+        if (cache_position < 3)
+        {
+            // used by the last triangle, fixed score so it is not picked again right away
+            score = LAST_TRI_SCORE;
+        }
+        else
+        {
+            float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+            score = 1.0f - (cache_position - 3) * scaler;
+            score = std::pow(score, CACHE_DECAY_POWER);
+        }
+    }
+
+    // boost vertices with few triangles left so they get finished off
+    score += VALENCE_BOOST_SCALE * std::pow((float)remaining_triangles, -VALENCE_BOOST_POWER);
+    return score;
+}
+
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertex_count)
+{
+    size_t triangle_count = indices.size() / 3;
+    if (triangle_count == 0)
+    {
+        return;
+    }
+
+    // vertex -> triangle adjacency, packed
+    std::vector<uint32_t> remaining(vertex_count, 0);
+    for (uint32_t index : indices)
+    {
+        remaining[index]++;
+    }
+    std::vector<uint32_t> offsets(vertex_count + 1, 0);
+    for (size_t v = 0; v < vertex_count; v++)
+    {
+        offsets[v + 1] = offsets[v] + remaining[v];
+    }
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < triangle_count; t++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            uint32_t v = indices[3 * t + k];
+            adjacency[fill[v]++] = (uint32_t)t;
+        }
+    }
+
+    std::vector<float> score(vertex_count);
+    for (size_t v = 0; v < vertex_count; v++)
+    {
+        score[v] = vertex_score(-1, remaining[v]);
+    }
+
+    std::vector<bool> emitted(triangle_count, false);
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+
+    int cache[FORSYTH_CACHE_SIZE + 3];
+    int cache_size = 0;
+
+    size_t scan_cursor = 0;
+    int best = -1;
+
+    for (size_t emitted_count = 0; emitted_count < triangle_count; emitted_count++)
+    {
+        if (best < 0)
+        {
+            // nothing useful in the cache, continue with the next untouched triangle
+            while (emitted[scan_cursor])
+            {
+                scan_cursor++;
+            }
+            best = (int)scan_cursor;
+        }
+
+        emitted[best] = true;
+        uint32_t tri[3] = {indices[3 * best], indices[3 * best + 1], indices[3 * best + 2]};
+        output.push_back(tri[0]);
+        output.push_back(tri[1]);
+        output.push_back(tri[2]);
+
+        // drop the triangle from its vertices' adjacency
+        for (int k = 0; k < 3; k++)
+        {
+            uint32_t v = tri[k];
+            uint32_t begin = offsets[v];
+            uint32_t end = begin + remaining[v];
+            for (uint32_t a = begin; a < end; a++)
+            {
+                if (adjacency[a] == (uint32_t)best)
+                {
+                    adjacency[a] = adjacency[end - 1];
+                    break;
+                }
+            }
+            remaining[v]--;
+        }
+
+        // new cache: triangle first, then the previous contents without duplicates
+        int new_cache[FORSYTH_CACHE_SIZE + 3];
+        int new_size = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            new_cache[new_size++] = (int)tri[k];
+        }
+        for (int c = 0; c < cache_size; c++)
+        {
+            int v = cache[c];
+            if (v != (int)tri[0] && v != (int)tri[1] && v != (int)tri[2])
+            {
+                new_cache[new_size++] = v;
+            }
+        }
+
+        // vertices pushed out lose their cache bonus
+        for (int c = FORSYTH_CACHE_SIZE; c < new_size; c++)
+        {
+            int v = new_cache[c];
+            score[v] = vertex_score(-1, remaining[v]);
+        }
+        cache_size = std::min(new_size, FORSYTH_CACHE_SIZE);
+        for (int c = 0; c < cache_size; c++)
+        {
+            cache[c] = new_cache[c];
+            score[cache[c]] = vertex_score(c, remaining[cache[c]]);
+        }
+
+        // rescore triangles touching the cache and pick the best one
+        best = -1;
+        float best_score = -1.0f;
+        for (int c = 0; c < cache_size; c++)
+        {
+            int v = cache[c];
+            for (uint32_t a = offsets[v]; a < offsets[v] + remaining[v]; a++)
+            {
+                uint32_t t = adjacency[a];
+                float s = score[indices[3 * t]] + score[indices[3 * t + 1]] + score[indices[3 * t + 2]];
+                if (s > best_score)
+                {
+                    best_score = s;
+                    best = (int)t;
+                }
+            }
+        }
+    }
+
+    indices.swap(output);
+}
+
+void optimizeVertexFetch(std::vector<shapes::vertex> &vertices, std::vector<uint32_t> &indices)
+{
+    const uint32_t UNUSED = ~0u;
+    std::vector<uint32_t> remap(vertices.size(), UNUSED);
+    std::vector<shapes::vertex> reordered;
+    reordered.reserve(vertices.size());
+
+    for (uint32_t &index : indices)
+    {
+        if (remap[index] == UNUSED)
+        {
+            remap[index] = (uint32_t)reordered.size();
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(reordered);
+}
+
+float computeACMR(const std::vector<uint32_t> &indices, size_t vertex_count, int cache_size)
+{
+    if (indices.size() < 3)
+    {
+        return 0.0f;
+    }
+
+    // FIFO with per-vertex insertion stamps
+    std::vector<size_t> stamp(vertex_count, 0);
+    size_t clock = 0;
+    size_t misses = 0;
+    for (uint32_t index : indices)
+    {
+        if (stamp[index] == 0 || clock - stamp[index] >= (size_t)cache_size)
+        {
+            clock++;
+            stamp[index] = clock;
+            misses++;
+        }
+    }
+    return (float)misses / (float)(indices.size() / 3);
+}
+
+void optimizeMesh(const std::vector<shapes::vertex> &soup,
+                  std::vector<shapes::vertex> &vertices, std::vector<uint32_t> &indices)
+{
+    weldVertices(soup, vertices, indices);
+    optimizeVertexCache(indices, vertices.size());
+    optimizeVertexFetch(vertices, indices);
+}
+
+// --------------------------------- Reporting -----------------------------------------
+
+mesh_memory_report_t soupReport(const std::vector<shapes::vertex> &soup)
+{
+    mesh_memory_report_t report{};
+    report.vertex_count = soup.size();
+    report.vertex_bytes = soup.size() * sizeof(shapes::vertex);
+    report.acmr = 3.0f;
+    return report;
+}
+
+mesh_memory_report_t indexedReport(const std::vector<shapes::vertex> &vertices, const std::vector<uint32_t> &indices)
+{
+    mesh_memory_report_t report{};
+    report.vertex_count = vertices.size();
+    report.index_count = indices.size();
+    report.vertex_bytes = vertices.size() * sizeof(shapes::vertex);
+    report.index_bytes = indices.size() * (vertices.size() <= 0xFFFF ? sizeof(uint16_t) : sizeof(uint32_t));
+    report.acmr = computeACMR(indices, vertices.size());
+    return report;
+}
+
+void printMeshReport(const char *name, const mesh_memory_report_t &before, const mesh_memory_report_t &after)
+{
+    printf("Mesh %s: %zu -> %zu vertices, %zu -> %zu bytes (%zu vertex + %zu index), ACMR %.2f -> %.2f\n",
+           name, before.vertex_count, after.vertex_count,
+           before.vertex_bytes + before.index_bytes, after.vertex_bytes + after.index_bytes,
+           after.vertex_bytes, after.index_bytes, before.acmr, after.acmr);
+}
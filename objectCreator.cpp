@@ -11,104 +11,13 @@
 
 #include "shader.h"
 #include "textureUtil.h"
-
-movement_state_t input_transitions[NUM_INPUTS][8] = {
-
-    // Left press 0
-    {
-        WALK_L,  // STAND
-        WALK_L,  // WALK_L
-        WALK_L,  // WALK_R
-        JUMP_UP, // JUMP_UP
-        FALL,    // FALL
-        JUMP_L,  // JUMP_L,
-        JUMP_R,  // JUMP_R
-        DUCK     // DUCK
-    },
-
-    // Left release 1
-    {
-        STAND,   // STAND
-        STAND,   // WALK_L
-        WALK_R,  // WALK_R
-        JUMP_UP, // JUMP_UP
-        FALL,    // FALL
-        JUMP_L,  // JUMP_L,
-        JUMP_R,  // JUMP_R
-        DUCK     // DUCK
-    },
-
-    // Right press 2
-    {
-        WALK_R,  // STAND
-        WALK_R,  // WALK_L
-        WALK_R,  // WALK_R
-        JUMP_UP, // JUMP_UP
-        FALL,    // FALL
-        JUMP_L,  // JUMP_L,
-        JUMP_R,  // JUMP_R
-        DUCK     // DUCK
-    },
-
-    // Right release 3
-    {
-        STAND,   // STAND
-        WALK_L,  // WALK_L
-        STAND,   // WALK_R
-        JUMP_UP, // JUMP_UP
-        FALL,    // FALL
-        JUMP_L,  // JUMP_L,
-        JUMP_R,  // JUMP_R
-        DUCK     // DUCK
-    },
-
-    // Up press 4
-    {
-        JUMP_UP, // STAND
-        JUMP_L,  // WALK_L
-        JUMP_R,  // WALK_R
-        JUMP_UP, // JUMP_UP
-        FALL,    // FALL
-        JUMP_L,  // JUMP_L,
-        JUMP_R,  // JUMP_R
-        DUCK     // DUCK
-    },
-
-    // Up release 5
-    {
-        STAND,   // STAND
-        WALK_L,  // WALK_L
-        WALK_R,  // WALK_R
-        JUMP_UP, // JUMP_UP
-        FALL,    // FALL
-        JUMP_L,  // JUMP_L,
-        JUMP_R,  // JUMP_R
-        DUCK     // DUCK
-    },
-
-    // Down press 6
-    {
-        DUCK,    // STAND
-        DUCK,    // WALK_L
-        DUCK,    // WALK_R
-        JUMP_UP, // JUMP_UP
-        FALL,    // FALL
-        JUMP_L,  // JUMP_L,
-        JUMP_R,  // JUMP_R
-        DUCK     // DUCK
-    },
-
-    // Down release 7
-    {
-        STAND,   // STAND
-        WALK_L,  // WALK_L
-        WALK_R,  // WALK_R
-        JUMP_UP, // JUMP_UP
-        FALL,    // FALL
-        JUMP_L,  // JUMP_L,
-        JUMP_R,  // JUMP_R
-        STAND    // DUCK
-    }};
+#include "animation.h"
+#include "glStateCache.h"
+#include "meshOptimizer.h"
+#include "cookedAsset.h"
+#include "registry.h"
+#include "collision.h"
+#include "instancing.h"
 
 Quad::Quad()
     : _position{glm::vec2(0.0f)}, _velocity{glm::vec2(0.0f)}
@@ -126,11 +35,11 @@ Quad::Quad()
 
     // Bookmark
     glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
+    GLStateCache::get().bindVertexArray(VAO);
 
     // VBO memory
     glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    GLStateCache::get().bindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
     // Memory layout
@@ -156,15 +65,14 @@ Quad::Quad()
     glEnableVertexAttribArray(1);
 
     // Disable VAO
-    glBindVertexArray(0);
+    GLStateCache::get().bindVertexArray(0);
 }
 
 void Quad::draw()
 {
     // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    glBindVertexArray(VAO);
+    GLStateCache::get().bindVertexArray(VAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
 }
 
 void Quad::setPosition(glm::vec2 pos)
@@ -189,48 +97,54 @@ glm::vec2 Quad::getVelocity()
 
 // =====================================================================================
 
-Model::Model(const std::string path)
-    : _model_path(path)
+// uploads into the element buffer bound to the current VAO, 16 bit indices when they fit
+static GLenum upload_index_buffer(const std::vector<uint32_t> &indices)
 {
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::string warn, err;
+    uint32_t max_index = 0;
+    for (uint32_t index : indices)
+    {
+        max_index = index > max_index ? index : max_index;
+    }
 
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, _model_path.c_str()))
+    if (max_index <= 0xFFFF)
+    {
+        std::vector<uint16_t> short_indices(indices.begin(), indices.end());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, short_indices.size() * sizeof(uint16_t), short_indices.data(), GL_STATIC_DRAW);
+        return GL_UNSIGNED_SHORT;
+    }
+
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+    return GL_UNSIGNED_INT;
+}
+
+Model::Model(const std::string path)
+    : _model_path(path), VAO(0), VBO(0), EBO(0), _index_type(GL_UNSIGNED_SHORT)
+{
+    std::vector<shapes::vertex> soup;
+    if (Mesh::parse_obj(_model_path, soup) != 0)
     {
         printf("Error loading model mesh. Failed to initialize model!\n");
     }
     else
     {
-        for (const auto &shape : shapes)
-        {
-            for (const auto &index : shape.mesh.indices)
-            {
-                shapes::vertex vertex{};
-                vertex.x = attrib.vertices[3 * index.vertex_index + 0];
-                vertex.y = attrib.vertices[3 * index.vertex_index + 1];
-                vertex.z = attrib.vertices[3 * index.vertex_index + 2];
-
-                // to do : add normals and try phong shading
-
-                vertex.u = attrib.texcoords[2 * index.texcoord_index + 0];
-                vertex.v = attrib.texcoords[2 * index.texcoord_index + 1];
-
-                _model_vertices.push_back(vertex);
-            }
-        }
+        optimizeMesh(soup, _model_vertices, _indices);
+        printMeshReport(_model_path.c_str(), soupReport(soup), indexedReport(_model_vertices, _indices));
 
         // Bookmark
         glGenVertexArrays(1, &VAO);
-        glBindVertexArray(VAO);
+        GLStateCache::get().bindVertexArray(VAO);
 
         // VBO memory
         glGenBuffers(1, &VBO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        GLStateCache::get().bindBuffer(GL_ARRAY_BUFFER, VBO);
         size_t array_size = sizeof(_model_vertices[0]) * _model_vertices.size();
         glBufferData(GL_ARRAY_BUFFER, array_size, _model_vertices.data(), GL_STATIC_DRAW);
 
+        // EBO memory
+        glGenBuffers(1, &EBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        _index_type = upload_index_buffer(_indices);
+
         // Position
         glVertexAttribPointer(
             0,                 // Attribute position
@@ -253,16 +167,27 @@ Model::Model(const std::string path)
         glEnableVertexAttribArray(1);
 
         // Disable VAO
-        glBindVertexArray(0);
+        GLStateCache::get().bindVertexArray(0);
     }
 }
 
 void Model::draw()
 {
     // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLES, 0, _model_vertices.size());
-    glBindVertexArray(0);
+    GLStateCache::get().bindVertexArray(VAO);
+    glDrawElements(GL_TRIANGLES, (GLsizei)_indices.size(), _index_type, (void *)0);
+}
+
+// every instance of the buffer in one draw, with _vertex_model_instanced.vs
+void Model::drawInstanced(const InstanceBuffer &instances)
+{
+    if (instances.getCount() == 0)
+    {
+        return;
+    }
+    GLStateCache::get().bindVertexArray(VAO);
+    instances.bindAttributes();
+    glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)_indices.size(), _index_type, (void *)0, (GLsizei)instances.getCount());
 }
 
 /* To do
@@ -281,6 +206,7 @@ Mesh::Mesh()
 }
 
 Mesh::Mesh(mesh_primitive_t mp)
+    : _VAO(0), _VBO(0), _EBO(0), _index_type(GL_UNSIGNED_SHORT), _index_count(0)
 {
     switch (mp)
     {
@@ -289,6 +215,7 @@ Mesh::Mesh(mesh_primitive_t mp)
         printf("Created Quad!\n");
         build_quad();
         set_vertex_attrib_config();
+        upload_geometry();
         break;
     case BOX:
         // todo
@@ -306,18 +233,29 @@ Mesh::Mesh(mesh_primitive_t mp)
 }
 
 Mesh::Mesh(const std::string path_to_obj)
+    : _VAO(0), _VBO(0), _EBO(0), _index_type(GL_UNSIGNED_SHORT), _index_count(0)
 {
-    int err = load_model(path_to_obj);
-    if (!err)
+    set_vertex_attrib_config();
+
+    if (isCookedPath(path_to_obj))
     {
-        set_vertex_attrib_config();
+        MappedFile file;
+        const cooked_mesh_t *cooked = file.open(path_to_obj) ? cookedMesh(file) : nullptr;
+        if (cooked)
+        {
+            setGeometry(*cooked, file.data());
+            return;
+        }
     }
-    else
+    else if (load_model(path_to_obj) == 0)
     {
-        build_quad();
-        set_vertex_attrib_config();
-        printf("Error loading model mesh - created unit quad instead!\n");
+        upload_geometry();
+        return;
     }
+
+    build_quad();
+    upload_geometry();
+    printf("Error loading model mesh - created unit quad instead!\n");
 }
 
 void Mesh::build_quad()
@@ -334,6 +272,8 @@ void Mesh::build_quad()
     };
 
     int num_elements = sizeof(vertices) / (sizeof(shapes::vertex));
+    std::vector<shapes::vertex> soup;
+    soup.reserve(num_elements);
     shapes::vertex v{};
     for (int i = 0; i < num_elements; i++)
     {
@@ -345,11 +285,40 @@ void Mesh::build_quad()
         v.u = vertices[5 * i + 3];
         v.v = vertices[5 * i + 4];
 
-        _model_vertices.push_back(v);
+        soup.push_back(v);
     }
+
+    // 4 shared corners + 6 indices
+    weldVertices(soup, _model_vertices, _indices);
 }
 
 int Mesh::load_model(const std::string path_to_obj)
+{
+    if (build_indexed_obj(path_to_obj, _model_vertices, _indices) != 0)
+    {
+        printf("Error loading model mesh. Failed to initialize model!\n");
+        return -1;
+    }
+    printf("Model mesh loaded!\n");
+    return 0;
+}
+
+// parse + weld + reorder, no GL calls either
+int Mesh::build_indexed_obj(const std::string &path_to_obj, std::vector<shapes::vertex> &vertices, std::vector<uint32_t> &indices)
+{
+    std::vector<shapes::vertex> soup;
+    if (parse_obj(path_to_obj, soup) != 0)
+    {
+        return -1;
+    }
+
+    optimizeMesh(soup, vertices, indices);
+    printMeshReport(path_to_obj.c_str(), soupReport(soup), indexedReport(vertices, indices));
+    return 0;
+}
+
+// no GL calls, safe to run on a loader thread
+int Mesh::parse_obj(const std::string &path_to_obj, std::vector<shapes::vertex> &vertices)
 {
     tinyobj::attrib_t attrib;
     std::vector<tinyobj::shape_t> shapes;
@@ -358,31 +327,94 @@ int Mesh::load_model(const std::string path_to_obj)
 
     if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path_to_obj.c_str()))
     {
-        printf("Error loading model mesh. Failed to initialize model!\n");
         return -1;
     }
-    else
+
+    size_t num_indices = 0;
+    for (const auto &shape : shapes)
     {
-        for (const auto &shape : shapes)
+        num_indices += shape.mesh.indices.size();
+    }
+    vertices.reserve(vertices.size() + num_indices);
+
+    for (const auto &shape : shapes)
+    {
+        for (const auto &index : shape.mesh.indices)
         {
-            for (const auto &index : shape.mesh.indices)
-            {
-                shapes::vertex vertex{};
-                vertex.x = attrib.vertices[3 * index.vertex_index + 0];
-                vertex.y = attrib.vertices[3 * index.vertex_index + 1];
-                vertex.z = attrib.vertices[3 * index.vertex_index + 2];
+            shapes::vertex vertex{};
+            vertex.x = attrib.vertices[3 * index.vertex_index + 0];
+            vertex.y = attrib.vertices[3 * index.vertex_index + 1];
+            vertex.z = attrib.vertices[3 * index.vertex_index + 2];
 
-                // to do : add normals and try phong shading
+            // to do : add normals and try phong shading
 
-                vertex.u = attrib.texcoords[2 * index.texcoord_index + 0];
-                vertex.v = attrib.texcoords[2 * index.texcoord_index + 1];
+            vertex.u = attrib.texcoords[2 * index.texcoord_index + 0];
+            vertex.v = attrib.texcoords[2 * index.texcoord_index + 1];
 
-                _model_vertices.push_back(vertex);
-            }
+            vertices.push_back(vertex);
         }
-        printf("Model mesh loaded!\n");
-        return 0;
     }
+    return 0;
+}
+
+// replaces the geometry of an existing mesh, the VAO stays the same
+void Mesh::setGeometry(std::vector<shapes::vertex> &&vertices, std::vector<uint32_t> &&indices)
+{
+    _model_vertices = std::move(vertices);
+    _indices = std::move(indices);
+    upload_geometry();
+}
+
+// blobs are already welded and in GL layout, the driver copies straight out of the mapping
+void Mesh::setGeometry(const cooked_mesh_t &mesh, const unsigned char *file_base)
+{
+    _model_vertices.clear();
+    _indices.clear();
+
+    GLStateCache::get().bindVertexArray(_VAO);
+    GLStateCache::get().bindBuffer(GL_ARRAY_BUFFER, _VBO);
+    glBufferData(GL_ARRAY_BUFFER, mesh.vertex_count * sizeof(shapes::vertex), file_base + mesh.vertex_offset, GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.index_count * mesh.index_size, file_base + mesh.index_offset, GL_STATIC_DRAW);
+
+    _index_type = mesh.index_size == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    _index_count = (GLsizei)mesh.index_count;
+}
+
+Mesh &Mesh::sharedQuad()
+{
+    static Mesh quad(QUAD);
+    return quad;
+}
+
+void Mesh::draw()
+{
+    GLStateCache::get().bindVertexArray(_VAO);
+    glDrawElements(GL_TRIANGLES, _index_count, _index_type, (void *)0);
+}
+
+// every instance of the buffer in one draw, with _vertex_instanced.vs / _vertex_model_instanced.vs
+void Mesh::drawInstanced(const InstanceBuffer &instances)
+{
+    if (instances.getCount() == 0)
+    {
+        return;
+    }
+    GLStateCache::get().bindVertexArray(_VAO);
+    // a few attribute calls per draw, the same mesh can be drawn from several buffers
+    instances.bindAttributes();
+    glDrawElementsInstanced(GL_TRIANGLES, _index_count, _index_type, (void *)0, (GLsizei)instances.getCount());
+}
+
+// _model_vertices / _indices -> buffers of this mesh's VAO
+void Mesh::upload_geometry()
+{
+    GLStateCache::get().bindVertexArray(_VAO);
+    GLStateCache::get().bindBuffer(GL_ARRAY_BUFFER, _VBO);
+    size_t array_size = sizeof(shapes::vertex) * _model_vertices.size();
+    glBufferData(GL_ARRAY_BUFFER, array_size, _model_vertices.data(), GL_STATIC_DRAW);
+
+    _index_type = upload_index_buffer(_indices);
+    _index_count = (GLsizei)_indices.size();
 }
 
 // todo: configure component-choice (pos, tex, normals, bi-normals etc)
@@ -390,13 +422,13 @@ void Mesh::set_vertex_attrib_config()
 {
     // Bookmark
     glGenVertexArrays(1, &_VAO);
-    glBindVertexArray(_VAO);
+    GLStateCache::get().bindVertexArray(_VAO);
 
-    // VBO memory
+    // VBO + EBO, filled by upload_geometry() / setGeometry()
     glGenBuffers(1, &_VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, _VBO);
-    size_t array_size = sizeof(_model_vertices[0]) * _model_vertices.size();
-    glBufferData(GL_ARRAY_BUFFER, array_size, _model_vertices.data(), GL_STATIC_DRAW);
+    GLStateCache::get().bindBuffer(GL_ARRAY_BUFFER, _VBO);
+    glGenBuffers(1, &_EBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _EBO);
 
     // Position
     glVertexAttribPointer(
@@ -419,250 +451,160 @@ void Mesh::set_vertex_attrib_config()
     glEnableVertexAttribArray(1);
 
     // Disable VAO
-    glBindVertexArray(0);
+    GLStateCache::get().bindVertexArray(0);
 }
 
 /* === Actor class definitions === */
 
-Actor::Actor()
-    : _pos(0.0f), _vel(0.0f), Mesh::Mesh(QUAD)
+Actor::Actor(Registry &registry)
+    : _registry(registry), _entity(registry.create())
 {
+    _name[0] = '\0';
+    _registry.addTransform(_entity, glm::vec3(0.0f), glm::vec2(1.0f));
+    _registry.addVelocity(_entity, glm::vec3(0.0f), glm::vec3(0.0f));
 }
 
-void Actor::setScale(glm::vec3 scale)
+Actor::~Actor()
 {
-    _scale_mat = glm::scale(glm::mat4(1.0f), scale);
+    _registry.destroy(_entity);
 }
 
-void Actor::setAcceleration(glm::vec3 acceleration)
+entity_t Actor::getEntity() const
 {
-    _acceleration = acceleration;
+    return _entity;
 }
 
-void Actor::setName(std::string name)
+void Actor::setPosition(glm::vec3 position)
 {
-    _name = name;
+    transform_pool_t &transforms = _registry.getTransforms();
+    uint32_t slot = transforms.set.indexOf(_entity);
+    transforms.x[slot] = transforms.prev_x[slot] = position.x;
+    transforms.y[slot] = transforms.prev_y[slot] = position.y;
+    transforms.z[slot] = transforms.prev_z[slot] = position.z;
+
+    // CollisionWorld trusts the floor bit of a body that didn't move
+    collider_pool_t &colliders = _registry.getColliders();
+    if (colliders.set.contains(_entity))
+    {
+        colliders.contacts[colliders.set.indexOf(_entity)] &= ~CONTACT_FLOOR;
+    }
 }
 
-/* === Character class definitions === */
-
-Character::Character()
-    : _curr_move_state(STAND), _prev_move_state(STAND), _walk_phase_index(0),
-      _frame_timer(0.0f), _current_walk_button_action(OFF),
-      _walk_L_velocity(glm::vec3(-0.2f, 0.0f, 0.0f)), _walk_R_velocity(glm::vec3(0.2f, 0.0f, 0.0f)), _jump_velocity(glm::vec3(0.0f, 2.5f, 0.0f))
+glm::vec3 Actor::getPosition() const
 {
-    Actor::setName("Character_Actor");
-    Actor::setAcceleration(glm::vec3(0.0f, -9.81f / 2, 0.0f));
-    Actor::setScale(glm::vec3(0.05f, 0.05f, 0.05f));
-
-    std::cout << "Created: " << _name << "\n";
+    transform_pool_t &transforms = _registry.getTransforms();
+    uint32_t slot = transforms.set.indexOf(_entity);
+    return glm::vec3(transforms.x[slot], transforms.y[slot], transforms.z[slot]);
 }
 
-void Character::updateMovementState(button_action_t button_action, double dt)
+// sprites are drawn around their center, scale is the half extent of the unit quad
+void Actor::setScale(glm::vec3 scale)
 {
+    transform_pool_t &transforms = _registry.getTransforms();
+    uint32_t slot = transforms.set.indexOf(_entity);
+    transforms.half_w[slot] = scale.x;
+    transforms.half_h[slot] = scale.y;
+}
 
-    // button_action_t current_walk_button_action;
+void Actor::setAcceleration(glm::vec3 acceleration)
+{
+    transform_pool_t &transforms = _registry.getTransforms();
+    velocity_pool_t &velocities = _registry.getVelocities();
+    uint32_t slot = transforms.set.indexOf(_entity);
+    velocities.ax[slot] = acceleration.x;
+    velocities.ay[slot] = acceleration.y;
+    velocities.az[slot] = acceleration.z;
+}
 
-    if (_current_walk_button_action != button_action)
+void Actor::setCollider(glm::vec2 half_size)
+{
+    collider_pool_t &colliders = _registry.getColliders();
+    if (!colliders.set.contains(_entity))
     {
-        switch (button_action)
-        {
-        case LEFTP:
-            _current_walk_button_action = LEFTP;
-            break;
-        case LEFTR:
-            _current_walk_button_action = LEFTR;
-            break;
-        case RIGHTP:
-            _current_walk_button_action = RIGHTP;
-            break;
-        case RIGHTR:
-            _current_walk_button_action = RIGHTR;
-            break;
-        }
+        _registry.addCollider(_entity, half_size);
+        return;
     }
+    uint32_t slot = colliders.set.indexOf(_entity);
+    colliders.half_w[slot] = half_size.x;
+    colliders.half_h[slot] = half_size.y;
+}
 
-    movement_state_t new_move_state = get_state_transition(button_action); // consult table
-
-    // same state
-    if (new_move_state == _curr_move_state)
-    {
-        // std::cout << " new_move_state == _curr_move_state \n";
-        switch (_curr_move_state)
-        {
-        case STAND:
-            _vel = glm::vec3(0.0f, 0.0f, 0.0f);
-            break;
-        case WALK_L:
-        case WALK_R:
-            _frame_timer += dt;
-            if (_frame_timer > _walk_phase_interval)
-            {
-                _frame_timer = 0.0f;
-                _walk_phase_index++;
-                if (_walk_phase_index > _num_walk_phases)
-                {
-                    _walk_phase_index = 0;
-                }
-            }
-            // Physics
-            _pos = _pos + glm::vec3(_vel.x * dt, _vel.y * dt, _vel.z * dt);
-            break;
-        case JUMP_UP:
-        case JUMP_L:
-        case JUMP_R:
-            _pos = _pos + glm::vec3(_vel.x * dt, _vel.y * dt, _vel.z * dt);
-            _vel = _vel + glm::vec3(_acceleration.x * dt, _acceleration.y * dt, _acceleration.z * dt);
-
-            if (_vel.y < 0.0f)
-            {
-                _curr_move_state = FALL;
-            }
-            break;
-        case FALL:
-            _pos = _pos + glm::vec3(_vel.x * dt, _vel.y * dt, _vel.z * dt);
-            _vel = _vel + glm::vec3(_acceleration.x * dt, _acceleration.y * dt, _acceleration.z * dt);
-
-            if (_pos.y < 0.0f) // initial position
-            {
-                _pos.y = 0.0f;
-
-                if (_current_walk_button_action == LEFTP)
-                {
-                    _curr_move_state = WALK_L;
-                    _vel = _walk_L_velocity;
-                }
-                else if (_current_walk_button_action == RIGHTP)
-                {
-                    _curr_move_state = WALK_R;
-                    _vel = _walk_R_velocity;
-                }
-                else
-                {
-                    _curr_move_state = STAND;
-                    _vel = glm::vec3(0.0f, 0.0f, 0.0f);
-                }
-            }
-            break;
-        case DUCK:
-            _vel = glm::vec3(0.0f, 0.0f, 0.0f);
-        }
-    }
-    // new, initial state state
-    else
-    {
-        _curr_move_state = new_move_state;
-        switch (new_move_state)
-        {
-        case STAND:
-            _vel = glm::vec3(0.0f, 0.0f, 0.0f);
-            break;
-        case WALK_L:
-            _frame_timer = 0.0f;
-            _walk_phase_index = 0;
-            _vel = _walk_L_velocity;
-            break;
-        case WALK_R:
-            _frame_timer = 0.0f;
-            _walk_phase_index = 0;
-            _vel = _walk_R_velocity;
-            break;
-        case JUMP_UP:
-            _vel = _jump_velocity;
-            break;
-        case JUMP_L:
-            _vel = _jump_velocity + _walk_L_velocity;
-            break;
-        case JUMP_R:
-            _vel = _jump_velocity + _walk_R_velocity;
-            break;
-        case DUCK:
-            _vel = glm::vec3(0.0f, 0.0f, 0.0f);
-        }
-    }
+void Actor::setName(const char *name)
+{
+    snprintf(_name, sizeof(_name), "%s", name);
 }
 
-// note: use STAND sprite for jump/fall for now
-void Character::draw(Shader &shader, const std::vector<Texture2D *> &walk_textures,
-                     const Texture2D &jump_texture,
-                     const Texture2D &fall_texture,
-                     const Texture2D &duck_texture)
+/* === Character class definitions === */
+
+Character::Character(Registry &registry)
+    : Actor(registry)
 {
-    shader.activate();
+    Actor::setName("Character_Actor");
+    Actor::setScale(glm::vec3(0.05f, 0.05f, 0.05f));
+    Actor::setCollider(glm::vec2(0.03f, 0.05f)); // narrower than the sprite, feet at its bottom edge
+
+    movement_profile_t profile;
+    profile.walk_L_velocity = glm::vec3(-0.2f, 0.0f, 0.0f);
+    profile.walk_R_velocity = glm::vec3(0.2f, 0.0f, 0.0f);
+    profile.jump_velocity = glm::vec3(0.0f, 2.5f, 0.0f);
+    profile.gravity = glm::vec3(0.0f, -9.81f / 2, 0.0f);
+    profile.ground_height = 0.0f; // initial position
+    _movement_profile = _registry.addMovementProfile(profile);
+
+    // untextured until clips are assigned
+    animation_set_t clips;
+    for (int i = 0; i < NUM_MOVEMENT_STATES; i++)
+    {
+        clips.clips[i] = CLIP_NONE;
+    }
+    _animation_set = _registry.addAnimationSet(clips);
 
-    // set transforms based on integrated position and the quad scale
-    glm::mat4 model_m = glm::translate(glm::mat4(1.0f), _pos) * _scale_mat;
-    shader.setMatrix("model", glm::value_ptr(model_m));
+    _registry.addMovement(_entity, _movement_profile);
+    _registry.addSprite(_entity, _animation_set, 1);
 
-    activateAnimationTexture(shader, walk_textures, jump_texture, fall_texture, duck_texture);
+    std::cout << "Created: " << _name << "\n";
+}
 
-    // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE); // Debug
-    glBindVertexArray(_VAO);
-    glDrawArrays(GL_TRIANGLES, 0, _model_vertices.size());
-    glBindVertexArray(0);
+// latest button action, consumed by movementInputSystem on the next tick
+void Character::setInput(button_action_t button_action)
+{
+    movement_pool_t &movement = _registry.getMovement();
+    movement.input[movement.set.indexOf(_entity)] = (uint8_t)button_action;
 }
 
-void Character::activateAnimationTexture(Shader &shader, const std::vector<Texture2D *> &walk_textures,
-                                         const Texture2D &jump_texture, const Texture2D &fall_texture,
-                                         const Texture2D &duck_texture)
+// clips are named "<prefix>/<clip>", e.g. "gary/walk_left", see animations/*.anim
+void Character::setAnimations(const AnimationLibrary &animations, const std::string &prefix)
 {
-    glActiveTexture(GL_TEXTURE0);
-    switch (_curr_move_state)
+    static const char *clip_names[NUM_MOVEMENT_STATES] = {
+        "stand", "walk_left", "walk_right", "jump", "fall", "jump", "jump", "duck"};
+
+    animation_set_t &set = _registry.getAnimationSet(_animation_set);
+    for (int i = 0; i < NUM_MOVEMENT_STATES; i++)
     {
-    case STAND:
-        glBindTexture(GL_TEXTURE_2D, (*walk_textures[idle]).getTextureID());
-        break;
-    case WALK_L:
-        setWalkPhaseTexture(left, walk_textures);
-        shader.setBool("invert", false);
-        break;
-    case WALK_R:
-        setWalkPhaseTexture(right, walk_textures);
-        shader.setBool("invert", true);
-        break;
-    case JUMP_UP:
-        glBindTexture(GL_TEXTURE_2D, jump_texture.getTextureID());
-        break;
-    case FALL:
-        glBindTexture(GL_TEXTURE_2D, fall_texture.getTextureID());
-        break;
-    case JUMP_L:
-        glBindTexture(GL_TEXTURE_2D, jump_texture.getTextureID());
-        break;
-    case JUMP_R:
-        glBindTexture(GL_TEXTURE_2D, jump_texture.getTextureID());
-        break;
-    case DUCK:
-        glBindTexture(GL_TEXTURE_2D, duck_texture.getTextureID());
-        break;
+        set.clips[i] = animations.find(prefix + "/" + clip_names[i]);
     }
 }
 
-void Character::setWalkPhaseTexture(walk_dir_t dir, const std::vector<Texture2D *> &walk_textures)
+/* === Projectile class definitions === */
+
+Projectile::Projectile(Registry &registry, glm::vec3 position, glm::vec3 velocity, float lifetime)
+    : Actor(registry), _lifetime(lifetime)
 {
-    switch (_walk_sequence[dir][_walk_phase_index])
-    {
-    case idle:
-        glBindTexture(GL_TEXTURE_2D, (*walk_textures[idle]).getTextureID());
-        break;
-    case left1:
-        glBindTexture(GL_TEXTURE_2D, (*walk_textures[left1]).getTextureID());
-        break;
-    case left2:
-        glBindTexture(GL_TEXTURE_2D, (*walk_textures[left2]).getTextureID());
-        break;
-    case right1:
-        glBindTexture(GL_TEXTURE_2D, (*walk_textures[right1]).getTextureID());
-        break;
-    case right2:
-        glBindTexture(GL_TEXTURE_2D, (*walk_textures[right2]).getTextureID());
-        break;
-    }
+    Actor::setPosition(position);
+
+    // velocity columns are slot aligned with the transforms
+    transform_pool_t &transforms = _registry.getTransforms();
+    velocity_pool_t &velocities = _registry.getVelocities();
+    uint32_t slot = transforms.set.indexOf(_entity);
+    velocities.vx[slot] = velocity.x;
+    velocities.vy[slot] = velocity.y;
+    velocities.vz[slot] = velocity.z;
 }
 
-movement_state_t Character::get_state_transition(button_action_t button_action)
+bool Projectile::update(float dt)
 {
-    return input_transitions[button_action][_curr_move_state];
+    _lifetime -= dt;
+    return _lifetime > 0.0f;
 }
 
 // set last button state for every object in queue
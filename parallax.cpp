@@ -0,0 +1,209 @@
+#include "parallax.h"
+#include "glStateCache.h"
+#include "stb/stb_image.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+bool PARALLAX_DBG = false;
+
+ParallaxBackground::ParallaxBackground()
+    : _built_layers(0), _texture(0), _VAO(0), _uniform_shader(nullptr)
+{
+    for (glm::vec2 &offset : _offsets)
+    {
+        offset = glm::vec2(0.0f);
+    }
+}
+
+ParallaxBackground::~ParallaxBackground()
+{
+    if (_texture)
+    {
+        GLStateCache::get().forgetTexture(_texture);
+        glDeleteTextures(1, &_texture);
+    }
+    if (_VAO)
+    {
+        GLStateCache::get().forgetVertexArray(_VAO);
+        glDeleteVertexArrays(1, &_VAO);
+    }
+}
+
+int ParallaxBackground::addLayer(const std::string &image_path, glm::vec2 scroll_factor, glm::vec2 drift)
+{
+    if (_layers.size() >= PARALLAX_MAX_LAYERS)
+    {
+        printf("Parallax: more than %d layers, %s dropped\n", PARALLAX_MAX_LAYERS, image_path.c_str());
+        return -1;
+    }
+    _layers.push_back(layer_t{image_path, scroll_factor, drift});
+    return (int)_layers.size() - 1;
+}
+
+bool ParallaxBackground::load(const std::string &path)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        printf("Parallax: could not open %s\n", path.c_str());
+        return false;
+    }
+
+    bool ok = true;
+    char line[512];
+    int line_number = 0;
+    while (ok && fgets(line, sizeof(line), file))
+    {
+        line_number++;
+        char *comment = strchr(line, '#');
+        if (comment)
+        {
+            *comment = '\0';
+        }
+
+        char keyword[16], image[256];
+        glm::vec2 factor(0.0f);
+        glm::vec2 drift(0.0f);
+        if (sscanf(line, "%15s", keyword) != 1)
+        {
+            continue;
+        }
+        if (strcmp(keyword, "layer") != 0 ||
+            sscanf(line, "%*s %255s %f %f %f %f", image, &factor.x, &factor.y, &drift.x, &drift.y) < 3)
+        {
+            printf("Parallax: %s:%d not understood\n", path.c_str(), line_number);
+            ok = false;
+            break;
+        }
+        addLayer(image, factor, drift);
+    }
+    fclose(file);
+
+    return ok && build();
+}
+
+bool ParallaxBackground::build()
+{
+    if (_layers.empty())
+    {
+        return false;
+    }
+
+    // same orientation as Texture2D, bottom row first
+    stbi_set_flip_vertically_on_load(true);
+
+    int width = 0, height = 0;
+    std::vector<unsigned char> slices;
+    for (size_t i = 0; i < _layers.size(); i++)
+    {
+        int w, h, channels;
+        unsigned char *pixels = stbi_load(_layers[i].image_path.c_str(), &w, &h, &channels, 4);
+        if (!pixels)
+        {
+            printf("Parallax: failed to load %s\n", _layers[i].image_path.c_str());
+            return false;
+        }
+
+        if (i == 0)
+        {
+            width = w;
+            height = h;
+            slices.resize((size_t)width * height * 4 * _layers.size());
+        }
+
+        unsigned char *slice = slices.data() + (size_t)width * height * 4 * i;
+        if (w == width && h == height)
+        {
+            memcpy(slice, pixels, (size_t)width * height * 4);
+        }
+        else
+        {
+            printf("Parallax: %s is %dx%d, resampled to %dx%d\n", _layers[i].image_path.c_str(), w, h, width, height);
+            for (int y = 0; y < height; y++)
+            {
+                int sy = (int)((int64_t)y * h / height);
+                for (int x = 0; x < width; x++)
+                {
+                    int sx = (int)((int64_t)x * w / width);
+                    memcpy(slice + ((size_t)y * width + x) * 4, pixels + ((size_t)sy * w + sx) * 4, 4);
+                }
+            }
+        }
+        stbi_image_free(pixels);
+    }
+
+    if (!_texture)
+    {
+        glGenTextures(1, &_texture);
+        glGenVertexArrays(1, &_VAO);
+    }
+    GLStateCache::get().bindTexture(GL_TEXTURE_2D_ARRAY, _texture, 0);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, (GLsizei)_layers.size(), 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                 slices.data());
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+    _built_layers = (int)_layers.size();
+    printf("Parallax: %d layers of %dx%d\n", _built_layers, width, height);
+    return true;
+}
+
+void ParallaxBackground::setScrollFactor(int layer, glm::vec2 scroll_factor)
+{
+    if (layer >= 0 && layer < (int)_layers.size())
+    {
+        _layers[layer].scroll_factor = scroll_factor;
+    }
+}
+
+int ParallaxBackground::getLayerCount() const
+{
+    return (int)_layers.size();
+}
+
+void ParallaxBackground::draw(Shader &shader, const glm::vec4 &view_rect, double time)
+{
+    if (_built_layers == 0)
+    {
+        return;
+    }
+
+    // camera movement in screens, one screen scrolls a factor 1 layer by its full width
+    glm::vec2 view_size(view_rect.z - view_rect.x, view_rect.w - view_rect.y);
+    glm::vec2 view_center(0.5f * (view_rect.x + view_rect.z), 0.5f * (view_rect.y + view_rect.w));
+    for (int i = 0; i < _built_layers; i++)
+    {
+        glm::vec2 offset = view_center / view_size * _layers[i].scroll_factor + _layers[i].drift * (float)time;
+        // keeps the uv small, float precision on the wrapped coordinate would drift after a while
+        offset.x -= std::floor(offset.x);
+        _offsets[i] = offset;
+    }
+
+    if (&shader != _uniform_shader)
+    {
+        _uniform_shader = &shader;
+        _layers_uniform = shader.getUniform<int>("layers");
+        _layer_count_uniform = shader.getUniform<int>("layerCount");
+        _layer_offset_uniform = shader.getUniform<glm::vec2>("layerOffset");
+    }
+    shader.activate();
+    _layers_uniform.set(0);
+    _layer_count_uniform.set(_built_layers);
+    _layer_offset_uniform.setArray(_offsets, _built_layers);
+
+    GLStateCache::get().bindTexture(GL_TEXTURE_2D_ARRAY, _texture, 0);
+    GLStateCache::get().bindVertexArray(_VAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    if (PARALLAX_DBG)
+    {
+        printf("Parallax: %d layers, front offset %.3f %.3f\n", _built_layers, _offsets[_built_layers - 1].x,
+               _offsets[_built_layers - 1].y);
+    }
+}
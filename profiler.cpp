@@ -0,0 +1,374 @@
+#include "profiler.h"
+#include "spriteBatch.h"
+#include "shader.h"
+#include "glStateCache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+bool PROFILER_DBG = false;
+
+static uint64_t steady_ns()
+{
+    using namespace std::chrono;
+    return (uint64_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// names come from string literals and setThreadName(), only quotes and backslashes need care
+static void write_json_string(FILE *file, const char *text)
+{
+    fputc('"', file);
+    for (const char *c = text; *c; c++)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            fputc('\\', file);
+        }
+        fputc((unsigned char)*c < 0x20 ? ' ' : *c, file);
+    }
+    fputc('"', file);
+}
+
+Profiler &Profiler::get()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler()
+    : _epoch_ns(steady_ns()), _frame(0), _frame_begin_ns(0), _num_passes(0),
+      _active_pass(nullptr), _history_head(0), _white_texture(0)
+{
+    memset(_passes, 0, sizeof(_passes));
+    memset(_history, 0, sizeof(_history));
+    _gpu_ring = createRing("GPU");
+}
+
+Profiler::~Profiler()
+{
+    // GL objects are gone with the context by now, see shutdown()
+    for (profile_thread_t *ring : _threads)
+    {
+        delete ring;
+    }
+}
+
+profile_thread_t *Profiler::createRing(const std::string &name)
+{
+    profile_thread_t *ring = new profile_thread_t();
+    std::lock_guard<std::mutex> lock(_threads_mutex);
+    ring->id = (uint32_t)_threads.size();
+    ring->name = name.empty() ? "thread " + std::to_string(ring->id) : name;
+    _threads.push_back(ring);
+    return ring;
+}
+
+profile_thread_t &Profiler::threadRing()
+{
+    // rings outlive their threads so the trace still shows finished workers
+    thread_local profile_thread_t *ring = nullptr;
+    if (!ring)
+    {
+        ring = createRing("");
+    }
+    return *ring;
+}
+
+void Profiler::setThreadName(const std::string &name)
+{
+    profile_thread_t &ring = threadRing();
+    std::lock_guard<std::mutex> lock(_threads_mutex);
+    ring.name = name;
+}
+
+uint64_t Profiler::now() const
+{
+    return steady_ns() - _epoch_ns;
+}
+
+void Profiler::record(const char *name, uint64_t begin_ns, uint64_t end_ns)
+{
+    profile_thread_t &ring = threadRing();
+    uint64_t index = ring.written.load(std::memory_order_relaxed);
+    ring.events[index % PROFILER_RING_SIZE] = profile_event_t{name, begin_ns, end_ns};
+    ring.written.store(index + 1, std::memory_order_release);
+}
+
+// ---- GPU passes ----
+
+gpu_pass_t *Profiler::findPass(const char *name)
+{
+    for (int i = 0; i < _num_passes; i++)
+    {
+        // literals usually share an address, the strcmp covers the rest
+        if (_passes[i].name == name || strcmp(_passes[i].name, name) == 0)
+        {
+            return &_passes[i];
+        }
+    }
+    if (_num_passes == PROFILER_MAX_GPU_PASSES)
+    {
+        if (PROFILER_DBG)
+        {
+            printf("Profiler: no GPU pass left for %s\n", name);
+        }
+        return nullptr;
+    }
+
+    gpu_pass_t &pass = _passes[_num_passes++];
+    pass.name = name;
+    glGenQueries(PROFILER_GPU_LATENCY, pass.queries);
+    return &pass;
+}
+
+void Profiler::gpuBegin(const char *name)
+{
+    _active_pass = nullptr;
+    gpu_pass_t *pass = findPass(name);
+    if (!pass)
+    {
+        return;
+    }
+
+    // the slot of PROFILER_GPU_LATENCY frames ago: if the GPU is still behind
+    // this pass goes unmeasured for a frame instead of waiting on the query
+    int slot = (int)(_frame % PROFILER_GPU_LATENCY);
+    if (pass->issued_frame[slot] != 0)
+    {
+        if (PROFILER_DBG)
+        {
+            printf("Profiler: %s query still pending, skipped\n", name);
+        }
+        return;
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, pass->queries[slot]);
+    pass->issued_frame[slot] = _frame;
+    pass->cpu_begin_ns[slot] = now();
+    _active_pass = pass;
+}
+
+void Profiler::gpuEnd()
+{
+    if (!_active_pass)
+    {
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    _active_pass = nullptr;
+}
+
+void Profiler::collectGpuResults()
+{
+    for (int i = 0; i < _num_passes; i++)
+    {
+        gpu_pass_t &pass = _passes[i];
+        for (int slot = 0; slot < PROFILER_GPU_LATENCY; slot++)
+        {
+            if (pass.issued_frame[slot] == 0)
+            {
+                continue;
+            }
+
+            GLint available = 0;
+            glGetQueryObjectiv(pass.queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+            {
+                continue;
+            }
+
+            GLuint64 elapsed_ns = 0;
+            glGetQueryObjectui64v(pass.queries[slot], GL_QUERY_RESULT, &elapsed_ns);
+            pass.issued_frame[slot] = 0;
+            pass.last_ms = (float)(elapsed_ns / 1.0e6);
+
+            // render thread is the only writer of the GPU track
+            uint64_t index = _gpu_ring->written.load(std::memory_order_relaxed);
+            uint64_t begin = pass.cpu_begin_ns[slot];
+            _gpu_ring->events[index % PROFILER_RING_SIZE] = profile_event_t{pass.name, begin, begin + elapsed_ns};
+            _gpu_ring->written.store(index + 1, std::memory_order_release);
+        }
+    }
+}
+
+// ---- Frames ----
+
+void Profiler::beginFrame()
+{
+    uint64_t frame_begin = now();
+    collectGpuResults();
+
+    if (_frame > 0)
+    {
+        profiler_frame_t &entry = _history[_history_head];
+        entry.cpu_ms = (float)((frame_begin - _frame_begin_ns) / 1.0e6);
+        entry.gpu_ms = 0.0f;
+        for (int i = 0; i < _num_passes; i++)
+        {
+            entry.gpu_ms += _passes[i].last_ms;
+        }
+        _history_head = (_history_head + 1) % PROFILER_HISTORY;
+        record("frame", _frame_begin_ns, frame_begin);
+    }
+
+    _frame_begin_ns = frame_begin;
+    _frame++;
+}
+
+float Profiler::getPassMs(const char *name) const
+{
+    for (int i = 0; i < _num_passes; i++)
+    {
+        if (strcmp(_passes[i].name, name) == 0)
+        {
+            return _passes[i].last_ms;
+        }
+    }
+    return 0.0f;
+}
+
+const profiler_frame_t &Profiler::getLastFrame() const
+{
+    return _history[(_history_head + PROFILER_HISTORY - 1) % PROFILER_HISTORY];
+}
+
+// ---- Graph ----
+
+void Profiler::drawGraph(SpriteBatch &batch, Shader &shader, const glm::vec4 &rect, float budget_ms)
+{
+    if (_white_texture == 0)
+    {
+        const uint32_t white = 0xFFFFFFFF;
+        glGenTextures(1, &_white_texture);
+        GLStateCache::get().bindTexture(GL_TEXTURE_2D, _white_texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, &white);
+    }
+
+    const uint8_t layer = 255;
+    float width = rect.z - rect.x;
+    float height = rect.w - rect.y;
+    float bar_half = width / PROFILER_HISTORY * 0.5f;
+    // the graph tops out at two budgets, anything above is clipped
+    float ms_to_height = height / (2.0f * budget_ms);
+
+    Sprite sprite;
+    sprite.uv_rect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+    sprite.flip = false;
+    sprite.alpha_mode = ALPHA_OPAQUE; // solid rects, they hide the scene behind without shading it
+
+    sprite.position = glm::vec3(rect.x + width * 0.5f, rect.y + height * 0.5f, 0.0f);
+    sprite.half_size = glm::vec2(width * 0.5f, height * 0.5f);
+    sprite.tint = packColor(glm::vec4(0.1f, 0.1f, 0.1f, 1.0f));
+    batch.draw(shader, _white_texture, sprite, layer);
+
+    uint32_t green = packColor(glm::vec4(0.2f, 0.8f, 0.2f, 1.0f));
+    uint32_t yellow = packColor(glm::vec4(0.9f, 0.8f, 0.1f, 1.0f));
+    uint32_t red = packColor(glm::vec4(0.9f, 0.2f, 0.1f, 1.0f));
+    uint32_t gpu = packColor(glm::vec4(0.3f, 0.5f, 1.0f, 1.0f));
+
+    // oldest frame on the left
+    for (int i = 0; i < PROFILER_HISTORY; i++)
+    {
+        const profiler_frame_t &frame = _history[(_history_head + i) % PROFILER_HISTORY];
+        if (frame.cpu_ms <= 0.0f)
+        {
+            continue;
+        }
+        float x = rect.x + (i * 2 + 1) * bar_half;
+
+        float bar = frame.cpu_ms * ms_to_height;
+        bar = bar > height ? height : bar;
+        sprite.position = glm::vec3(x, rect.y + bar * 0.5f, 0.0f);
+        sprite.half_size = glm::vec2(bar_half * 0.8f, bar * 0.5f);
+        sprite.tint = frame.cpu_ms <= budget_ms ? green : (frame.cpu_ms <= 2.0f * budget_ms ? yellow : red);
+        batch.draw(shader, _white_texture, sprite, layer);
+
+        // GPU time as a thin bar on top of the frame bar
+        float gpu_bar = frame.gpu_ms * ms_to_height;
+        gpu_bar = gpu_bar > height ? height : gpu_bar;
+        sprite.position = glm::vec3(x, rect.y + gpu_bar * 0.5f, 0.0f);
+        sprite.half_size = glm::vec2(bar_half * 0.3f, gpu_bar * 0.5f);
+        sprite.tint = gpu;
+        batch.draw(shader, _white_texture, sprite, layer);
+    }
+
+    // budget line
+    sprite.position = glm::vec3(rect.x + width * 0.5f, rect.y + budget_ms * ms_to_height, 0.0f);
+    sprite.half_size = glm::vec2(width * 0.5f, height * 0.005f);
+    sprite.tint = packColor(glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
+    batch.draw(shader, _white_texture, sprite, layer);
+}
+
+// ---- Export ----
+
+bool Profiler::exportChromeTrace(const std::string &path)
+{
+    FILE *file = fopen(path.c_str(), "w");
+    if (!file)
+    {
+        printf("Profiler: could not open %s\n", path.c_str());
+        return false;
+    }
+
+    std::vector<profile_event_t> events;
+    size_t total = 0;
+    bool first = true;
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    std::lock_guard<std::mutex> lock(_threads_mutex);
+    for (profile_thread_t *ring : _threads)
+    {
+        // copy a window, then drop what the writer may have overwritten meanwhile
+        uint64_t end = ring->written.load(std::memory_order_acquire);
+        uint64_t begin = end > PROFILER_RING_SIZE ? end - PROFILER_RING_SIZE : 0;
+        events.clear();
+        for (uint64_t i = begin; i < end; i++)
+        {
+            events.push_back(ring->events[i % PROFILER_RING_SIZE]);
+        }
+        uint64_t after = ring->written.load(std::memory_order_acquire);
+        uint64_t safe = after >= PROFILER_RING_SIZE ? after - PROFILER_RING_SIZE + 1 : 0;
+        size_t skip = safe > begin ? (size_t)(safe - begin) : 0;
+
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", first ? "" : ",\n", ring->id);
+        write_json_string(file, ring->name.c_str());
+        fprintf(file, "}}");
+        first = false;
+
+        for (size_t i = skip; i < events.size(); i++)
+        {
+            const profile_event_t &event = events[i];
+            fprintf(file, ",\n{\"name\":");
+            write_json_string(file, event.name);
+            fprintf(file, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+                    ring == _gpu_ring ? "gpu" : "cpu", event.begin_ns / 1000.0,
+                    (event.end_ns - event.begin_ns) / 1000.0, ring->id);
+        }
+        total += events.size() > skip ? events.size() - skip : 0;
+    }
+
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    printf("Profiler: %zu events written to %s\n", total, path.c_str());
+    return true;
+}
+
+void Profiler::shutdown()
+{
+    for (int i = 0; i < _num_passes; i++)
+    {
+        glDeleteQueries(PROFILER_GPU_LATENCY, _passes[i].queries);
+        memset(_passes[i].issued_frame, 0, sizeof(_passes[i].issued_frame));
+    }
+    _num_passes = 0;
+    _active_pass = nullptr;
+    if (_white_texture != 0)
+    {
+        GLStateCache::get().forgetTexture(_white_texture);
+        glDeleteTextures(1, &_white_texture);
+        _white_texture = 0;
+    }
+}
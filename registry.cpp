@@ -0,0 +1,456 @@
+#include "registry.h"
+#include "textureUtil.h"
+
+#include <cfloat>
+#include <cstdio>
+#include <utility>
+
+// ---------------------------------- SparseSet ------------------------------------------
+
+static const uint32_t NO_SLOT = ~0u;
+
+bool SparseSet::contains(entity_t entity) const
+{
+    uint32_t index = entity & ENTITY_INDEX_MASK;
+    return index < _sparse.size() && _sparse[index] != NO_SLOT && _dense[_sparse[index]] == entity;
+}
+
+uint32_t SparseSet::indexOf(entity_t entity) const
+{
+    return _sparse[entity & ENTITY_INDEX_MASK];
+}
+
+uint32_t SparseSet::size() const
+{
+    return (uint32_t)_dense.size();
+}
+
+entity_t SparseSet::entityAt(uint32_t slot) const
+{
+    return _dense[slot];
+}
+
+uint32_t SparseSet::insert(entity_t entity)
+{
+    uint32_t index = entity & ENTITY_INDEX_MASK;
+    if (index >= _sparse.size())
+    {
+        _sparse.resize(index + 1, NO_SLOT);
+    }
+    _sparse[index] = (uint32_t)_dense.size();
+    _dense.push_back(entity);
+    return _sparse[index];
+}
+
+void SparseSet::reserve(uint32_t entities)
+{
+    if (_sparse.size() < entities)
+    {
+        _sparse.resize(entities, NO_SLOT);
+    }
+    _dense.reserve(entities);
+}
+
+void SparseSet::swapRemove(uint32_t slot)
+{
+    entity_t removed = _dense[slot];
+    entity_t last = _dense.back();
+    _dense[slot] = last;
+    _sparse[last & ENTITY_INDEX_MASK] = slot;
+    _sparse[removed & ENTITY_INDEX_MASK] = NO_SLOT;
+    _dense.pop_back();
+}
+
+void SparseSet::swapSlots(uint32_t a, uint32_t b)
+{
+    std::swap(_dense[a], _dense[b]);
+    _sparse[_dense[a] & ENTITY_INDEX_MASK] = a;
+    _sparse[_dense[b] & ENTITY_INDEX_MASK] = b;
+}
+
+// ----------------------------------- Columns -------------------------------------------
+
+template <typename T>
+static void swap_remove(std::vector<T> &column, uint32_t slot)
+{
+    column[slot] = column.back();
+    column.pop_back();
+}
+
+template <typename... Columns>
+static void reserve_columns(uint32_t count, Columns &...columns)
+{
+    (columns.reserve(count), ...);
+}
+
+template <typename T>
+static void swap_slots(std::vector<T> &column, uint32_t a, uint32_t b)
+{
+    std::swap(column[a], column[b]);
+}
+
+// ---------------------------------- Entities -------------------------------------------
+
+entity_t Registry::create()
+{
+    uint32_t index;
+    if (!_free_indices.empty())
+    {
+        index = _free_indices.back();
+        _free_indices.pop_back();
+    }
+    else
+    {
+        index = (uint32_t)_generations.size();
+        _generations.push_back(0);
+    }
+    _entity_count++;
+    return ((uint32_t)_generations[index] << ENTITY_INDEX_BITS) | index;
+}
+
+void Registry::destroy(entity_t entity)
+{
+    if (!alive(entity))
+    {
+        return;
+    }
+
+    removeCollider(entity);
+    removeMovement(entity);
+    removeSprite(entity);
+    removeVelocity(entity);
+    removeTransform(entity);
+
+    // stale handles to this index stop matching
+    uint32_t index = entity & ENTITY_INDEX_MASK;
+    _generations[index]++;
+    _free_indices.push_back(index);
+    _entity_count--;
+}
+
+void Registry::reserve(uint32_t entities)
+{
+    _generations.reserve(entities);
+    _free_indices.reserve(entities);
+
+    _transforms.set.reserve(entities);
+    reserve_columns(entities, _transforms.x, _transforms.y, _transforms.z, _transforms.prev_x, _transforms.prev_y,
+                    _transforms.prev_z, _transforms.half_w, _transforms.half_h);
+    reserve_columns(entities, _velocities.vx, _velocities.vy, _velocities.vz, _velocities.ax, _velocities.ay,
+                    _velocities.az, _velocities.ground);
+
+    _sprites.set.reserve(entities);
+    reserve_columns(entities, _sprites.animation_set, _sprites.clip, _sprites.clip_time, _sprites.frame,
+                    _sprites.texture, _sprites.uv_rect, _sprites.flip, _sprites.layer, _sprites.tint,
+                    _sprites.alpha_mode);
+
+    _movement.set.reserve(entities);
+    reserve_columns(entities, _movement.state, _movement.input, _movement.walk_button, _movement.profile);
+
+    _colliders.set.reserve(entities);
+    reserve_columns(entities, _colliders.half_w, _colliders.half_h, _colliders.layer, _colliders.mask,
+                    _colliders.contacts);
+}
+
+bool Registry::alive(entity_t entity) const
+{
+    uint32_t index = entity & ENTITY_INDEX_MASK;
+    return entity != NULL_ENTITY && index < _generations.size() &&
+           _generations[index] == (entity >> ENTITY_INDEX_BITS);
+}
+
+uint32_t Registry::getEntityCount() const
+{
+    return _entity_count;
+}
+
+// --------------------------------- Components ------------------------------------------
+
+void Registry::addTransform(entity_t entity, glm::vec3 position, glm::vec2 half_size)
+{
+    if (_transforms.set.contains(entity))
+    {
+        return;
+    }
+
+    _transforms.set.insert(entity);
+    _transforms.x.push_back(position.x);
+    _transforms.y.push_back(position.y);
+    _transforms.z.push_back(position.z);
+    _transforms.prev_x.push_back(position.x);
+    _transforms.prev_y.push_back(position.y);
+    _transforms.prev_z.push_back(position.z);
+    _transforms.half_w.push_back(half_size.x);
+    _transforms.half_h.push_back(half_size.y);
+}
+
+void Registry::swapTransformSlots(uint32_t a, uint32_t b)
+{
+    if (a == b)
+    {
+        return;
+    }
+    _transforms.set.swapSlots(a, b);
+    swap_slots(_transforms.x, a, b);
+    swap_slots(_transforms.y, a, b);
+    swap_slots(_transforms.z, a, b);
+    swap_slots(_transforms.prev_x, a, b);
+    swap_slots(_transforms.prev_y, a, b);
+    swap_slots(_transforms.prev_z, a, b);
+    swap_slots(_transforms.half_w, a, b);
+    swap_slots(_transforms.half_h, a, b);
+}
+
+void Registry::removeTransform(entity_t entity)
+{
+    if (!_transforms.set.contains(entity))
+    {
+        return;
+    }
+    removeVelocity(entity);
+    removeCollider(entity);
+
+    // static entities sit behind the moving partition, the last slot is static too
+    uint32_t slot = _transforms.set.indexOf(entity);
+    _transforms.set.swapRemove(slot);
+    swap_remove(_transforms.x, slot);
+    swap_remove(_transforms.y, slot);
+    swap_remove(_transforms.z, slot);
+    swap_remove(_transforms.prev_x, slot);
+    swap_remove(_transforms.prev_y, slot);
+    swap_remove(_transforms.prev_z, slot);
+    swap_remove(_transforms.half_w, slot);
+    swap_remove(_transforms.half_h, slot);
+}
+
+void Registry::addVelocity(entity_t entity, glm::vec3 velocity, glm::vec3 acceleration)
+{
+    if (!_transforms.set.contains(entity))
+    {
+        printf("Registry: velocity needs a transform, entity %08x has none\n", entity);
+        return;
+    }
+    uint32_t slot = _transforms.set.indexOf(entity);
+    if (slot < _transforms.moving_count)
+    {
+        return;
+    }
+
+    // grow the moving partition by one, the entity takes its last slot
+    swapTransformSlots(slot, _transforms.moving_count);
+    _transforms.moving_count++;
+
+    _velocities.vx.push_back(velocity.x);
+    _velocities.vy.push_back(velocity.y);
+    _velocities.vz.push_back(velocity.z);
+    _velocities.ax.push_back(acceleration.x);
+    _velocities.ay.push_back(acceleration.y);
+    _velocities.az.push_back(acceleration.z);
+
+    // nothing to land on until a movement component brings a profile, see addMovement()
+    float ground = -FLT_MAX;
+    if (_movement.set.contains(entity))
+    {
+        ground = getMovementProfile(_movement.profile[_movement.set.indexOf(entity)]).ground_height;
+    }
+    _velocities.ground.push_back(ground);
+}
+
+void Registry::removeVelocity(entity_t entity)
+{
+    if (!_transforms.set.contains(entity))
+    {
+        return;
+    }
+    uint32_t slot = _transforms.set.indexOf(entity);
+    if (slot >= _transforms.moving_count)
+    {
+        return;
+    }
+
+    // move to the end of the moving partition, then shrink it
+    uint32_t last = _transforms.moving_count - 1;
+    swapTransformSlots(slot, last);
+    swap_slots(_velocities.vx, slot, last);
+    swap_slots(_velocities.vy, slot, last);
+    swap_slots(_velocities.vz, slot, last);
+    swap_slots(_velocities.ax, slot, last);
+    swap_slots(_velocities.ay, slot, last);
+    swap_slots(_velocities.az, slot, last);
+    swap_slots(_velocities.ground, slot, last);
+
+    _velocities.vx.pop_back();
+    _velocities.vy.pop_back();
+    _velocities.vz.pop_back();
+    _velocities.ax.pop_back();
+    _velocities.ay.pop_back();
+    _velocities.az.pop_back();
+    _velocities.ground.pop_back();
+    _transforms.moving_count--;
+}
+
+void Registry::addSprite(entity_t entity, uint16_t animation_set, uint8_t layer)
+{
+    if (_sprites.set.contains(entity))
+    {
+        return;
+    }
+
+    _sprites.set.insert(entity);
+    _sprites.animation_set.push_back(animation_set);
+    _sprites.clip.push_back(_animation_sets[animation_set].clips[STAND]);
+    _sprites.clip_time.push_back(0.0f);
+    _sprites.frame.push_back(UINT32_MAX); // nothing shown yet, the first frame raises its event too
+    _sprites.texture.push_back(0);
+    _sprites.uv_rect.push_back(glm::vec4(0.0f, 0.0f, 1.0f, 1.0f));
+    _sprites.flip.push_back(0);
+    _sprites.layer.push_back(layer);
+    _sprites.tint.push_back(0xFFFFFFFF);
+    _sprites.alpha_mode.push_back(ALPHA_TEST);
+}
+
+void Registry::removeSprite(entity_t entity)
+{
+    if (!_sprites.set.contains(entity))
+    {
+        return;
+    }
+
+    uint32_t slot = _sprites.set.indexOf(entity);
+    _sprites.set.swapRemove(slot);
+    swap_remove(_sprites.animation_set, slot);
+    swap_remove(_sprites.clip, slot);
+    swap_remove(_sprites.clip_time, slot);
+    swap_remove(_sprites.frame, slot);
+    swap_remove(_sprites.texture, slot);
+    swap_remove(_sprites.uv_rect, slot);
+    swap_remove(_sprites.flip, slot);
+    swap_remove(_sprites.layer, slot);
+    swap_remove(_sprites.tint, slot);
+    swap_remove(_sprites.alpha_mode, slot);
+}
+
+void Registry::addMovement(entity_t entity, uint16_t profile)
+{
+    if (_movement.set.contains(entity))
+    {
+        return;
+    }
+
+    _movement.set.insert(entity);
+    _movement.state.push_back(STAND);
+    _movement.input.push_back(OFF);
+    _movement.walk_button.push_back(OFF);
+    _movement.profile.push_back(profile);
+
+    // the ground the resolve pass clamps to, either add order works
+    uint32_t slot = _transforms.set.contains(entity) ? _transforms.set.indexOf(entity) : NO_SLOT;
+    if (slot < _transforms.moving_count)
+    {
+        _velocities.ground[slot] = getMovementProfile(profile).ground_height;
+    }
+}
+
+void Registry::removeMovement(entity_t entity)
+{
+    if (!_movement.set.contains(entity))
+    {
+        return;
+    }
+
+    uint32_t slot = _movement.set.indexOf(entity);
+    _movement.set.swapRemove(slot);
+    swap_remove(_movement.state, slot);
+    swap_remove(_movement.input, slot);
+    swap_remove(_movement.walk_button, slot);
+    swap_remove(_movement.profile, slot);
+
+    uint32_t transform = _transforms.set.contains(entity) ? _transforms.set.indexOf(entity) : NO_SLOT;
+    if (transform < _transforms.moving_count)
+    {
+        _velocities.ground[transform] = -FLT_MAX;
+    }
+}
+
+void Registry::addCollider(entity_t entity, glm::vec2 half_size, uint8_t layer, uint8_t mask)
+{
+    if (!_transforms.set.contains(entity))
+    {
+        printf("Registry: collider needs a transform, entity %08x has none\n", entity);
+        return;
+    }
+    if (_colliders.set.contains(entity))
+    {
+        return;
+    }
+    _colliders.set.insert(entity);
+    _colliders.half_w.push_back(half_size.x);
+    _colliders.half_h.push_back(half_size.y);
+    _colliders.layer.push_back(layer);
+    _colliders.mask.push_back(mask);
+    _colliders.contacts.push_back(0);
+}
+
+void Registry::removeCollider(entity_t entity)
+{
+    if (!_colliders.set.contains(entity))
+    {
+        return;
+    }
+    uint32_t slot = _colliders.set.indexOf(entity);
+    _colliders.set.swapRemove(slot);
+    swap_remove(_colliders.half_w, slot);
+    swap_remove(_colliders.half_h, slot);
+    swap_remove(_colliders.layer, slot);
+    swap_remove(_colliders.mask, slot);
+    swap_remove(_colliders.contacts, slot);
+}
+
+// ------------------------------- Shared resources --------------------------------------
+
+uint16_t Registry::addAnimationSet(const animation_set_t &set)
+{
+    _animation_sets.push_back(set);
+    return (uint16_t)(_animation_sets.size() - 1);
+}
+
+animation_set_t &Registry::getAnimationSet(uint16_t id)
+{
+    return _animation_sets[id];
+}
+
+uint16_t Registry::addMovementProfile(const movement_profile_t &profile)
+{
+    _movement_profiles.push_back(profile);
+    return (uint16_t)(_movement_profiles.size() - 1);
+}
+
+const movement_profile_t &Registry::getMovementProfile(uint16_t id) const
+{
+    return _movement_profiles[id];
+}
+
+transform_pool_t &Registry::getTransforms()
+{
+    return _transforms;
+}
+
+velocity_pool_t &Registry::getVelocities()
+{
+    return _velocities;
+}
+
+sprite_pool_t &Registry::getSprites()
+{
+    return _sprites;
+}
+
+movement_pool_t &Registry::getMovement()
+{
+    return _movement;
+}
+
+collider_pool_t &Registry::getColliders()
+{
+    return _colliders;
+}
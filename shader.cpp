@@ -1,143 +1,481 @@
 #include "shader.h"
+#include "frameUniforms.h"
+#include "glStateCache.h"
+#include "shaderManager.h"
 
 #include <cstdint>
 #include <cstdio>
-#include <cstdlib>
 #include <cstring>
+#include <string>
+#include <unordered_map>
 
 bool SHADER_DBG = false;
 
-Shader::Shader(const char *vertexShader, const char *fragmentShader)
+// ------------------------------ Uniform names -----------------------------------------
+
+static std::unordered_map<std::string, uint32_t> uniform_name_ids;
+
+uint32_t internUniformName(const char *name)
+{
+    auto it = uniform_name_ids.find(name);
+    if (it != uniform_name_ids.end())
+    {
+        return it->second;
+    }
+    uint32_t id = (uint32_t)uniform_name_ids.size() + 1;
+    uniform_name_ids.emplace(name, id);
+    return id;
+}
+
+uint32_t lookupUniformName(const char *name)
+{
+    auto it = uniform_name_ids.find(name);
+    return it != uniform_name_ids.end() ? it->second : 0;
+}
+
+static inline uint32_t hash_name_id(uint32_t id)
+{
+    return id * 2654435761u;
+}
+
+// ------------------------------------ Shader ------------------------------------------
+
+// whole file, binary mode so the size matches what fread returns
+static bool read_source(const std::string &path, std::string &code)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        printf("Failed to open shader code %s\n", path.c_str());
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+    code.resize(size > 0 ? size : 0);
+    bool ok = size >= 0 && fread(&code[0], 1, code.size(), file) == code.size();
+    fclose(file);
+
+    if (!ok)
+    {
+        printf("Failed to read shader code %s\n", path.c_str());
+    }
+    else if (SHADER_DBG)
+    {
+        printf("%s: \n\n%s\n", path.c_str(), code.c_str());
+    }
+    return ok;
+}
+
+// defines go right after the #version line, which has to stay the first one
+static void insert_defines(std::string &code, const std::string &defines)
+{
+    if (defines.empty())
+    {
+        return;
+    }
+    size_t line_end = code.find('\n');
+    code.insert(line_end == std::string::npos ? code.size() : line_end + 1, defines);
+}
+
+// 0 if it does not compile, the log is printed
+static GLuint compile_stage(GLenum stage, const std::string &code, const std::string &path)
+{
+    GLuint id = glCreateShader(stage);
+    const GLchar *source = code.c_str();
+    glShaderSource(id, 1, &source, nullptr);
+    glCompileShader(id);
+
+    GLint success;
+    glGetShaderiv(id, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        GLchar infoLog[512];
+        glGetShaderInfoLog(id, sizeof(infoLog), NULL, infoLog);
+        printf("%s:\n%s\n\n", path.c_str(), infoLog);
+        glDeleteShader(id);
+        return 0;
+    }
+    if (SHADER_DBG)
+    {
+        printf("%s compiled.\n", path.c_str());
+    }
+    return id;
+}
+
+Shader::Shader(const char *vertexShader, const char *fragmentShader, const char *defines)
+    : shaderProgID(0), _vertex_path(vertexShader), _fragment_path(fragmentShader), _defines(defines), _table_mask(0)
+{
+    shaderProgID = build();
+    if (shaderProgID)
+    {
+        setupProgram();
+    }
+    ShaderManager::get().watch(this);
+}
+
+Shader::~Shader()
+{
+    ShaderManager::get().unwatch(this);
+    if (shaderProgID)
+    {
+        GLStateCache::get().forgetProgram(shaderProgID);
+        glDeleteProgram(shaderProgID);
+    }
+}
+
+// linked program from the binary cache or the sources, 0 on failure
+GLuint Shader::build()
+{
+    std::string vertexCode;
+    std::string fragmentCode;
+    if (!read_source(_vertex_path, vertexCode) || !read_source(_fragment_path, fragmentCode))
+    {
+        return 0;
+    }
+    insert_defines(vertexCode, _defines);
+    insert_defines(fragmentCode, _defines);
+
+    ShaderManager &manager = ShaderManager::get();
+    uint64_t key = manager.programKey(vertexCode, fragmentCode);
+    GLuint program = manager.loadProgram(key);
+    if (program)
+    {
+        printf("Program loaded from cache.\n");
+        return program;
+    }
+
+    GLuint vertexID = compile_stage(GL_VERTEX_SHADER, vertexCode, _vertex_path);
+    GLuint fragmentID = compile_stage(GL_FRAGMENT_SHADER, fragmentCode, _fragment_path);
+    if (!vertexID || !fragmentID)
+    {
+        glDeleteShader(vertexID);
+        glDeleteShader(fragmentID);
+        return 0;
+    }
+    printf("Shaders compiled.\n");
+
+    program = glCreateProgram();
+    manager.prepareProgram(program);
+    glAttachShader(program, vertexID);
+    glAttachShader(program, fragmentID);
+    glLinkProgram(program);
+    glDetachShader(program, vertexID);
+    glDetachShader(program, fragmentID);
+    glDeleteShader(vertexID);
+    glDeleteShader(fragmentID);
+
+    GLint success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        GLchar infoLog[512];
+        glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog);
+        printf("%s / %s:\n%s\n\n", _vertex_path.c_str(), _fragment_path.c_str(), infoLog);
+        glDeleteProgram(program);
+        return 0;
+    }
+    printf("Program linked.\n");
+
+    manager.storeProgram(key, program);
+    return program;
+}
+
+// block bindings are program state, a cached binary comes back with the defaults
+void Shader::setupProgram()
+{
+    reflectUniforms();
+
+    // shared per-frame camera data
+    GLuint frame_block = glGetUniformBlockIndex(shaderProgID, "FrameUniforms");
+    if (frame_block != GL_INVALID_INDEX)
+    {
+        glUniformBlockBinding(shaderProgID, frame_block, FRAME_UNIFORMS_BINDING);
+    }
+}
+
+bool Shader::reload()
+{
+    GLuint program = build();
+    if (!program)
+    {
+        return false;
+    }
+
+    if (shaderProgID)
+    {
+        GLStateCache::get().forgetProgram(shaderProgID);
+        glDeleteProgram(shaderProgID);
+    }
+    shaderProgID = program;
+    setupProgram();
+    restoreUniforms();
+    return true;
+}
+
+void Shader::activate()
+{
+    GLStateCache::get().useProgram(shaderProgID);
+}
+
+GLuint Shader::getProgramID() const
+{
+    return shaderProgID;
+}
+
+const std::string &Shader::getVertexPath() const
 {
-    // Load vertex shader code
-    GLchar *vertexCode = nullptr;
-    GLchar *fragmentCode = nullptr;
-    FILE *vertexShaderFile = fopen(vertexShader, "r");
-    if (vertexShaderFile == NULL)
+    return _vertex_path;
+}
+
+const std::string &Shader::getFragmentPath() const
+{
+    return _fragment_path;
+}
+
+// queries every active uniform once, lookups afterwards never reach the driver.
+// On a rebuild known names keep their slot, uniforms the new program lost stay at location -1.
+void Shader::reflectUniforms()
+{
+    GLint count = 0;
+    glGetProgramiv(shaderProgID, GL_ACTIVE_UNIFORMS, &count);
+
+    for (uniform_slot_t &slot : _uniforms)
     {
-        printf("Failed to open vertex-shader code\n");
+        slot.location = -1;
     }
-    else
+    _uniforms.reserve(_uniforms.size() + count);
+
+    for (GLint i = 0; i < count; i++)
     {
-        fseek(vertexShaderFile, 0, SEEK_END);
-        int32_t pos = ftell(vertexShaderFile);
-        rewind(vertexShaderFile);
-        vertexCode = (char *)calloc(1, pos + 1);
-        if (vertexCode)
+        GLchar name[256];
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(shaderProgID, (GLuint)i, sizeof(name), &length, &size, &type, name);
+
+        // members of uniform blocks have no location
+        GLint location = glGetUniformLocation(shaderProgID, name);
+        if (location < 0)
         {
-            fread(vertexCode, pos + 1, 1, vertexShaderFile);
+            continue;
         }
-        if (SHADER_DBG)
+
+        // arrays are reported as "name[0]", register them under the plain name
+        char *bracket = strchr(name, '[');
+        if (bracket)
         {
-            printf("vertex code: \n\n");
-            printf("%s", vertexCode);
-            printf("\n");
+            *bracket = '\0';
         }
 
-        // Load fragment shader code
-        FILE *fragmentShaderFile = fopen(fragmentShader, "r");
-        if (fragmentShaderFile == NULL)
+        uint32_t name_id = internUniformName(name);
+        int existing = findUniform(name_id);
+        if (existing >= 0)
         {
-            printf("Failed to open vertex-shader code\n");
+            uniform_slot_t &slot = _uniforms[existing];
+            slot.uploaded = slot.uploaded && slot.type == type;
+            slot.location = location;
+            slot.type = type;
         }
         else
         {
-            fseek(fragmentShaderFile, 0, SEEK_END);
-            int32_t pos = ftell(fragmentShaderFile);
-            rewind(fragmentShaderFile);
-            fragmentCode = (char *)calloc(1, pos + 1);
-            if (fragmentCode)
-            {
-                fread(fragmentCode, pos + 1, 1, fragmentShaderFile);
-            }
-
-            if (SHADER_DBG)
-            {
-                printf("fragment code: \n\n");
-                printf("%s", fragmentCode);
-                printf("\n");
-            }
+            uniform_slot_t slot{};
+            slot.name_id = name_id;
+            slot.location = location;
+            slot.type = type;
+            slot.uploaded = false;
+            _uniforms.push_back(slot);
         }
 
-        // Compile vertex code
-        vertexID = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertexID, 1, &vertexCode, nullptr);
-        glCompileShader(vertexID);
-
-        GLint success;
-        GLchar infoLog[512];
-        memset(infoLog, ' ', 512);
-
-        glGetShaderiv(vertexID, GL_COMPILE_STATUS, &success);
-        if (!success)
-        {
-            glGetShaderInfoLog(vertexID, 512, NULL, infoLog);
-            printf("%s\n\n", infoLog);
-        }
-        else
+        if (SHADER_DBG)
         {
-            printf("Vertex shader compiled.\n");
+            printf("uniform %s at location %d\n", name, location);
         }
+    }
 
-        // Compile fragment code
-        fragmentID = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragmentID, 1, &fragmentCode, nullptr);
-        glCompileShader(fragmentID);
+    // open addressing table, at most half full
+    uint32_t capacity = 8;
+    while (capacity < 2 * _uniforms.size())
+    {
+        capacity *= 2;
+    }
+    _table_mask = capacity - 1;
+    _table_keys.assign(capacity, 0);
+    _table_slots.assign(capacity, -1);
 
-        memset(infoLog, ' ', 512);
-        glGetShaderiv(fragmentID, GL_COMPILE_STATUS, &success);
-        if (!success)
+    for (size_t i = 0; i < _uniforms.size(); i++)
+    {
+        uint32_t bucket = hash_name_id(_uniforms[i].name_id) & _table_mask;
+        while (_table_keys[bucket] != 0)
         {
-            glGetShaderInfoLog(fragmentID, 512, NULL, infoLog);
-            printf("%s\n\n", infoLog);
+            bucket = (bucket + 1) & _table_mask;
         }
-        else
+        _table_keys[bucket] = _uniforms[i].name_id;
+        _table_slots[bucket] = (int)i;
+    }
+}
+
+// a rebuilt program starts with zeroed uniforms, values set once (samplers) would be lost
+void Shader::restoreUniforms()
+{
+    activate();
+    for (const uniform_slot_t &slot : _uniforms)
+    {
+        if (!slot.uploaded || slot.location < 0)
         {
-            printf("Fragment shader compiled.\n");
+            continue;
         }
 
-        // Link shader code
-        shaderProgID = glCreateProgram();
-        glAttachShader(shaderProgID, vertexID);
-        glAttachShader(shaderProgID, fragmentID);
-        glLinkProgram(shaderProgID);
-
-        memset(infoLog, ' ', 512);
-        glGetProgramiv(shaderProgID, GL_LINK_STATUS, &success);
-        if (!success)
+        const float *f = (const float *)slot.value;
+        switch (slot.type)
         {
-            glGetProgramInfoLog(shaderProgID, 512, NULL, infoLog);
-            printf("%s\n\n", infoLog);
+        case GL_FLOAT:
+            glUniform1f(slot.location, f[0]);
+            break;
+        case GL_FLOAT_VEC2:
+            glUniform2f(slot.location, f[0], f[1]);
+            break;
+        case GL_FLOAT_VEC3:
+            glUniform3f(slot.location, f[0], f[1], f[2]);
+            break;
+        case GL_FLOAT_VEC4:
+            glUniform4f(slot.location, f[0], f[1], f[2], f[3]);
+            break;
+        case GL_FLOAT_MAT4:
+            glUniformMatrix4fv(slot.location, 1, GL_FALSE, f);
+            break;
+        default:
+            // int, bool and sampler uniforms are all stored as int
+            glUniform1i(slot.location, *(const int *)slot.value);
+            break;
         }
-        else
+    }
+}
+
+int Shader::findUniform(uint32_t name_id) const
+{
+    if (_table_keys.empty())
+    {
+        return -1;
+    }
+
+    uint32_t bucket = hash_name_id(name_id) & _table_mask;
+    while (_table_keys[bucket] != 0)
+    {
+        if (_table_keys[bucket] == name_id)
         {
-            printf("Program linked.\n");
+            return _table_slots[bucket];
         }
+        bucket = (bucket + 1) & _table_mask;
+    }
+    return -1;
+}
 
-        glDeleteShader(vertexID);
-        glDeleteShader(fragmentID);
+// a name no program has is not in the id table, so it can not be in this shader's either
+int Shader::findUniform(const char *uniform_name) const
+{
+    uint32_t name_id = lookupUniformName(uniform_name);
+    return name_id ? findUniform(name_id) : -1;
+}
+
+// true if the value differs from the last upload and has to be sent
+bool Shader::storeUniform(int slot, const void *data, size_t size)
+{
+    if (slot < 0)
+    {
+        return false;
+    }
+
+    uniform_slot_t &uniform = _uniforms[slot];
+    if (uniform.uploaded && memcmp(uniform.value, data, size) == 0)
+    {
+        return false;
     }
+    memcpy(uniform.value, data, size);
+    uniform.uploaded = true;
+    return true;
 }
 
-void Shader::activate()
+void Shader::setUniform(int slot, int value)
+{
+    if (storeUniform(slot, &value, sizeof(value)))
+    {
+        glUniform1i(_uniforms[slot].location, value);
+    }
+}
+
+void Shader::setUniform(int slot, bool value)
+{
+    setUniform(slot, (int)value);
+}
+
+void Shader::setUniform(int slot, float value)
+{
+    if (storeUniform(slot, &value, sizeof(value)))
+    {
+        glUniform1f(_uniforms[slot].location, value);
+    }
+}
+
+void Shader::setUniform(int slot, const glm::vec2 &value)
+{
+    if (storeUniform(slot, &value, sizeof(value)))
+    {
+        glUniform2f(_uniforms[slot].location, value.x, value.y);
+    }
+}
+
+void Shader::setUniform(int slot, const glm::vec3 &value)
+{
+    if (storeUniform(slot, &value, sizeof(value)))
+    {
+        glUniform3f(_uniforms[slot].location, value.x, value.y, value.z);
+    }
+}
+
+void Shader::setUniform(int slot, const glm::vec4 &value)
+{
+    if (storeUniform(slot, &value, sizeof(value)))
+    {
+        glUniform4f(_uniforms[slot].location, value.x, value.y, value.z, value.w);
+    }
+}
+
+void Shader::setUniform(int slot, const glm::mat4 &value)
 {
-    glUseProgram(shaderProgID);
+    if (storeUniform(slot, &value, sizeof(value)))
+    {
+        glUniformMatrix4fv(_uniforms[slot].location, 1, GL_FALSE, &value[0][0]);
+    }
+}
+
+void Shader::setUniformArray(int slot, const glm::vec2 *values, int count)
+{
+    if (slot < 0)
+    {
+        return;
+    }
+    // element 0 may now differ from the cached value
+    _uniforms[slot].uploaded = false;
+    glUniform2fv(_uniforms[slot].location, count, &values[0].x);
 }
 
 void Shader::setMatrix(const char *uniform_name, float *matrix)
 {
-    GLuint location = glGetUniformLocation(shaderProgID, uniform_name);
-    glUniformMatrix4fv(location, 1, GL_FALSE, matrix);
+    int slot = findUniform(uniform_name);
+    if (storeUniform(slot, matrix, 16 * sizeof(float)))
+    {
+        glUniformMatrix4fv(_uniforms[slot].location, 1, GL_FALSE, matrix);
+    }
 }
 
 void Shader::setInt(const char *uniform_name, int value)
 {
-    GLuint location = glGetUniformLocation(shaderProgID, uniform_name);
-    glUniform1i(location, value);
+    setUniform(findUniform(uniform_name), value);
 }
 
 void Shader::setBool(const char *uniform_name, bool value)
 {
-    GLuint location = glGetUniformLocation(shaderProgID, uniform_name);
-    glUniform1i(location, (int)value);
-}
\ No newline at end of file
+    setUniform(findUniform(uniform_name), (int)value);
+}
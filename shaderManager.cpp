@@ -0,0 +1,464 @@
+#include "shaderManager.h"
+#include "shader.h"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <system_error>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// glad is generated for a 3.3 core profile, program binaries come from the extension
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+typedef void(APIENTRYP get_program_binary_proc_t)(GLuint program, GLsizei buffer_size, GLsizei *length, GLenum *format, void *binary);
+typedef void(APIENTRYP program_binary_proc_t)(GLuint program, GLenum format, const void *binary, GLsizei length);
+typedef void(APIENTRYP program_parameteri_proc_t)(GLuint program, GLenum name, GLint value);
+
+static get_program_binary_proc_t getProgramBinary = nullptr;
+static program_binary_proc_t programBinary = nullptr;
+static program_parameteri_proc_t programParameteri = nullptr;
+
+bool SHADER_MANAGER_DBG = false;
+
+// ------------------------------- Program binaries -------------------------------------
+
+static const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+struct program_cache_header_t
+{
+    char magic[4]; // "GPRG"
+    uint32_t version;
+    uint64_t key; // checked again, file names only carry it in hex
+    uint32_t format;
+    uint32_t length;
+};
+
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t size)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static std::string cache_path(uint64_t key)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return std::string(SHADER_CACHE_DIRECTORY) + "/" + name;
+}
+
+ShaderManager &ShaderManager::get()
+{
+    static ShaderManager manager;
+    return manager;
+}
+
+ShaderManager::ShaderManager()
+    : _cache_checked(false), _cache_enabled(false), _driver_hash(14695981039346656037ull),
+      _hot_reload(true), _files_dirty(false), _stop(false)
+{
+}
+
+ShaderManager::~ShaderManager()
+{
+    shutdown();
+}
+
+void ShaderManager::setHotReload(bool enabled)
+{
+    _hot_reload = enabled;
+    if (!enabled)
+    {
+        shutdown();
+    }
+}
+
+bool ShaderManager::initCache()
+{
+    _cache_checked = true;
+
+    const char *driver[3] = {(const char *)glGetString(GL_VENDOR), (const char *)glGetString(GL_RENDERER),
+                             (const char *)glGetString(GL_VERSION)};
+    for (const char *string : driver)
+    {
+        _driver_hash = string ? fnv1a(_driver_hash, string, strlen(string) + 1) : _driver_hash;
+    }
+
+    if (glfwExtensionSupported("GL_ARB_get_program_binary"))
+    {
+        getProgramBinary = (get_program_binary_proc_t)glfwGetProcAddress("glGetProgramBinary");
+        programBinary = (program_binary_proc_t)glfwGetProcAddress("glProgramBinary");
+        programParameteri = (program_parameteri_proc_t)glfwGetProcAddress("glProgramParameteri");
+    }
+
+    // some drivers expose the entry points but no format to store
+    GLint formats = 0;
+    if (getProgramBinary && programBinary && programParameteri)
+    {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(SHADER_CACHE_DIRECTORY, error);
+    _cache_enabled = formats > 0 && !error;
+    printf("Shader cache %s.\n", _cache_enabled ? "enabled" : "unavailable, programs are compiled");
+    return _cache_enabled;
+}
+
+uint64_t ShaderManager::programKey(const std::string &vertex_code, const std::string &fragment_code)
+{
+    if (!_cache_checked)
+    {
+        initCache();
+    }
+
+    // the terminating zero separates the two stages
+    uint64_t hash = fnv1a(_driver_hash, vertex_code.c_str(), vertex_code.size() + 1);
+    return fnv1a(hash, fragment_code.c_str(), fragment_code.size() + 1);
+}
+
+void ShaderManager::prepareProgram(GLuint program)
+{
+    if (!_cache_checked)
+    {
+        initCache();
+    }
+    if (_cache_enabled)
+    {
+        programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+}
+
+GLuint ShaderManager::loadProgram(uint64_t key)
+{
+    if (!_cache_checked)
+    {
+        initCache();
+    }
+    if (!_cache_enabled)
+    {
+        return 0;
+    }
+
+    FILE *file = fopen(cache_path(key).c_str(), "rb");
+    if (!file)
+    {
+        return 0;
+    }
+
+    program_cache_header_t header;
+    std::vector<unsigned char> binary;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, "GPRG", 4) == 0 &&
+              header.version == PROGRAM_CACHE_VERSION && header.key == key;
+    if (ok)
+    {
+        binary.resize(header.length);
+        ok = fread(binary.data(), 1, binary.size(), file) == binary.size();
+    }
+    fclose(file);
+    if (!ok)
+    {
+        printf("Shader cache: %s is damaged, recompiling\n", cache_path(key).c_str());
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    programBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+
+    // drivers refuse binaries of other versions, the key should have caught that already
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked)
+    {
+        glDeleteProgram(program);
+        printf("Shader cache: driver rejected %s, recompiling\n", cache_path(key).c_str());
+        return 0;
+    }
+
+    if (SHADER_MANAGER_DBG)
+    {
+        printf("Shader cache: hit %016llx (%u bytes)\n", (unsigned long long)key, header.length);
+    }
+    return program;
+}
+
+void ShaderManager::storeProgram(uint64_t key, GLuint program)
+{
+    if (!_cache_enabled)
+    {
+        return;
+    }
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+    {
+        return;
+    }
+
+    program_cache_header_t header;
+    memcpy(header.magic, "GPRG", 4);
+    header.version = PROGRAM_CACHE_VERSION;
+    header.key = key;
+    header.format = 0;
+    header.length = 0;
+
+    std::vector<unsigned char> binary(length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    getProgramBinary(program, length, &written, &format, binary.data());
+    header.format = format;
+    header.length = (uint32_t)written;
+
+    // written next to the final name and renamed, a crash never leaves half a binary behind
+    std::string path = cache_path(key);
+    std::string temporary = path + ".tmp";
+    FILE *file = fopen(temporary.c_str(), "wb");
+    if (!file)
+    {
+        printf("Shader cache: could not write %s\n", temporary.c_str());
+        return;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(binary.data(), 1, written, file) == (size_t)written;
+    ok = fclose(file) == 0 && ok;
+
+    std::error_code error;
+    if (ok)
+    {
+        std::filesystem::rename(temporary, path, error);
+    }
+    if (!ok || error)
+    {
+        std::filesystem::remove(temporary, error);
+        printf("Shader cache: could not write %s\n", path.c_str());
+    }
+}
+
+// ---------------------------------- Hot reload ----------------------------------------
+
+void ShaderManager::watch(Shader *shader)
+{
+    _shaders.push_back(shader);
+    if (!_hot_reload)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (const std::string &path : {shader->getVertexPath(), shader->getFragmentPath()})
+        {
+            bool known = std::any_of(_files.begin(), _files.end(), [&](const watched_file_t &file)
+                                     { return file.path == path; });
+            if (!known)
+            {
+                std::error_code error;
+                _files.push_back(watched_file_t{path, std::filesystem::last_write_time(path, error)});
+                _files_dirty = true;
+            }
+        }
+    }
+
+    if (!_watcher.joinable())
+    {
+        _stop = false;
+        _watcher = std::thread(&ShaderManager::watchLoop, this);
+    }
+}
+
+void ShaderManager::unwatch(Shader *shader)
+{
+    _shaders.erase(std::remove(_shaders.begin(), _shaders.end(), shader), _shaders.end());
+}
+
+void ShaderManager::fileChanged(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (std::find(_changed.begin(), _changed.end(), path) == _changed.end())
+    {
+        _changed.push_back(path);
+    }
+    _changed_at = std::chrono::steady_clock::now();
+}
+
+int ShaderManager::update()
+{
+    std::vector<std::string> changed;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_changed.empty() ||
+            std::chrono::steady_clock::now() - _changed_at < std::chrono::milliseconds(SHADER_RELOAD_DEBOUNCE_MS))
+        {
+            return 0;
+        }
+        changed.swap(_changed);
+    }
+
+    int rebuilt = 0;
+    for (Shader *shader : _shaders)
+    {
+        bool affected = std::find(changed.begin(), changed.end(), shader->getVertexPath()) != changed.end() ||
+                        std::find(changed.begin(), changed.end(), shader->getFragmentPath()) != changed.end();
+        if (!affected)
+        {
+            continue;
+        }
+
+        if (shader->reload())
+        {
+            printf("Shader: reloaded %s / %s\n", shader->getVertexPath().c_str(), shader->getFragmentPath().c_str());
+            rebuilt++;
+        }
+        else
+        {
+            printf("Shader: %s / %s failed to build, keeping the old program\n",
+                   shader->getVertexPath().c_str(), shader->getFragmentPath().c_str());
+        }
+    }
+    return rebuilt;
+}
+
+void ShaderManager::shutdown()
+{
+    _stop = true;
+    if (_watcher.joinable())
+    {
+        _watcher.join();
+    }
+}
+
+#ifdef __linux__
+
+// "dir/name" as inotify reports it, relative paths against "."
+static std::string watch_key(const std::filesystem::path &path)
+{
+    std::filesystem::path directory = path.parent_path().empty() ? std::filesystem::path(".") : path.parent_path();
+    return (directory / path.filename()).lexically_normal().string();
+}
+
+// directories are watched rather than the files, editors that save through a rename replace the inode
+void ShaderManager::watchLoop()
+{
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0)
+    {
+        printf("Shader: inotify unavailable, hot reload off\n");
+        return;
+    }
+
+    std::vector<std::pair<int, std::string>> directories; // watch descriptor -> directory
+    std::vector<std::pair<std::string, std::string>> files; // watch_key -> path as registered
+
+    while (!_stop)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_files_dirty)
+            {
+                files.clear();
+                for (const watched_file_t &file : _files)
+                {
+                    std::string key = watch_key(file.path);
+                    files.emplace_back(key, file.path);
+
+                    std::string directory = std::filesystem::path(key).parent_path().string();
+                    int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+                    if (wd >= 0 && std::none_of(directories.begin(), directories.end(), [&](const std::pair<int, std::string> &d)
+                                                { return d.first == wd; }))
+                    {
+                        directories.emplace_back(wd, directory);
+                    }
+                }
+                _files_dirty = false;
+            }
+        }
+
+        // wakes up now and then to notice shutdown()
+        pollfd descriptor{fd, POLLIN, 0};
+        if (poll(&descriptor, 1, 100) <= 0)
+        {
+            continue;
+        }
+
+        alignas(inotify_event) char buffer[4096];
+        ssize_t length = read(fd, buffer, sizeof(buffer));
+        for (ssize_t offset = 0; offset < length;)
+        {
+            const inotify_event *event = (const inotify_event *)(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+            if (event->len == 0)
+            {
+                continue;
+            }
+
+            for (const std::pair<int, std::string> &directory : directories)
+            {
+                if (directory.first != event->wd)
+                {
+                    continue;
+                }
+                std::string key = (std::filesystem::path(directory.second) / event->name).lexically_normal().string();
+                for (const std::pair<std::string, std::string> &file : files)
+                {
+                    if (file.first == key)
+                    {
+                        fileChanged(file.second);
+                    }
+                }
+            }
+        }
+    }
+
+    close(fd);
+}
+
+#else
+
+// no change notifications wired up here, modification times are cheap enough at 4 Hz
+void ShaderManager::watchLoop()
+{
+    while (!_stop)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+
+        std::vector<std::string> changed;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (watched_file_t &file : _files)
+            {
+                std::error_code error;
+                std::filesystem::file_time_type modified = std::filesystem::last_write_time(file.path, error);
+                if (!error && modified != file.modified)
+                {
+                    file.modified = modified;
+                    changed.push_back(file.path);
+                }
+            }
+        }
+        for (const std::string &path : changed)
+        {
+            fileChanged(path);
+        }
+    }
+}
+
+#endif
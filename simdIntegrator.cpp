@@ -0,0 +1,238 @@
+#include "simdIntegrator.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SIMD_INTEGRATOR_X86 1
+#include <immintrin.h>
+#endif
+
+// per function target, the rest of the build stays at the baseline ISA
+#if defined(SIMD_INTEGRATOR_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define HAVE_AVX2_PATH 1
+#else
+#define TARGET_AVX2
+#endif
+
+// ----------------------------------- Scalar --------------------------------------------
+
+static void integrate_scalar(const integrate_arrays_t &a, uint32_t begin, float dt)
+{
+    for (uint32_t i = begin; i < a.count; i++)
+    {
+        a.x[i] += a.vx[i] * dt;
+        a.y[i] += a.vy[i] * dt;
+        a.z[i] += a.vz[i] * dt;
+        a.vx[i] += a.ax[i] * dt;
+        a.vy[i] += a.ay[i] * dt;
+        a.vz[i] += a.az[i] * dt;
+    }
+}
+
+static uint32_t ground_scalar(float *y, float *vy, const float *ground, uint8_t *contact, uint32_t begin, uint32_t count)
+{
+    uint32_t contacts = 0;
+    for (uint32_t i = begin; i < count; i++)
+    {
+        bool below = y[i] < ground[i];
+        if (below)
+        {
+            y[i] = ground[i];
+            vy[i] = 0.0f;
+            contacts++;
+        }
+        contact[i] = below ? 1 : 0;
+    }
+    return contacts;
+}
+
+#ifdef SIMD_INTEGRATOR_X86
+
+// movemask bits -> one contact byte per lane, at most 8 lanes
+static inline uint32_t store_contacts(uint8_t *contact, int mask, int lanes)
+{
+    uint32_t bits = 0;
+    for (int k = 0; k < lanes; k++)
+    {
+        contact[k] = (mask >> k) & 1;
+        bits += contact[k];
+    }
+    return bits;
+}
+
+// ------------------------------------ SSE2 ---------------------------------------------
+
+static inline void euler_sse(float *p, float *v, const float *acc, __m128 step)
+{
+    __m128 position = _mm_loadu_ps(p);
+    __m128 velocity = _mm_loadu_ps(v);
+    position = _mm_add_ps(position, _mm_mul_ps(velocity, step));
+    velocity = _mm_add_ps(velocity, _mm_mul_ps(_mm_loadu_ps(acc), step));
+    _mm_storeu_ps(p, position);
+    _mm_storeu_ps(v, velocity);
+}
+
+static void integrate_sse(const integrate_arrays_t &a, float dt)
+{
+    __m128 step = _mm_set1_ps(dt);
+    uint32_t i = 0;
+    for (; i + 4 <= a.count; i += 4)
+    {
+        euler_sse(a.x + i, a.vx + i, a.ax + i, step);
+        euler_sse(a.y + i, a.vy + i, a.ay + i, step);
+        euler_sse(a.z + i, a.vz + i, a.az + i, step);
+    }
+    integrate_scalar(a, i, dt);
+}
+
+// select rather than max, an equal height keeps y as it is like the scalar compare
+static uint32_t ground_sse(float *y, float *vy, const float *ground, uint8_t *contact, uint32_t count)
+{
+    uint32_t contacts = 0;
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 height = _mm_loadu_ps(y + i);
+        __m128 floor = _mm_loadu_ps(ground + i);
+        __m128 below = _mm_cmplt_ps(height, floor);
+        _mm_storeu_ps(y + i, _mm_or_ps(_mm_and_ps(below, floor), _mm_andnot_ps(below, height)));
+        _mm_storeu_ps(vy + i, _mm_andnot_ps(below, _mm_loadu_ps(vy + i)));
+        contacts += store_contacts(contact + i, _mm_movemask_ps(below), 4);
+    }
+    return contacts + ground_scalar(y, vy, ground, contact, i, count);
+}
+
+// ------------------------------------ AVX2 ---------------------------------------------
+
+#ifdef HAVE_AVX2_PATH
+
+TARGET_AVX2 static inline void euler_avx2(float *p, float *v, const float *acc, __m256 step)
+{
+    __m256 position = _mm256_loadu_ps(p);
+    __m256 velocity = _mm256_loadu_ps(v);
+    position = _mm256_add_ps(position, _mm256_mul_ps(velocity, step));
+    velocity = _mm256_add_ps(velocity, _mm256_mul_ps(_mm256_loadu_ps(acc), step));
+    _mm256_storeu_ps(p, position);
+    _mm256_storeu_ps(v, velocity);
+}
+
+TARGET_AVX2 static void integrate_avx2(const integrate_arrays_t &a, float dt)
+{
+    __m256 step = _mm256_set1_ps(dt);
+    uint32_t i = 0;
+    for (; i + 8 <= a.count; i += 8)
+    {
+        euler_avx2(a.x + i, a.vx + i, a.ax + i, step);
+        euler_avx2(a.y + i, a.vy + i, a.ay + i, step);
+        euler_avx2(a.z + i, a.vz + i, a.az + i, step);
+    }
+    integrate_scalar(a, i, dt);
+}
+
+TARGET_AVX2 static uint32_t ground_avx2(float *y, float *vy, const float *ground, uint8_t *contact, uint32_t count)
+{
+    uint32_t contacts = 0;
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 height = _mm256_loadu_ps(y + i);
+        __m256 floor = _mm256_loadu_ps(ground + i);
+        __m256 below = _mm256_cmp_ps(height, floor, _CMP_LT_OQ);
+        _mm256_storeu_ps(y + i, _mm256_blendv_ps(height, floor, below));
+        _mm256_storeu_ps(vy + i, _mm256_andnot_ps(below, _mm256_loadu_ps(vy + i)));
+        contacts += store_contacts(contact + i, _mm256_movemask_ps(below), 8);
+    }
+    return contacts + ground_scalar(y, vy, ground, contact, i, count);
+}
+
+#endif
+#endif
+
+// ---------------------------------- Dispatch -------------------------------------------
+
+simd_level_t detectSimdLevel()
+{
+    static simd_level_t level = []
+    {
+#if defined(HAVE_AVX2_PATH)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return SIMD_AVX2;
+        }
+#endif
+#if defined(SIMD_INTEGRATOR_X86)
+        return SIMD_SSE2; // baseline on x86-64
+#else
+        return SIMD_SCALAR;
+#endif
+    }();
+    return level;
+}
+
+const char *simdLevelName(simd_level_t level)
+{
+    switch (level)
+    {
+    case SIMD_AVX2:
+        return "AVX2";
+    case SIMD_SSE2:
+        return "SSE2";
+    case SIMD_SCALAR:
+    default:
+        return "scalar";
+    }
+}
+
+// levels above what the CPU or the build supports fall back down
+static simd_level_t clamp_level(simd_level_t level)
+{
+    simd_level_t best = detectSimdLevel();
+    return level > best ? best : level;
+}
+
+void integrateBatch(const integrate_arrays_t &arrays, float dt)
+{
+    integrateBatch(arrays, dt, detectSimdLevel());
+}
+
+void integrateBatch(const integrate_arrays_t &arrays, float dt, simd_level_t level)
+{
+    switch (clamp_level(level))
+    {
+#ifdef HAVE_AVX2_PATH
+    case SIMD_AVX2:
+        integrate_avx2(arrays, dt);
+        break;
+#endif
+#ifdef SIMD_INTEGRATOR_X86
+    case SIMD_SSE2:
+        integrate_sse(arrays, dt);
+        break;
+#endif
+    default:
+        integrate_scalar(arrays, 0, dt);
+        break;
+    }
+}
+
+uint32_t resolveGroundContact(float *y, float *vy, const float *ground, uint8_t *contact, uint32_t count)
+{
+    return resolveGroundContact(y, vy, ground, contact, count, detectSimdLevel());
+}
+
+uint32_t resolveGroundContact(float *y, float *vy, const float *ground, uint8_t *contact, uint32_t count, simd_level_t level)
+{
+    switch (clamp_level(level))
+    {
+#ifdef HAVE_AVX2_PATH
+    case SIMD_AVX2:
+        return ground_avx2(y, vy, ground, contact, count);
+#endif
+#ifdef SIMD_INTEGRATOR_X86
+    case SIMD_SSE2:
+        return ground_sse(y, vy, ground, contact, count);
+#endif
+    default:
+        return ground_scalar(y, vy, ground, contact, 0, count);
+    }
+}
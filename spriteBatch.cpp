@@ -0,0 +1,476 @@
+#include "spriteBatch.h"
+#include "glStateCache.h"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cstdio>
+
+// glad is generated for a 3.3 core profile, persistent mapping comes from the extension
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+typedef void(APIENTRYP buffer_storage_proc_t)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+
+bool SPRITE_BATCH_DBG = false;
+
+static const int VERTICES_PER_SPRITE = 4;
+static const int INDICES_PER_SPRITE = 6;
+
+// sorted sprites are spread over z in (0, SPRITE_DEPTH_RANGE], tiles and backgrounds sit at 0
+static const float SPRITE_DEPTH_RANGE = 0.5f;
+
+uint32_t packColor(glm::vec4 color)
+{
+    uint32_t r = (uint32_t)(glm::clamp(color.x, 0.0f, 1.0f) * 255.0f + 0.5f);
+    uint32_t g = (uint32_t)(glm::clamp(color.y, 0.0f, 1.0f) * 255.0f + 0.5f);
+    uint32_t b = (uint32_t)(glm::clamp(color.z, 0.0f, 1.0f) * 255.0f + 0.5f);
+    uint32_t a = (uint32_t)(glm::clamp(color.w, 0.0f, 1.0f) * 255.0f + 0.5f);
+    return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+SpriteBatch::SpriteBatch()
+    : _persistent(false), _mapped(nullptr), _segment(NUM_SEGMENTS - 1), _segment_used(0), _segment_ptr(nullptr),
+      _overdraw_shader(nullptr), _stats{}
+{
+    for (int i = 0; i < NUM_SEGMENTS; i++)
+    {
+        _segment_fence[i] = 0;
+    }
+
+    GLsizeiptr buffer_size = (GLsizeiptr)NUM_SEGMENTS * SPRITES_PER_SEGMENT * VERTICES_PER_SPRITE * sizeof(shapes::sprite_vertex);
+
+    // Bookmark
+    glGenVertexArrays(1, &_VAO);
+    GLStateCache::get().bindVertexArray(_VAO);
+
+    // Streaming VBO memory
+    glGenBuffers(1, &_VBO);
+    GLStateCache::get().bindBuffer(GL_ARRAY_BUFFER, _VBO);
+
+    buffer_storage_proc_t bufferStorage = nullptr;
+    if (glfwExtensionSupported("GL_ARB_buffer_storage"))
+    {
+        bufferStorage = (buffer_storage_proc_t)glfwGetProcAddress("glBufferStorage");
+    }
+
+    if (bufferStorage)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        bufferStorage(GL_ARRAY_BUFFER, buffer_size, nullptr, flags);
+        _mapped = (shapes::sprite_vertex *)glMapBufferRange(GL_ARRAY_BUFFER, 0, buffer_size, flags);
+        _persistent = (_mapped != nullptr);
+    }
+
+    if (!_persistent)
+    {
+        glBufferData(GL_ARRAY_BUFFER, buffer_size, nullptr, GL_STREAM_DRAW);
+    }
+
+    // Static index pattern for one segment, segments are selected with a base vertex
+    std::vector<GLushort> indices(SPRITES_PER_SEGMENT * INDICES_PER_SPRITE);
+    for (int i = 0; i < SPRITES_PER_SEGMENT; i++)
+    {
+        GLushort v = (GLushort)(i * VERTICES_PER_SPRITE);
+        indices[i * INDICES_PER_SPRITE + 0] = v + 0; // bottom left
+        indices[i * INDICES_PER_SPRITE + 1] = v + 1; // top left
+        indices[i * INDICES_PER_SPRITE + 2] = v + 2; // top right
+        indices[i * INDICES_PER_SPRITE + 3] = v + 2; // top right
+        indices[i * INDICES_PER_SPRITE + 4] = v + 3; // bottom right
+        indices[i * INDICES_PER_SPRITE + 5] = v + 0; // bottom left
+    }
+    glGenBuffers(1, &_EBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), indices.data(), GL_STATIC_DRAW);
+
+    // Memory layout
+
+    // Position
+    glVertexAttribPointer(
+        0,                                   // Attribute position
+        3,                                   // Vector Elements (1,2,3,4)
+        GL_FLOAT,                            // Vector Type
+        GL_FALSE,                            // Nomarlize
+        sizeof(shapes::sprite_vertex),       // Stride
+        (void *)0);                          // Offset
+    glEnableVertexAttribArray(0);
+
+    // Texture
+    glVertexAttribPointer(
+        1,                                   // Attribute position
+        2,                                   // Vector Elements (1,2,3,4)
+        GL_FLOAT,                            // Vector Type
+        GL_FALSE,                            // Nomarlize
+        sizeof(shapes::sprite_vertex),       // Stride
+        (void *)(3 * sizeof(float)));        // Offset
+    glEnableVertexAttribArray(1);
+
+    // Tint
+    glVertexAttribPointer(
+        2,                                   // Attribute position
+        4,                                   // Vector Elements (1,2,3,4)
+        GL_UNSIGNED_BYTE,                    // Vector Type
+        GL_TRUE,                             // Nomarlize
+        sizeof(shapes::sprite_vertex),       // Stride
+        (void *)(5 * sizeof(float)));        // Offset
+    glEnableVertexAttribArray(2);
+
+    // Disable VAO
+    GLStateCache::get().bindVertexArray(0);
+
+    _commands.reserve(SPRITES_PER_SEGMENT);
+    _sprites.reserve(SPRITES_PER_SEGMENT);
+    _states.reserve(SPRITES_PER_SEGMENT);
+    _runs.reserve(64);
+    _order.reserve(SPRITES_PER_SEGMENT);
+
+    printf("Sprite batch created (%s streaming buffer, %d KiB).\n",
+           _persistent ? "persistent" : "mapped", (int)(buffer_size / 1024));
+}
+
+SpriteBatch::~SpriteBatch()
+{
+    for (int i = 0; i < NUM_SEGMENTS; i++)
+    {
+        if (_segment_fence[i])
+        {
+            glDeleteSync(_segment_fence[i]);
+        }
+    }
+    if (_persistent)
+    {
+        GLStateCache::get().bindBuffer(GL_ARRAY_BUFFER, _VBO);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    GLStateCache::get().forgetBuffer(_VBO);
+    GLStateCache::get().forgetVertexArray(_VAO);
+    glDeleteBuffers(1, &_EBO);
+    glDeleteBuffers(1, &_VBO);
+    glDeleteVertexArrays(1, &_VAO);
+}
+
+void SpriteBatch::begin()
+{
+    _commands.clear();
+    _sprites.clear();
+    _states.clear();
+}
+
+void SpriteBatch::draw(Shader &shader, GLuint texture, const Sprite &sprite, uint8_t layer)
+{
+    // sort key: layer | program | texture, submission order breaks ties
+    uint64_t key = ((uint64_t)layer << 56) |
+                   ((uint64_t)(shader.getProgramID() & 0xFFFFFF) << 32) |
+                   (uint64_t)texture;
+
+    _commands.push_back({key, (uint32_t)_sprites.size()});
+    _sprites.push_back(sprite);
+    _states.push_back({&shader, texture});
+
+    // a translucent tint needs blending whatever the texture holds
+    Sprite &added = _sprites.back();
+    if ((sprite.tint >> 24) != 0xFF || sprite.alpha_mode >= NUM_ALPHA_MODES)
+    {
+        added.alpha_mode = ALPHA_BLEND;
+    }
+}
+
+void SpriteBatch::end()
+{
+    if (!_commands.empty())
+    {
+        flush();
+    }
+}
+
+void SpriteBatch::setVariant(Shader &shader, alpha_mode_t mode, Shader &variant)
+{
+    for (variant_t &entry : _variants)
+    {
+        if (entry.shader == &shader && entry.mode == mode)
+        {
+            entry.variant = &variant;
+            return;
+        }
+    }
+    _variants.push_back({&shader, &variant, (uint8_t)mode});
+}
+
+void SpriteBatch::setOverdrawShader(Shader *shader)
+{
+    _overdraw_shader = shader;
+}
+
+const sprite_batch_stats_t &SpriteBatch::getStats() const
+{
+    return _stats;
+}
+
+void SpriteBatch::resetStats()
+{
+    _stats = sprite_batch_stats_t{};
+}
+
+bool SpriteBatch::isPersistent() const
+{
+    return _persistent;
+}
+
+void SpriteBatch::flush()
+{
+    std::sort(_commands.begin(), _commands.end(), [](const command_t &a, const command_t &b)
+              { return a.key != b.key ? a.key < b.key : a.index < b.index; });
+
+    // sorted position becomes depth, the first sprite is the farthest
+    uint32_t pass_count[NUM_ALPHA_MODES] = {};
+    float depth_step = SPRITE_DEPTH_RANGE / (float)(_commands.size() + 1);
+    for (size_t i = 0; i < _commands.size(); i++)
+    {
+        Sprite &sprite = _sprites[_commands[i].index];
+        sprite.position.z = (float)(i + 1) * depth_step;
+        pass_count[sprite.alpha_mode]++;
+    }
+
+    // opaque front to back, then alpha tested and blended in sorted order
+    _order.clear();
+    for (size_t i = _commands.size(); i-- > 0;)
+    {
+        if (_sprites[_commands[i].index].alpha_mode == ALPHA_OPAQUE)
+        {
+            _order.push_back((uint32_t)i);
+        }
+    }
+    for (uint8_t mode = ALPHA_TEST; mode <= ALPHA_BLEND; mode++)
+    {
+        for (size_t i = 0; i < _commands.size() && pass_count[mode] > 0; i++)
+        {
+            if (_sprites[_commands[i].index].alpha_mode == mode)
+            {
+                _order.push_back((uint32_t)i);
+            }
+        }
+    }
+
+    bool depth_test = pass_count[ALPHA_OPAQUE] + pass_count[ALPHA_TEST] > 0;
+    if (depth_test)
+    {
+        glEnable(GL_DEPTH_TEST);
+        glDepthFunc(GL_LEQUAL);
+        glDepthMask(GL_TRUE);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+
+    GLStateCache::get().bindVertexArray(_VAO);
+
+    Shader *current_shader = nullptr;
+    GLuint current_texture = 0;
+    uint8_t current_mode = NUM_ALPHA_MODES;
+    GLStateCache::get().activeTexture(0);
+
+    size_t next = 0;
+    while (next < _order.size())
+    {
+        // Fill one segment with as many sprites as fit, remembering where each state run starts
+        beginSegment();
+
+        _runs.clear();
+        while (next < _order.size() && _segment_used < SPRITES_PER_SEGMENT)
+        {
+            const command_t &cmd = _commands[_order[next]];
+            const Sprite &sprite = _sprites[cmd.index];
+            if (_runs.empty() || _commands[_runs.back().command].key != cmd.key || _runs.back().mode != sprite.alpha_mode)
+            {
+                _runs.push_back({_order[next], _segment_used, 0, sprite.alpha_mode});
+            }
+
+            writeSprite(_segment_ptr + _segment_used * VERTICES_PER_SPRITE, sprite);
+            _segment_used++;
+            _runs.back().count++;
+            next++;
+        }
+
+        endSegment();
+
+        // Issue one draw per state run
+        GLint base_vertex = _segment * SPRITES_PER_SEGMENT * VERTICES_PER_SPRITE;
+        for (const run_t &run : _runs)
+        {
+            if (run.mode != current_mode)
+            {
+                current_mode = run.mode;
+                applyPass(current_mode);
+            }
+
+            const state_t &state = _states[_commands[run.command].index];
+            Shader *shader = passShader(state.shader, run.mode);
+            if (shader != current_shader)
+            {
+                current_shader = shader;
+                current_shader->activate();
+                samplerOf(current_shader).set(0);
+                _stats.state_changes++;
+            }
+            if (state.texture != current_texture)
+            {
+                current_texture = state.texture;
+                GLStateCache::get().bindTexture(GL_TEXTURE_2D, current_texture);
+                _stats.state_changes++;
+            }
+
+            size_t index_offset = (size_t)run.first * INDICES_PER_SPRITE * sizeof(GLushort);
+            glDrawElementsBaseVertex(GL_TRIANGLES, run.count * INDICES_PER_SPRITE, GL_UNSIGNED_SHORT,
+                                     (void *)index_offset, base_vertex);
+
+            _stats.draws++;
+            _stats.sprites += run.count;
+            _stats.vertices += run.count * VERTICES_PER_SPRITE;
+            _stats.opaque += run.mode == ALPHA_OPAQUE ? run.count : 0;
+            _stats.blended += run.mode == ALPHA_BLEND ? run.count : 0;
+        }
+
+        // GPU owns the segment until this fence passes
+        _segment_fence[_segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    // back to the state everything else draws with
+    if (depth_test)
+    {
+        glDisable(GL_DEPTH_TEST);
+    }
+    glDepthMask(GL_TRUE);
+    if (!_overdraw_shader)
+    {
+        glDisable(GL_BLEND);
+    }
+
+    if (SPRITE_BATCH_DBG)
+    {
+        printf("sprite batch: %u draws, %u sprites, %u vertices, %u opaque, %u alpha tested, %u blended\n", _stats.draws,
+               _stats.sprites, _stats.vertices, pass_count[ALPHA_OPAQUE], pass_count[ALPHA_TEST], pass_count[ALPHA_BLEND]);
+    }
+}
+
+void SpriteBatch::applyPass(uint8_t mode)
+{
+    // blended texels must not hide what is drawn behind them later in the pass
+    glDepthMask(mode == ALPHA_BLEND ? GL_FALSE : GL_TRUE);
+    if (_overdraw_shader)
+    {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+    }
+    else if (mode == ALPHA_BLEND)
+    {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    }
+    else
+    {
+        glDisable(GL_BLEND);
+    }
+    _stats.state_changes++;
+}
+
+Shader *SpriteBatch::passShader(Shader *shader, uint8_t mode) const
+{
+    if (_overdraw_shader)
+    {
+        return _overdraw_shader;
+    }
+    for (const variant_t &entry : _variants)
+    {
+        if (entry.shader == shader && entry.mode == mode)
+        {
+            return entry.variant;
+        }
+    }
+    return shader;
+}
+
+Uniform<int> &SpriteBatch::samplerOf(Shader *shader)
+{
+    for (sampler_t &entry : _samplers)
+    {
+        if (entry.shader == shader)
+        {
+            return entry.tex;
+        }
+    }
+    _samplers.push_back({shader, shader->getUniform<int>("tex")});
+    return _samplers.back().tex;
+}
+
+void SpriteBatch::beginSegment()
+{
+    _segment = (_segment + 1) % NUM_SEGMENTS;
+    _segment_used = 0;
+
+    GLsync fence = _segment_fence[_segment];
+    if (fence)
+    {
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+        {
+            _stats.fence_waits++;
+            do
+            {
+                result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            } while (result == GL_TIMEOUT_EXPIRED);
+        }
+        glDeleteSync(fence);
+        _segment_fence[_segment] = 0;
+    }
+
+    size_t segment_vertices = (size_t)SPRITES_PER_SEGMENT * VERTICES_PER_SPRITE;
+    if (_persistent)
+    {
+        _segment_ptr = _mapped + _segment * segment_vertices;
+    }
+    else
+    {
+        // fence already guarantees the GPU is done with this range
+        GLStateCache::get().bindBuffer(GL_ARRAY_BUFFER, _VBO);
+        _segment_ptr = (shapes::sprite_vertex *)glMapBufferRange(
+            GL_ARRAY_BUFFER,
+            _segment * segment_vertices * sizeof(shapes::sprite_vertex),
+            segment_vertices * sizeof(shapes::sprite_vertex),
+            GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    }
+}
+
+void SpriteBatch::endSegment()
+{
+    if (!_persistent)
+    {
+        GLStateCache::get().bindBuffer(GL_ARRAY_BUFFER, _VBO);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    _segment_ptr = nullptr;
+}
+
+void SpriteBatch::writeSprite(shapes::sprite_vertex *dst, const Sprite &sprite)
+{
+    float x0 = sprite.position.x - sprite.half_size.x;
+    float x1 = sprite.position.x + sprite.half_size.x;
+    float y0 = sprite.position.y - sprite.half_size.y;
+    float y1 = sprite.position.y + sprite.half_size.y;
+    float z = sprite.position.z;
+
+    float u0 = sprite.uv_rect.x;
+    float u1 = sprite.uv_rect.z;
+    if (sprite.flip)
+    {
+        std::swap(u0, u1);
+    }
+    float v0 = sprite.uv_rect.y;
+    float v1 = sprite.uv_rect.w;
+
+    dst[0] = {x0, y0, z, u0, v0, sprite.tint}; // bottom left
+    dst[1] = {x0, y1, z, u0, v1, sprite.tint}; // top left
+    dst[2] = {x1, y1, z, u1, v1, sprite.tint}; // top right
+    dst[3] = {x1, y0, z, u1, v0, sprite.tint}; // bottom right
+}
@@ -0,0 +1,400 @@
+#include "systems.h"
+#include "spriteBatch.h"
+#include "simdIntegrator.h"
+#include "collision.h"
+#include "stateMachine.h"
+#include "animation.h"
+
+#include <algorithm>
+#include <vector>
+
+/* === Movement state machine === */
+
+// button action -> next state, see stateMachine.h
+static constexpr fsm_rule_t movement_rules[] = {
+    // in the air and ducking the arrows do nothing, except letting go of down
+    {FSM_ANY, JUMP_UP, FSM_STAY},
+    {FSM_ANY, FALL, FSM_STAY},
+    {FSM_ANY, JUMP_L, FSM_STAY},
+    {FSM_ANY, JUMP_R, FSM_STAY},
+    {FSM_ANY, DUCK, FSM_STAY},
+    {DOWNR, DUCK, STAND},
+
+    {LEFTP, STAND, WALK_L},
+    {LEFTR, STAND, FSM_STAY},
+    {RIGHTP, STAND, WALK_R},
+    {RIGHTR, STAND, FSM_STAY},
+    {UPP, STAND, JUMP_UP},
+    {UPR, STAND, FSM_STAY},
+    {DOWNP, STAND, DUCK},
+    {DOWNR, STAND, FSM_STAY},
+
+    {LEFTP, WALK_L, FSM_STAY},
+    {LEFTR, WALK_L, STAND},
+    {RIGHTP, WALK_L, WALK_R},
+    {RIGHTR, WALK_L, FSM_STAY},
+    {UPP, WALK_L, JUMP_L},
+    {UPR, WALK_L, FSM_STAY},
+    {DOWNP, WALK_L, DUCK},
+    {DOWNR, WALK_L, FSM_STAY},
+
+    {LEFTP, WALK_R, WALK_L},
+    {LEFTR, WALK_R, FSM_STAY},
+    {RIGHTP, WALK_R, FSM_STAY},
+    {RIGHTR, WALK_R, STAND},
+    {UPP, WALK_R, JUMP_R},
+    {UPR, WALK_R, FSM_STAY},
+    {DOWNP, WALK_R, DUCK},
+    {DOWNR, WALK_R, FSM_STAY},
+};
+
+static constexpr auto movement_transitions = fsm_build<NUM_INPUTS, NUM_MOVEMENT_STATES>(movement_rules);
+static_assert(fsm_valid(movement_transitions), "movement rule names an unknown action or state");
+static_assert(fsm_complete(movement_transitions), "movement rules leave an action unhandled in some state");
+
+// velocity a state sets, index into the per-entity sources built in movementInputSystem
+enum movement_velocity_t
+{
+    VELOCITY_ZERO,
+    VELOCITY_WALK_L,
+    VELOCITY_WALK_R,
+    VELOCITY_JUMP,
+    VELOCITY_JUMP_L,
+    VELOCITY_JUMP_R,
+    VELOCITY_KEEP, // whatever the entity has now
+    NUM_MOVEMENT_VELOCITIES
+};
+
+#define FLIP_KEEP 0xFF
+
+struct movement_state_desc_t
+{
+    uint8_t state;
+    uint8_t entry_velocity; // on entering the state
+    uint8_t hold_velocity;  // every tick the state is kept
+    uint8_t airborne;       // gravity pulls
+    uint8_t flip;           // sprite facing, FLIP_KEEP leaves it
+};
+
+// the clip each state shows comes from the entity's animation_set_t
+static constexpr movement_state_desc_t movement_states[] = {
+    {STAND, VELOCITY_ZERO, VELOCITY_ZERO, 0, FLIP_KEEP},
+    {WALK_L, VELOCITY_WALK_L, VELOCITY_KEEP, 0, 0},
+    {WALK_R, VELOCITY_WALK_R, VELOCITY_KEEP, 0, 1},
+    {JUMP_UP, VELOCITY_JUMP, VELOCITY_KEEP, 1, FLIP_KEEP},
+    {FALL, VELOCITY_KEEP, VELOCITY_KEEP, 1, FLIP_KEEP},
+    {JUMP_L, VELOCITY_JUMP_L, VELOCITY_KEEP, 1, FLIP_KEEP},
+    {JUMP_R, VELOCITY_JUMP_R, VELOCITY_KEEP, 1, FLIP_KEEP},
+    {DUCK, VELOCITY_ZERO, VELOCITY_ZERO, 0, FLIP_KEEP},
+};
+static_assert(fsm_states_ordered<NUM_MOVEMENT_STATES>(movement_states), "movement_states has to list every movement_state_t in order");
+
+// scratch columns of movementInputSystem / movementResolveSystem, kept to avoid a per-tick allocation
+static std::vector<uint8_t> next_states;
+static std::vector<uint8_t> ground_contacts; // by transform slot
+
+static bool is_airborne(uint8_t state)
+{
+    return movement_states[state].airborne != 0;
+}
+
+static void set_velocity(velocity_pool_t &velocities, uint32_t slot, glm::vec3 velocity)
+{
+    velocities.vx[slot] = velocity.x;
+    velocities.vy[slot] = velocity.y;
+    velocities.vz[slot] = velocity.z;
+}
+
+static void set_acceleration(velocity_pool_t &velocities, uint32_t slot, glm::vec3 acceleration)
+{
+    velocities.ax[slot] = acceleration.x;
+    velocities.ay[slot] = acceleration.y;
+    velocities.az[slot] = acceleration.z;
+}
+
+void storePreviousTransforms(Registry &registry)
+{
+    transform_pool_t &transforms = registry.getTransforms();
+    std::copy(transforms.x.begin(), transforms.x.end(), transforms.prev_x.begin());
+    std::copy(transforms.y.begin(), transforms.y.end(), transforms.prev_y.begin());
+    std::copy(transforms.z.begin(), transforms.z.end(), transforms.prev_z.begin());
+}
+
+void movementInputSystem(Registry &registry)
+{
+    movement_pool_t &movement = registry.getMovement();
+    transform_pool_t &transforms = registry.getTransforms();
+    velocity_pool_t &velocities = registry.getVelocities();
+
+    uint32_t count = movement.set.size();
+
+    // every entity through the table first, one lookup per entity
+    next_states.resize(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint8_t action = movement.input[i];
+        bool walk_action = action == LEFTP || action == LEFTR || action == RIGHTP || action == RIGHTR;
+        movement.walk_button[i] = walk_action ? action : movement.walk_button[i];
+        next_states[i] = action < NUM_INPUTS ? movement_transitions(action, movement.state[i]) : movement.state[i];
+    }
+
+    // then the entry / hold behaviour of each entity's state from the descriptors
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t slot = transforms.set.indexOf(movement.set.entityAt(i));
+        const movement_profile_t &profile = registry.getMovementProfile(movement.profile[i]);
+
+        uint8_t new_state = next_states[i];
+        bool entered = new_state != movement.state[i];
+        const movement_state_desc_t &desc = movement_states[new_state];
+        movement.state[i] = new_state;
+
+        const glm::vec3 sources[NUM_MOVEMENT_VELOCITIES] = {
+            glm::vec3(0.0f),
+            profile.walk_L_velocity,
+            profile.walk_R_velocity,
+            profile.jump_velocity,
+            profile.jump_velocity + profile.walk_L_velocity,
+            profile.jump_velocity + profile.walk_R_velocity,
+            glm::vec3(velocities.vx[slot], velocities.vy[slot], velocities.vz[slot])};
+        set_velocity(velocities, slot, sources[entered ? desc.entry_velocity : desc.hold_velocity]);
+
+        // gravity only pulls while off the ground
+        set_acceleration(velocities, slot, profile.gravity * (float)desc.airborne);
+    }
+}
+
+void integrateSystem(Registry &registry, double dt)
+{
+    transform_pool_t &transforms = registry.getTransforms();
+    velocity_pool_t &velocities = registry.getVelocities();
+
+    // slots [0, moving_count) of both pools belong to the same entities
+    integrate_arrays_t arrays;
+    arrays.x = transforms.x.data();
+    arrays.y = transforms.y.data();
+    arrays.z = transforms.z.data();
+    arrays.vx = velocities.vx.data();
+    arrays.vy = velocities.vy.data();
+    arrays.vz = velocities.vz.data();
+    arrays.ax = velocities.ax.data();
+    arrays.ay = velocities.ay.data();
+    arrays.az = velocities.az.data();
+    arrays.count = transforms.moving_count;
+
+    integrateBatch(arrays, (float)dt);
+}
+
+static void land(movement_pool_t &movement, velocity_pool_t &velocities, uint32_t i, uint32_t slot,
+                 const movement_profile_t &profile)
+{
+    set_acceleration(velocities, slot, glm::vec3(0.0f));
+
+    if (movement.walk_button[i] == LEFTP)
+    {
+        movement.state[i] = WALK_L;
+        set_velocity(velocities, slot, profile.walk_L_velocity);
+    }
+    else if (movement.walk_button[i] == RIGHTP)
+    {
+        movement.state[i] = WALK_R;
+        set_velocity(velocities, slot, profile.walk_R_velocity);
+    }
+    else
+    {
+        movement.state[i] = STAND;
+        set_velocity(velocities, slot, glm::vec3(0.0f));
+    }
+}
+
+void movementResolveSystem(Registry &registry, const CollisionWorld *collision)
+{
+    movement_pool_t &movement = registry.getMovement();
+    transform_pool_t &transforms = registry.getTransforms();
+    velocity_pool_t &velocities = registry.getVelocities();
+    collider_pool_t &colliders = registry.getColliders();
+
+    // without collision every moving entity is clamped to its ground column in one batch
+    if (!collision)
+    {
+        ground_contacts.resize(transforms.moving_count);
+        resolveGroundContact(transforms.y.data(), velocities.vy.data(), velocities.ground.data(), ground_contacts.data(),
+                             transforms.moving_count);
+    }
+
+    uint32_t count = movement.set.size();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        entity_t entity = movement.set.entityAt(i);
+        uint8_t state = movement.state[i];
+        uint32_t slot = transforms.set.indexOf(entity);
+        const movement_profile_t &profile = registry.getMovementProfile(movement.profile[i]);
+
+        // without collision the ground is a plane at the profile's ground_height
+        if (!collision || !colliders.set.contains(entity))
+        {
+            bool grounded;
+            if (!collision)
+            {
+                grounded = ground_contacts[slot] != 0;
+            }
+            else
+            {
+                // no collider in a colliding world, one entity at a time
+                grounded = transforms.y[slot] < velocities.ground[slot];
+                if (grounded)
+                {
+                    transforms.y[slot] = velocities.ground[slot];
+                    velocities.vy[slot] = 0.0f;
+                }
+            }
+
+            if (grounded && is_airborne(state))
+            {
+                land(movement, velocities, i, slot, profile);
+            }
+            else if (is_airborne(state) && state != FALL && velocities.vy[slot] < 0.0f)
+            {
+                movement.state[i] = FALL;
+            }
+            continue;
+        }
+
+        uint8_t contacts = colliders.contacts[colliders.set.indexOf(entity)];
+        if (!is_airborne(state))
+        {
+            // walked off a ledge, keep the horizontal velocity
+            if (!(contacts & CONTACT_FLOOR))
+            {
+                movement.state[i] = FALL;
+                set_acceleration(velocities, slot, profile.gravity);
+            }
+        }
+        else if (state != FALL)
+        {
+            // apex or head against a ceiling
+            if (velocities.vy[slot] < 0.0f || (contacts & CONTACT_CEILING))
+            {
+                movement.state[i] = FALL;
+            }
+        }
+        else if (contacts & CONTACT_FLOOR)
+        {
+            land(movement, velocities, i, slot, profile); // collision already placed us on top
+        }
+    }
+
+    if (!collision)
+    {
+        return;
+    }
+
+    // falling onto another actor bounces off it
+    for (const contact_event_t &contact : collision->getContacts())
+    {
+        if (contact.other == NULL_ENTITY || contact.normal.y <= 0.0f || !movement.set.contains(contact.entity))
+        {
+            continue;
+        }
+        uint32_t i = movement.set.indexOf(contact.entity);
+        if (movement.state[i] != FALL)
+        {
+            continue;
+        }
+        uint32_t slot = transforms.set.indexOf(contact.entity);
+        const movement_profile_t &profile = registry.getMovementProfile(movement.profile[i]);
+        movement.state[i] = JUMP_UP;
+        velocities.vy[slot] = profile.jump_velocity.y;
+        set_acceleration(velocities, slot, profile.gravity);
+    }
+}
+
+// movement state -> clip and facing, then every sprite's clip advanced and its frame resolved
+void animationSystem(Registry &registry, const AnimationLibrary &animations, double dt,
+                     std::vector<animation_event_t> *events)
+{
+    movement_pool_t &movement = registry.getMovement();
+    sprite_pool_t &sprites = registry.getSprites();
+
+    uint32_t count = movement.set.size();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        entity_t entity = movement.set.entityAt(i);
+        if (!sprites.set.contains(entity))
+        {
+            continue;
+        }
+        uint32_t slot = sprites.set.indexOf(entity);
+
+        // a state change restarts the clip, unless both states show the same one
+        uint16_t clip = registry.getAnimationSet(sprites.animation_set[slot]).clips[movement.state[i]];
+        sprites.clip_time[slot] = clip != sprites.clip[slot] ? 0.0f : sprites.clip_time[slot];
+        sprites.clip[slot] = clip;
+
+        const movement_state_desc_t &desc = movement_states[movement.state[i]];
+        sprites.flip[slot] = desc.flip != FLIP_KEEP ? desc.flip : sprites.flip[slot];
+    }
+
+    count = sprites.set.size();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        float time = sprites.clip_time[i] + (float)dt;
+        uint32_t frame = animations.frameAt(sprites.clip[i], time);
+        const clip_frame_t &clip_frame = animations.getFrame(frame);
+
+        // keep the time bounded, a looping clip repeats every length seconds (twice that ping-ponging)
+        const animation_clip_t &clip = animations.getClip(sprites.clip[i]);
+        float period = clip.loop == CLIP_PING_PONG ? 2.0f * clip.length : clip.length;
+        sprites.clip_time[i] = clip.loop != CLIP_ONCE && time >= period ? time - period : time;
+
+        if (frame != sprites.frame[i] && clip_frame.event != CLIP_EVENT_NONE && events)
+        {
+            events->push_back(animation_event_t{sprites.set.entityAt(i), clip_frame.event});
+        }
+        sprites.frame[i] = frame;
+        sprites.texture[i] = clip_frame.region.texture;
+        sprites.uv_rect[i] = clip_frame.region.uv_rect;
+        sprites.alpha_mode[i] = clip_frame.region.alpha_mode;
+    }
+}
+
+void simulationTick(Registry &registry, double dt, CollisionWorld *collision, const AnimationLibrary *animations,
+                    std::vector<animation_event_t> *events)
+{
+    storePreviousTransforms(registry);
+    movementInputSystem(registry);
+    integrateSystem(registry, dt);
+    if (collision)
+    {
+        collision->step(registry);
+    }
+    movementResolveSystem(registry, collision);
+    if (animations)
+    {
+        animationSystem(registry, *animations, dt, events);
+    }
+}
+
+void spriteSystem(Registry &registry, SpriteBatch &batch, Shader &shader, float alpha)
+{
+    sprite_pool_t &sprites = registry.getSprites();
+    transform_pool_t &transforms = registry.getTransforms();
+
+    uint32_t count = sprites.set.size();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t slot = transforms.set.indexOf(sprites.set.entityAt(i));
+
+        Sprite sprite;
+        sprite.position = glm::vec3(transforms.prev_x[slot] + (transforms.x[slot] - transforms.prev_x[slot]) * alpha,
+                                    transforms.prev_y[slot] + (transforms.y[slot] - transforms.prev_y[slot]) * alpha,
+                                    transforms.prev_z[slot] + (transforms.z[slot] - transforms.prev_z[slot]) * alpha);
+        sprite.half_size = glm::vec2(transforms.half_w[slot], transforms.half_h[slot]);
+        sprite.uv_rect = sprites.uv_rect[i];
+        sprite.tint = sprites.tint[i];
+        sprite.flip = sprites.flip[i] != 0;
+        sprite.alpha_mode = sprites.alpha_mode[i];
+
+        batch.draw(shader, sprites.texture[i], sprite, sprites.layer[i]);
+    }
+}
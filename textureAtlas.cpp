@@ -0,0 +1,339 @@
+#include "textureAtlas.h"
+#include "stb/stb_image.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+bool ATLAS_DBG = false;
+
+// ----------------------------------- Skyline -----------------------------------------
+
+SkylinePacker::SkylinePacker(int width, int height)
+    : _width(width), _height(height)
+{
+    _skyline.push_back({0, 0, width});
+}
+
+// lowest y at which a width x height rect can rest starting at node index, -1 if it does not fit
+int SkylinePacker::fit(size_t index, int width, int height) const
+{
+    int x = _skyline[index].x;
+    if (x + width > _width)
+    {
+        return -1;
+    }
+
+    int y = _skyline[index].y;
+    int width_left = width;
+    while (width_left > 0)
+    {
+        y = std::max(y, _skyline[index].y);
+        if (y + height > _height)
+        {
+            return -1;
+        }
+        width_left -= _skyline[index].width;
+        index++;
+    }
+    return y;
+}
+
+bool SkylinePacker::insert(int width, int height, int &out_x, int &out_y)
+{
+    int best_index = -1;
+    int best_top = INT_MAX;
+    int best_width = INT_MAX;
+
+    for (size_t i = 0; i < _skyline.size(); i++)
+    {
+        int y = fit(i, width, height);
+        if (y < 0)
+        {
+            continue;
+        }
+        // bottom-left rule, narrower segments win ties
+        if (y + height < best_top || (y + height == best_top && _skyline[i].width < best_width))
+        {
+            best_index = (int)i;
+            best_top = y + height;
+            best_width = _skyline[i].width;
+            out_x = _skyline[i].x;
+            out_y = y;
+        }
+    }
+
+    if (best_index < 0)
+    {
+        return false;
+    }
+
+    // raise the skyline under the new rect
+    _skyline.insert(_skyline.begin() + best_index, {out_x, out_y + height, width});
+
+    for (size_t i = best_index + 1; i < _skyline.size(); i++)
+    {
+        skyline_node_t &prev = _skyline[i - 1];
+        skyline_node_t &node = _skyline[i];
+        if (node.x >= prev.x + prev.width)
+        {
+            break;
+        }
+
+        int shrink = prev.x + prev.width - node.x;
+        node.x += shrink;
+        node.width -= shrink;
+        if (node.width <= 0)
+        {
+            _skyline.erase(_skyline.begin() + i);
+            i--;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    // merge neighbours on the same level
+    for (size_t i = 0; i + 1 < _skyline.size(); i++)
+    {
+        if (_skyline[i].y == _skyline[i + 1].y)
+        {
+            _skyline[i].width += _skyline[i + 1].width;
+            _skyline.erase(_skyline.begin() + i + 1);
+            i--;
+        }
+    }
+
+    return true;
+}
+
+// ----------------------------------- Atlas -------------------------------------------
+
+TextureAtlas::TextureAtlas(int max_size, int padding)
+    : _max_size(max_size), _padding(padding), _width(0), _height(0)
+{
+}
+
+void TextureAtlas::addImage(const std::string &path)
+{
+    int width, height, channels;
+    stbi_set_flip_vertically_on_load(true);
+    unsigned char *pixels = stbi_load(path.c_str(), &width, &height, &channels, 4);
+    if (!pixels)
+    {
+        printf("Atlas: failed to load %s\n", path.c_str());
+        return;
+    }
+
+    // strip the extension, keep the directory so equal file names in different sets do not clash
+    std::filesystem::path p(path);
+    std::string name = (p.parent_path() / p.stem()).generic_string();
+
+    _pending.push_back({name, width, height, pixels});
+}
+
+void TextureAtlas::addDirectory(const std::string &directory)
+{
+    std::error_code ec;
+    std::vector<std::string> files;
+    for (const auto &entry : std::filesystem::directory_iterator(directory, ec))
+    {
+        if (entry.is_regular_file() && entry.path().extension() == ".png")
+        {
+            files.push_back(entry.path().generic_string());
+        }
+    }
+    if (ec)
+    {
+        printf("Atlas: failed to open directory %s\n", directory.c_str());
+        return;
+    }
+
+    // directory order is not defined, keep the layout stable between runs
+    std::sort(files.begin(), files.end());
+    for (const auto &file : files)
+    {
+        addImage(file);
+    }
+}
+
+bool TextureAtlas::pack(int width, int height, std::vector<glm::ivec2> &positions) const
+{
+    // tallest first packs best with the skyline rule
+    std::vector<int> order(_pending.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        order[i] = (int)i;
+    }
+    std::sort(order.begin(), order.end(), [this](int a, int b)
+              {
+                  if (_pending[a].height != _pending[b].height)
+                      return _pending[a].height > _pending[b].height;
+                  return _pending[a].width > _pending[b].width; });
+
+    SkylinePacker packer(width, height);
+    positions.assign(_pending.size(), glm::ivec2(0, 0));
+    for (int i : order)
+    {
+        int x, y;
+        if (!packer.insert(_pending[i].width + 2 * _padding, _pending[i].height + 2 * _padding, x, y))
+        {
+            return false;
+        }
+        positions[i] = glm::ivec2(x + _padding, y + _padding);
+    }
+    return true;
+}
+
+// copies the image and extrudes its border into the padding so linear filtering does not bleed
+void TextureAtlas::blit(std::vector<unsigned char> &atlas_pixels, const pending_image_t &image, int x, int y) const
+{
+    for (int row = -_padding; row < image.height + _padding; row++)
+    {
+        int src_row = std::min(std::max(row, 0), image.height - 1);
+        for (int col = -_padding; col < image.width + _padding; col++)
+        {
+            int src_col = std::min(std::max(col, 0), image.width - 1);
+            const unsigned char *src = image.pixels + 4 * (src_row * image.width + src_col);
+            unsigned char *dst = atlas_pixels.data() + 4 * ((y + row) * _width + (x + col));
+            memcpy(dst, src, 4);
+        }
+    }
+}
+
+bool TextureAtlas::build()
+{
+    if (_pending.empty())
+    {
+        printf("Atlas: nothing to build\n");
+        return false;
+    }
+
+    // smallest power of two square that holds the summed area, grow until everything fits
+    long long area = 0;
+    for (const auto &image : _pending)
+    {
+        area += (long long)(image.width + 2 * _padding) * (image.height + 2 * _padding);
+    }
+    int size = 64;
+    while ((long long)size * size < area && size < _max_size)
+    {
+        size *= 2;
+    }
+
+    std::vector<glm::ivec2> positions;
+    _width = size;
+    _height = size;
+    bool packed = pack(_width, _height, positions);
+    while (!packed && (_width < _max_size || _height < _max_size))
+    {
+        if (_width <= _height)
+        {
+            _width *= 2;
+        }
+        else
+        {
+            _height *= 2;
+        }
+        packed = pack(_width, _height, positions);
+    }
+
+    if (!packed)
+    {
+        printf("Atlas: %d images do not fit into %dx%d\n", (int)_pending.size(), _max_size, _max_size);
+        for (auto &image : _pending)
+        {
+            stbi_image_free(image.pixels);
+        }
+        _pending.clear();
+        return false;
+    }
+
+    std::vector<unsigned char> atlas_pixels((size_t)_width * _height * 4, 0);
+    for (size_t i = 0; i < _pending.size(); i++)
+    {
+        const pending_image_t &image = _pending[i];
+        int x = positions[i].x;
+        int y = positions[i].y;
+        blit(atlas_pixels, image, x, y);
+
+        AtlasRegion region;
+        region.name = image.name;
+        region.x = x;
+        region.y = y;
+        region.width = image.width;
+        region.height = image.height;
+        region.uv_rect = glm::vec4((float)x / _width, (float)y / _height,
+                                   (float)(x + image.width) / _width, (float)(y + image.height) / _height);
+        region.alpha_mode = classifyAlpha(image.pixels, image.width, image.height, image.width);
+
+        _lookup[region.name] = (int)_regions.size();
+        _regions.push_back(region);
+
+        if (ATLAS_DBG)
+        {
+            printf("Atlas: %s at (%d, %d) %dx%d alpha %d\n", region.name.c_str(), x, y, image.width, image.height,
+                   region.alpha_mode);
+        }
+
+        stbi_image_free(image.pixels);
+    }
+    _pending.clear();
+
+    _texture.reset(new Texture2D(_width, _height, 4, atlas_pixels.data()));
+
+    printf("Atlas built: %d regions in %dx%d\n", (int)_regions.size(), _width, _height);
+    return true;
+}
+
+int TextureAtlas::findIndex(const std::string &name) const
+{
+    auto it = _lookup.find(name);
+    return it == _lookup.end() ? -1 : it->second;
+}
+
+const AtlasRegion *TextureAtlas::find(const std::string &name) const
+{
+    int index = findIndex(name);
+    return index < 0 ? nullptr : &_regions[index];
+}
+
+const AtlasRegion &TextureAtlas::getRegion(int index) const
+{
+    return _regions[index];
+}
+
+// unknown names map to the whole atlas so a missing frame is visible instead of fatal
+TextureRegion TextureAtlas::region(const std::string &name) const
+{
+    const AtlasRegion *r = find(name);
+    if (!r)
+    {
+        printf("Atlas: no region named %s\n", name.c_str());
+        return TextureRegion{getTextureID(), glm::vec4(0.0f, 0.0f, 1.0f, 1.0f)};
+    }
+    return TextureRegion{getTextureID(), r->uv_rect, r->alpha_mode};
+}
+
+int TextureAtlas::getRegionCount() const
+{
+    return (int)_regions.size();
+}
+
+GLuint TextureAtlas::getTextureID() const
+{
+    return _texture ? _texture->getTextureID() : 0;
+}
+
+int TextureAtlas::getWidth() const
+{
+    return _width;
+}
+
+int TextureAtlas::getHeight() const
+{
+    return _height;
+}
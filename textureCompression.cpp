@@ -0,0 +1,386 @@
+#include "textureCompression.h"
+#include "cookedAsset.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+// ------------------------------------- Sizes -------------------------------------------
+
+uint32_t blockBytes(uint32_t format)
+{
+    switch (format)
+    {
+    case COOKED_BC1:
+        return 8;
+    case COOKED_BC3:
+    case COOKED_BC7:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+uint32_t compressedLevelSize(uint32_t format, uint32_t width, uint32_t height)
+{
+    return ((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+}
+
+bool isOpaque(const unsigned char *pixels, int width, int height, int channels)
+{
+    if (channels != 4)
+    {
+        return true;
+    }
+    for (size_t i = 0; i < (size_t)width * height; i++)
+    {
+        if (pixels[i * 4 + 3] != 255)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ------------------------------------ Helpers ------------------------------------------
+
+// one 4x4 block as RGBA, texels past the image edge repeat the last row / column
+static void load_block(const unsigned char *pixels, int width, int height, int channels, int bx, int by,
+                       unsigned char texels[16][4])
+{
+    for (int y = 0; y < 4; y++)
+    {
+        int sy = by * 4 + y < height ? by * 4 + y : height - 1;
+        for (int x = 0; x < 4; x++)
+        {
+            int sx = bx * 4 + x < width ? bx * 4 + x : width - 1;
+            const unsigned char *p = pixels + ((size_t)sy * width + sx) * channels;
+            unsigned char *t = texels[y * 4 + x];
+            t[0] = p[0];
+            t[1] = p[1];
+            t[2] = p[2];
+            t[3] = channels == 4 ? p[3] : 255;
+        }
+    }
+}
+
+static uint16_t pack565(const float rgb[3])
+{
+    int r = (int)(rgb[0] * 31.0f / 255.0f + 0.5f);
+    int g = (int)(rgb[1] * 63.0f / 255.0f + 0.5f);
+    int b = (int)(rgb[2] * 31.0f / 255.0f + 0.5f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void unpack565(uint16_t c, int rgb[3])
+{
+    int r = (c >> 11) & 31;
+    int g = (c >> 5) & 63;
+    int b = c & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// the four colors a decoder derives from two endpoints, opaque mode when c0 > c1
+static void color_palette(uint16_t c0, uint16_t c1, bool allow_transparent, int palette[4][4])
+{
+    unpack565(c0, palette[0]);
+    unpack565(c1, palette[1]);
+    palette[0][3] = palette[1][3] = 255;
+    for (int c = 0; c < 3; c++)
+    {
+        if (c0 > c1 || !allow_transparent)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        else
+        {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    palette[2][3] = 255;
+    palette[3][3] = (c0 > c1 || !allow_transparent) ? 255 : 0;
+}
+
+static void put16(unsigned char *out, uint16_t value)
+{
+    out[0] = (unsigned char)value;
+    out[1] = (unsigned char)(value >> 8);
+}
+
+// ------------------------------------ Encoding -----------------------------------------
+
+// endpoints at the extremes of the block along its principal axis, pulled in by 1/16
+static void encode_color_block(const unsigned char texels[16][4], unsigned char *out)
+{
+    float mean[3] = {0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            mean[c] += texels[i][c] / 16.0f;
+        }
+    }
+
+    float cov[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f}; // rr rg rb gg gb bb
+    for (int i = 0; i < 16; i++)
+    {
+        float r = texels[i][0] - mean[0];
+        float g = texels[i][1] - mean[1];
+        float b = texels[i][2] - mean[2];
+        cov[0] += r * r;
+        cov[1] += r * g;
+        cov[2] += r * b;
+        cov[3] += g * g;
+        cov[4] += g * b;
+        cov[5] += b * b;
+    }
+
+    // a few power iterations are plenty for 16 points
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+    for (int iteration = 0; iteration < 4; iteration++)
+    {
+        float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+        float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+        float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+        float length = std::sqrt(x * x + y * y + z * z);
+        if (length < 1e-6f)
+        {
+            break; // flat block, any axis does
+        }
+        axis[0] = x / length;
+        axis[1] = y / length;
+        axis[2] = z / length;
+    }
+
+    float lo = 1e30f;
+    float hi = -1e30f;
+    for (int i = 0; i < 16; i++)
+    {
+        float t = (texels[i][0] - mean[0]) * axis[0] + (texels[i][1] - mean[1]) * axis[1] + (texels[i][2] - mean[2]) * axis[2];
+        lo = t < lo ? t : lo;
+        hi = t > hi ? t : hi;
+    }
+    float inset = (hi - lo) / 16.0f;
+    lo += inset;
+    hi -= inset;
+
+    float end0[3], end1[3];
+    for (int c = 0; c < 3; c++)
+    {
+        end0[c] = std::fmin(std::fmax(mean[c] + axis[c] * hi, 0.0f), 255.0f);
+        end1[c] = std::fmin(std::fmax(mean[c] + axis[c] * lo, 0.0f), 255.0f);
+    }
+
+    uint16_t c0 = pack565(end0);
+    uint16_t c1 = pack565(end1);
+    if (c0 < c1)
+    {
+        uint16_t swap = c0;
+        c0 = c1;
+        c1 = swap;
+    }
+
+    uint32_t indices = 0;
+    if (c0 != c1)
+    {
+        int palette[4][4];
+        color_palette(c0, c1, false, palette);
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0;
+            int best_error = 1 << 30;
+            for (int p = 0; p < 4; p++)
+            {
+                int dr = texels[i][0] - palette[p][0];
+                int dg = texels[i][1] - palette[p][1];
+                int db = texels[i][2] - palette[p][2];
+                int error = dr * dr + dg * dg + db * db;
+                if (error < best_error)
+                {
+                    best_error = error;
+                    best = p;
+                }
+            }
+            indices |= (uint32_t)best << (2 * i);
+        }
+    }
+
+    put16(out, c0);
+    put16(out + 2, c1);
+    for (int i = 0; i < 4; i++)
+    {
+        out[4 + i] = (unsigned char)(indices >> (8 * i));
+    }
+}
+
+static void alpha_palette(int a0, int a1, int palette[8])
+{
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1)
+    {
+        for (int i = 2; i < 8; i++)
+        {
+            palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+        }
+    }
+    else
+    {
+        for (int i = 2; i < 6; i++)
+        {
+            palette[i] = ((6 - i) * a0 + (i - 1) * a1) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+static void encode_alpha_block(const unsigned char texels[16][4], unsigned char *out)
+{
+    int a0 = 0;
+    int a1 = 255;
+    for (int i = 0; i < 16; i++)
+    {
+        a0 = texels[i][3] > a0 ? texels[i][3] : a0;
+        a1 = texels[i][3] < a1 ? texels[i][3] : a1;
+    }
+
+    uint64_t indices = 0;
+    if (a0 != a1)
+    {
+        int palette[8];
+        alpha_palette(a0, a1, palette);
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0;
+            int best_error = 256;
+            for (int p = 0; p < 8; p++)
+            {
+                int error = std::abs(texels[i][3] - palette[p]);
+                if (error < best_error)
+                {
+                    best_error = error;
+                    best = p;
+                }
+            }
+            indices |= (uint64_t)best << (3 * i);
+        }
+    }
+
+    out[0] = (unsigned char)a0;
+    out[1] = (unsigned char)a1;
+    for (int i = 0; i < 6; i++)
+    {
+        out[2 + i] = (unsigned char)(indices >> (8 * i));
+    }
+}
+
+void encodeBC1(const unsigned char *pixels, int width, int height, int channels, unsigned char *out)
+{
+    unsigned char texels[16][4];
+    for (int by = 0; by < (height + 3) / 4; by++)
+    {
+        for (int bx = 0; bx < (width + 3) / 4; bx++)
+        {
+            load_block(pixels, width, height, channels, bx, by, texels);
+            encode_color_block(texels, out);
+            out += 8;
+        }
+    }
+}
+
+void encodeBC3(const unsigned char *pixels, int width, int height, unsigned char *out)
+{
+    unsigned char texels[16][4];
+    for (int by = 0; by < (height + 3) / 4; by++)
+    {
+        for (int bx = 0; bx < (width + 3) / 4; bx++)
+        {
+            load_block(pixels, width, height, 4, bx, by, texels);
+            encode_alpha_block(texels, out);
+            encode_color_block(texels, out + 8);
+            out += 16;
+        }
+    }
+}
+
+// ------------------------------------ Decoding -----------------------------------------
+
+static void decode_color_block(const unsigned char *block, bool allow_transparent, unsigned char texels[16][4])
+{
+    uint16_t c0 = (uint16_t)(block[0] | (block[1] << 8));
+    uint16_t c1 = (uint16_t)(block[2] | (block[3] << 8));
+    uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24);
+
+    int palette[4][4];
+    color_palette(c0, c1, allow_transparent, palette);
+    for (int i = 0; i < 16; i++)
+    {
+        const int *color = palette[(indices >> (2 * i)) & 3];
+        for (int c = 0; c < 4; c++)
+        {
+            texels[i][c] = (unsigned char)color[c];
+        }
+    }
+}
+
+static void decode_alpha_block(const unsigned char *block, unsigned char texels[16][4])
+{
+    int palette[8];
+    alpha_palette(block[0], block[1], palette);
+
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; i++)
+    {
+        indices |= (uint64_t)block[2 + i] << (8 * i);
+    }
+    for (int i = 0; i < 16; i++)
+    {
+        texels[i][3] = (unsigned char)palette[(indices >> (3 * i)) & 7];
+    }
+}
+
+static void store_block(const unsigned char texels[16][4], int width, int height, int bx, int by, unsigned char *out)
+{
+    for (int y = 0; y < 4 && by * 4 + y < height; y++)
+    {
+        for (int x = 0; x < 4 && bx * 4 + x < width; x++)
+        {
+            memcpy(out + ((size_t)(by * 4 + y) * width + bx * 4 + x) * 4, texels[y * 4 + x], 4);
+        }
+    }
+}
+
+void decodeBC1(const unsigned char *blocks, int width, int height, unsigned char *out)
+{
+    unsigned char texels[16][4];
+    for (int by = 0; by < (height + 3) / 4; by++)
+    {
+        for (int bx = 0; bx < (width + 3) / 4; bx++)
+        {
+            decode_color_block(blocks, true, texels);
+            store_block(texels, width, height, bx, by, out);
+            blocks += 8;
+        }
+    }
+}
+
+void decodeBC3(const unsigned char *blocks, int width, int height, unsigned char *out)
+{
+    unsigned char texels[16][4];
+    for (int by = 0; by < (height + 3) / 4; by++)
+    {
+        for (int bx = 0; bx < (width + 3) / 4; bx++)
+        {
+            // the color half of BC3 is always four color mode
+            decode_color_block(blocks + 8, false, texels);
+            decode_alpha_block(blocks, texels);
+            store_block(texels, width, height, bx, by, out);
+            blocks += 16;
+        }
+    }
+}
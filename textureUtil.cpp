@@ -1,17 +1,197 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb/stb_image.h"
 #include "textureUtil.h"
+#include "glStateCache.h"
+#include "cookedAsset.h"
+#include "textureCompression.h"
 #include <cstdio>
+#include <cstring>
 
 bool TEXTURE_DGB = false;
 
+// glad is generated for a 3.3 core profile, the compressed formats come from extensions
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+
+static size_t texture_memory_total = 0;
+
+size_t textureMemoryTotal()
+{
+    return texture_memory_total;
+}
+
+// 25 is the last alpha the shaders' 0.1 cutoff discards
+alpha_mode_t classifyAlpha(const unsigned char *rgba, int width, int height, int stride)
+{
+    alpha_mode_t mode = ALPHA_OPAQUE;
+    for (int y = 0; y < height; y++)
+    {
+        const unsigned char *row = rgba + (size_t)y * stride * 4;
+        for (int x = 0; x < width; x++)
+        {
+            unsigned char a = row[x * 4 + 3];
+            if (a == 255)
+            {
+                continue;
+            }
+            if (a > 25)
+            {
+                return ALPHA_BLEND;
+            }
+            mode = ALPHA_TEST;
+        }
+    }
+    return mode;
+}
+
+static bool has_extension(const char *name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        const char *extension = (const char *)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        if (extension && strcmp(extension, name) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool textureFormatSupported(uint32_t format)
+{
+    static int s3tc = -1;
+    static int bptc = -1;
+    switch (format)
+    {
+    case COOKED_RGB8:
+    case COOKED_RGBA8:
+        return true;
+    case COOKED_BC1:
+    case COOKED_BC3:
+        if (s3tc < 0)
+        {
+            s3tc = has_extension("GL_EXT_texture_compression_s3tc");
+        }
+        return s3tc;
+    case COOKED_BC7:
+        if (bptc < 0)
+        {
+            bptc = has_extension("GL_ARB_texture_compression_bptc");
+        }
+        return bptc;
+    default:
+        return false;
+    }
+}
+
+static GLenum compressed_internal_format(uint32_t format)
+{
+    switch (format)
+    {
+    case COOKED_BC1:
+        // the RGBA variant also decodes the 1 bit alpha blocks of foreign .dds files
+        return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+    case COOKED_BC3:
+        return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    default:
+        return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+}
+
+static const char *format_name(uint32_t format)
+{
+    switch (format)
+    {
+    case COOKED_RGB8:
+        return "RGB8";
+    case COOKED_RGBA8:
+        return "RGBA8";
+    case COOKED_BC1:
+        return "BC1";
+    case COOKED_BC3:
+        return "BC3";
+    case COOKED_BC7:
+        return "BC7";
+    default:
+        return "unknown";
+    }
+}
+
 Texture2D::Texture2D(const char *texturePath)
 {
+    if (isCookedPath(texturePath))
+    {
+        upload(0, 0, 0, nullptr);
+
+        MappedFile file;
+        cooked_texture_t cooked;
+        if (!file.open(texturePath) || !readTextureContainer(file, cooked) || !setCooked(cooked, file.data()))
+        {
+            printf("Issue loading cooked texture %s\n", texturePath);
+        }
+        return;
+    }
+
     GLint width, height, nrChannels;
     stbi_set_flip_vertically_on_load(true);
 
+    // load image data
+    unsigned char *image_data = stbi_load(texturePath, &width, &height, &nrChannels, 0);
+
+    if (TEXTURE_DGB && image_data)
+    {
+        printf("Image width: %d\n", width);
+        printf("Image height: %d\n", height);
+        printf("Image channels: %d\n", nrChannels);
+        printf("%d %d %d \n", image_data[0], image_data[1], image_data[2]);
+    }
+
+    if (image_data)
+    {
+        upload(width, height, nrChannels, image_data);
+        stbi_image_free(image_data);
+    }
+    else
+    {
+        upload(0, 0, 0, nullptr);
+        printf("Issue loading image data\n");
+    }
+}
+
+// pixels are expected bottom row first, like stbi with flip on load
+Texture2D::Texture2D(int width, int height, int channels, const unsigned char *pixels)
+{
+    upload(width, height, channels, pixels);
+}
+
+// 1x1 transparent stand-in, the real image arrives later through setImage()
+Texture2D::Texture2D()
+{
+    const unsigned char placeholder[4] = {0, 0, 0, 0};
+    upload(1, 1, 4, placeholder);
+}
+
+// must run while the context is current, like every GL object owner here
+Texture2D::~Texture2D()
+{
+    texture_memory_total -= _memory_bytes;
+    GLStateCache::get().forgetTexture(textureID);
+    glDeleteTextures(1, &textureID);
+}
+
+void Texture2D::upload(int width, int height, int channels, const unsigned char *pixels)
+{
     glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
+    GLStateCache::get().bindTexture(GL_TEXTURE_2D, textureID, 0);
 
     // set wrapping and filtering parameters
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -19,53 +199,129 @@ Texture2D::Texture2D(const char *texturePath)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    // load image data
-    unsigned char *image_data = stbi_load(texturePath, &width, &height, &nrChannels, 0);
+    _width = 0;
+    _height = 0;
+    _memory_bytes = 0;
+    _format_name = "none";
 
-    if (TEXTURE_DGB)
+    if (pixels)
     {
-        printf("Image width: %d\n", width);
-        printf("Image height: %d\n", height);
-        printf("Image channels: %d\n", nrChannels);
-        printf("%d %d %d \n", image_data[0], image_data[1], image_data[2]);
+        setImage(width, height, channels, pixels);
     }
+}
 
-    if (image_data)
+// (re)specifies the image of the existing texture object, ids handed out before stay valid.
+// With a pixel unpack buffer bound, pixels is an offset into that buffer.
+void Texture2D::setImage(int width, int height, int channels, const unsigned char *pixels)
+{
+    GLStateCache::get().bindTexture(GL_TEXTURE_2D, textureID, 0);
+
+    _width = width;
+    _height = height;
+
+    // glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (channels == 4)
+    {
+        glTexImage2D(
+            GL_TEXTURE_2D,
+            0,       // mipmap level
+            GL_RGBA, // storage type of image
+            width,
+            height,
+            0,       // legacy styff
+            GL_RGBA, // type of source image
+            GL_UNSIGNED_BYTE,
+            pixels);
+    }
+    else
+    {
+        glTexImage2D(
+            GL_TEXTURE_2D,
+            0,      // mipmap level
+            GL_RGB, // storage type of image
+            width,
+            height,
+            0,      // legacy styff
+            GL_RGB, // type of source image
+            GL_UNSIGNED_BYTE,
+            pixels);
+    }
+
+    // a cooked image may have capped the chain at its own size
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    // drivers pad RGB8 to 32 bits, the full mip chain adds a third
+    setMemory((size_t)width * height * 4 * 4 / 3, channels == 4 ? "RGBA8" : "RGB8");
+}
+
+// every level comes straight out of the mapped file, no decode and no glGenerateMipmap
+bool Texture2D::setCooked(const cooked_texture_t &texture, const unsigned char *file_base)
+{
+    bool compressed = blockBytes(texture.format) != 0;
+    bool supported = textureFormatSupported(texture.format);
+    if (!supported && texture.format != COOKED_BC1 && texture.format != COOKED_BC3)
     {
-        // glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-        if (nrChannels == 4)
+        printf("Texture: %s is not supported by this driver and can not be decoded\n", format_name(texture.format));
+        return false;
+    }
+
+    GLStateCache::get().bindTexture(GL_TEXTURE_2D, textureID, 0);
+
+    _width = (int)texture.width;
+    _height = (int)texture.height;
+
+    size_t bytes = 0;
+    std::vector<unsigned char> decoded;
+    GLenum format = texture.format == COOKED_RGB8 ? GL_RGB : GL_RGBA;
+    for (uint32_t level = 0; level < texture.mip_count; level++)
+    {
+        const cooked_mip_t &mip = texture.mips[level];
+        if (compressed && supported)
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, compressed_internal_format(texture.format), mip.width, mip.height, 0,
+                                   compressedLevelSize(texture.format, mip.width, mip.height), file_base + mip.offset);
+            bytes += mip.size;
+        }
+        else if (compressed)
         {
-            glTexImage2D(
-                GL_TEXTURE_2D,
-                0,       // mipmap level
-                GL_RGBA, // storage type of image
-                width,
-                height,
-                0,       // legacy styff
-                GL_RGBA, // type of source image
-                GL_UNSIGNED_BYTE,
-                image_data);
+            // no S3TC in this driver, the CPU decodes and the texture costs as much as an RGBA one
+            decoded.resize((size_t)mip.width * mip.height * 4);
+            if (texture.format == COOKED_BC1)
+            {
+                decodeBC1(file_base + mip.offset, mip.width, mip.height, decoded.data());
+            }
+            else
+            {
+                decodeBC3(file_base + mip.offset, mip.width, mip.height, decoded.data());
+            }
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, mip.width, mip.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, decoded.data());
+            bytes += decoded.size();
         }
         else
         {
-            glTexImage2D(
-                GL_TEXTURE_2D,
-                0,      // mipmap level
-                GL_RGB, // storage type of image
-                width,
-                height,
-                0,      // legacy styff
-                GL_RGB, // type of source image
-                GL_UNSIGNED_BYTE,
-                image_data);
+            glTexImage2D(GL_TEXTURE_2D, level, format, mip.width, mip.height, 0, format, GL_UNSIGNED_BYTE,
+                         file_base + mip.offset);
+            bytes += (size_t)mip.width * mip.height * 4;
         }
-
-        glGenerateMipmap(GL_TEXTURE_2D);
-        stbi_image_free(image_data);
     }
-    else
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture.mip_count - 1);
+
+    setMemory(bytes, compressed && !supported ? "RGBA8 (decoded)" : format_name(texture.format));
+    return true;
+}
+
+void Texture2D::setMemory(size_t bytes, const char *format_name)
+{
+    texture_memory_total = texture_memory_total - _memory_bytes + bytes;
+    _memory_bytes = bytes;
+    _format_name = format_name;
+
+    if (TEXTURE_DGB)
     {
-        printf("Issue loading image data\n");
+        printf("Texture %u: %dx%d %s, %.1f KiB (all textures %.1f MiB)\n", textureID, _width, _height, format_name,
+               bytes / 1024.0, texture_memory_total / (1024.0 * 1024.0));
     }
 }
 
@@ -74,10 +330,35 @@ GLuint Texture2D::getTextureID() const
     return textureID;
 }
 
+int Texture2D::getWidth() const
+{
+    return _width;
+}
+
+int Texture2D::getHeight() const
+{
+    return _height;
+}
+
+size_t Texture2D::getMemoryBytes() const
+{
+    return _memory_bytes;
+}
+
+const char *Texture2D::getFormatName() const
+{
+    return _format_name;
+}
+
+TextureRegion Texture2D::region() const
+{
+    return TextureRegion{textureID, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f)};
+}
+
 TextureCube::TextureCube(std::vector<std::string> faces)
 {
     glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+    GLStateCache::get().bindTexture(GL_TEXTURE_CUBE_MAP, textureID, 0);
     stbi_set_flip_vertically_on_load(false);
     int width, height, nrChannels;
     for (unsigned int i = 0; i < faces.size(); i++)
@@ -0,0 +1,543 @@
+#include "tilemap.h"
+#include "glStateCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+bool TILEMAP_DBG = false;
+
+static const int CHUNK_TILES = TILEMAP_CHUNK_SIZE * TILEMAP_CHUNK_SIZE;
+static const int VERTICES_PER_TILE = 4;
+static const int INDICES_PER_TILE = 6;
+static const uint16_t NO_QUAD = 0xFFFF;
+
+// inset against bleeding from neighbouring tiles under linear filtering
+static const float UV_INSET = 1.0f / 64.0f;
+
+TileMap::TileMap(int width, int height, float tile_size, glm::vec2 origin, MemoryArena &arena)
+    : _width(width), _height(height), _tile_size(tile_size), _origin(origin), _arena(arena), _draw_count(0),
+      _tex_shader(nullptr), _EBO(0), _tileset(0), _tileset_columns(1), _tileset_rows(1), _stats{}
+{
+    _chunks_x = (width + TILEMAP_CHUNK_SIZE - 1) / TILEMAP_CHUNK_SIZE;
+    _chunks_y = (height + TILEMAP_CHUNK_SIZE - 1) / TILEMAP_CHUNK_SIZE;
+    _chunk_count = (size_t)_chunks_x * _chunks_y;
+
+    _tiles = arena.allocate<tile_t>((size_t)width * height);
+    std::fill(_tiles, _tiles + (size_t)width * height, TILE_EMPTY);
+    _tile_flags = arena.allocate<uint8_t>(65536);
+    std::fill(_tile_flags, _tile_flags + 65536, TILE_SOLID);
+    _tile_flags[TILE_EMPTY] = 0;
+    _solid_stride = (width + 63) / 64;
+    _solid = arena.allocate<uint64_t>((size_t)_solid_stride * height);
+    std::fill(_solid, _solid + (size_t)_solid_stride * height, 0);
+
+    // GL objects and quad tables are created lazily, the first time a chunk is seen
+    _chunks = arena.allocate<chunk_t>(_chunk_count);
+    for (size_t i = 0; i < _chunk_count; i++)
+    {
+        chunk_t &chunk = _chunks[i];
+        chunk.VAO = 0;
+        chunk.VBO = 0;
+        chunk.quad_count = 0;
+        chunk.last_drawn = 0;
+        chunk.built = false;
+        chunk.dirty = true;
+        chunk.quad_of_tile = nullptr;
+    }
+
+    _scratch.reserve(CHUNK_TILES * VERTICES_PER_TILE);
+
+    if (TILEMAP_DBG)
+    {
+        printf("Tilemap created: %d x %d tiles, %d x %d chunks.\n", width, height, _chunks_x, _chunks_y);
+    }
+}
+
+TileMap::~TileMap()
+{
+    for (uint32_t index : _resident)
+    {
+        releaseChunk(_chunks[index]);
+    }
+    if (_EBO)
+    {
+        glDeleteBuffers(1, &_EBO);
+    }
+}
+
+std::unique_ptr<TileMap> TileMap::loadCSV(const std::string &path, float tile_size, glm::vec2 origin, MemoryArena &arena)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        printf("Tilemap: could not open %s\n", path.c_str());
+        return nullptr;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    std::string text(size > 0 ? (size_t)size : 0, '\0');
+    size_t read = fread(&text[0], 1, text.size(), file);
+    fclose(file);
+    text.resize(read);
+
+    // rows as read, top row first
+    std::vector<std::vector<tile_t>> rows;
+    int width = 0;
+    const char *p = text.c_str();
+    while (*p)
+    {
+        std::vector<tile_t> row;
+        while (*p && *p != '\n')
+        {
+            char *end;
+            unsigned long id = strtoul(p, &end, 10);
+            if (end == p)
+            {
+                p++; // separator or stray character
+                continue;
+            }
+            // Tiled keeps flip flags in the top bits
+            id &= 0x1FFFFFFFul;
+            row.push_back(id > 0xFFFF ? TILE_EMPTY : (tile_t)id);
+            p = end;
+        }
+        if (*p == '\n')
+        {
+            p++;
+        }
+        if (!row.empty())
+        {
+            width = row.size() > (size_t)width ? (int)row.size() : width;
+            rows.push_back(std::move(row));
+        }
+    }
+
+    if (rows.empty())
+    {
+        printf("Tilemap: %s has no tiles\n", path.c_str());
+        return nullptr;
+    }
+
+    int height = (int)rows.size();
+    std::unique_ptr<TileMap> map(new TileMap(width, height, tile_size, origin, arena));
+    for (int r = 0; r < height; r++)
+    {
+        int y = height - 1 - r;
+        for (size_t x = 0; x < rows[r].size(); x++)
+        {
+            map->_tiles[(size_t)y * width + x] = rows[r][x];
+        }
+    }
+    map->rebuildSolidMask();
+    return map;
+}
+
+void TileMap::setTileset(GLuint texture, int columns, int rows)
+{
+    _tileset = texture;
+    columns = columns > 0 ? columns : 1;
+    rows = rows > 0 ? rows : 1;
+    if (columns == _tileset_columns && rows == _tileset_rows)
+    {
+        return; // same grid, same uvs
+    }
+    _tileset_columns = columns;
+    _tileset_rows = rows;
+
+    // every uv changes
+    for (size_t i = 0; i < _chunk_count; i++)
+    {
+        _chunks[i].dirty = true;
+    }
+}
+
+void TileMap::setTileFlags(tile_t tile, uint8_t flags)
+{
+    bool was_solid = (_tile_flags[tile] & TILE_SOLID) != 0;
+    _tile_flags[tile] = flags;
+    if (was_solid != ((flags & TILE_SOLID) != 0))
+    {
+        rebuildSolidMask(); // every tile of that id, once per level setup in practice
+    }
+}
+
+void TileMap::updateSolid(int x, int y)
+{
+    uint64_t &word = _solid[(size_t)y * _solid_stride + x / 64];
+    uint64_t bit = 1ull << (x % 64);
+    word = (_tile_flags[_tiles[(size_t)y * _width + x]] & TILE_SOLID) ? word | bit : word & ~bit;
+}
+
+void TileMap::rebuildSolidMask()
+{
+    std::fill(_solid, _solid + (size_t)_solid_stride * _height, 0);
+    for (int y = 0; y < _height; y++)
+    {
+        for (int x = 0; x < _width; x++)
+        {
+            updateSolid(x, y);
+        }
+    }
+}
+
+tile_t TileMap::getTile(int x, int y) const
+{
+    if (x < 0 || y < 0 || x >= _width || y >= _height)
+    {
+        return TILE_EMPTY;
+    }
+    return _tiles[(size_t)y * _width + x];
+}
+
+TileMap::chunk_t &TileMap::chunkOf(int x, int y)
+{
+    return _chunks[(size_t)(y / TILEMAP_CHUNK_SIZE) * _chunks_x + x / TILEMAP_CHUNK_SIZE];
+}
+
+void TileMap::setTile(int x, int y, tile_t tile)
+{
+    if (x < 0 || y < 0 || x >= _width || y >= _height)
+    {
+        return;
+    }
+    tile_t &slot = _tiles[(size_t)y * _width + x];
+    if (slot == tile)
+    {
+        return;
+    }
+    tile_t old = slot;
+    slot = tile;
+    updateSolid(x, y);
+
+    chunk_t &chunk = chunkOf(x, y);
+    if (!chunk.built || chunk.dirty)
+    {
+        return; // rebuilt before its next draw anyway
+    }
+
+    if (old != TILE_EMPTY && tile != TILE_EMPTY)
+    {
+        // same quad count, rewrite the four vertices of this tile
+        int local = (y % TILEMAP_CHUNK_SIZE) * TILEMAP_CHUNK_SIZE + x % TILEMAP_CHUNK_SIZE;
+        uint16_t quad = chunk.quad_of_tile[local];
+        shapes::sprite_vertex vertices[VERTICES_PER_TILE];
+        writeTileQuad(vertices, x, y, tile);
+
+        GLStateCache::get().bindBuffer(GL_ARRAY_BUFFER, chunk.VBO);
+        glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)quad * sizeof(vertices), sizeof(vertices), vertices);
+        _stats.tiles_patched++;
+    }
+    else
+    {
+        chunk.dirty = true;
+    }
+}
+
+void TileMap::fill(int x0, int y0, int x1, int y1, tile_t tile)
+{
+    x0 = x0 < 0 ? 0 : x0;
+    y0 = y0 < 0 ? 0 : y0;
+    x1 = x1 >= _width ? _width - 1 : x1;
+    y1 = y1 >= _height ? _height - 1 : y1;
+
+    // whole chunks get rebuilt, no per-tile patching
+    for (int y = y0; y <= y1; y++)
+    {
+        for (int x = x0; x <= x1; x++)
+        {
+            _tiles[(size_t)y * _width + x] = tile;
+            updateSolid(x, y);
+        }
+    }
+    for (int cy = y0 / TILEMAP_CHUNK_SIZE; cy <= y1 / TILEMAP_CHUNK_SIZE && y0 <= y1; cy++)
+    {
+        for (int cx = x0 / TILEMAP_CHUNK_SIZE; cx <= x1 / TILEMAP_CHUNK_SIZE && x0 <= x1; cx++)
+        {
+            _chunks[(size_t)cy * _chunks_x + cx].dirty = true;
+        }
+    }
+}
+
+bool TileMap::isSolid(int x, int y) const
+{
+    if (x < 0 || y < 0 || x >= _width || y >= _height)
+    {
+        return false;
+    }
+    return (_solid[(size_t)y * _solid_stride + x / 64] >> (x % 64)) & 1;
+}
+
+glm::ivec2 TileMap::tileAt(glm::vec2 world) const
+{
+    glm::vec2 local = (world - _origin) / _tile_size;
+    return glm::ivec2((int)std::floor(local.x), (int)std::floor(local.y));
+}
+
+glm::vec4 TileMap::tileRect(int x, int y) const
+{
+    glm::vec2 min = _origin + glm::vec2((float)x, (float)y) * _tile_size;
+    return glm::vec4(min.x, min.y, min.x + _tile_size, min.y + _tile_size);
+}
+
+void TileMap::writeTileQuad(shapes::sprite_vertex *dst, int x, int y, tile_t tile) const
+{
+    glm::vec4 rect = tileRect(x, y);
+
+    int index = tile - 1;
+    int column = index % _tileset_columns;
+    int row = (index / _tileset_columns) % _tileset_rows;
+    float tile_u = 1.0f / _tileset_columns;
+    float tile_v = 1.0f / _tileset_rows;
+
+    // images are stored bottom row first, tileset rows count from the top
+    float u0 = (column + UV_INSET) * tile_u;
+    float u1 = (column + 1 - UV_INSET) * tile_u;
+    float v1 = 1.0f - (row + UV_INSET) * tile_v;
+    float v0 = 1.0f - (row + 1 - UV_INSET) * tile_v;
+
+    dst[0] = {rect.x, rect.y, 0.0f, u0, v0, 0xFFFFFFFF}; // bottom left
+    dst[1] = {rect.x, rect.w, 0.0f, u0, v1, 0xFFFFFFFF}; // top left
+    dst[2] = {rect.z, rect.w, 0.0f, u1, v1, 0xFFFFFFFF}; // top right
+    dst[3] = {rect.z, rect.y, 0.0f, u1, v0, 0xFFFFFFFF}; // bottom right
+}
+
+void TileMap::createChunkBuffers(chunk_t &chunk)
+{
+    if (!_EBO)
+    {
+        // Static index pattern for one full chunk
+        std::vector<GLushort> indices(CHUNK_TILES * INDICES_PER_TILE);
+        for (int i = 0; i < CHUNK_TILES; i++)
+        {
+            GLushort v = (GLushort)(i * VERTICES_PER_TILE);
+            indices[i * INDICES_PER_TILE + 0] = v + 0; // bottom left
+            indices[i * INDICES_PER_TILE + 1] = v + 1; // top left
+            indices[i * INDICES_PER_TILE + 2] = v + 2; // top right
+            indices[i * INDICES_PER_TILE + 3] = v + 2; // top right
+            indices[i * INDICES_PER_TILE + 4] = v + 3; // bottom right
+            indices[i * INDICES_PER_TILE + 5] = v + 0; // bottom left
+        }
+        // the element binding is VAO state, keep whatever VAO is bound out of it
+        GLStateCache::get().bindVertexArray(0);
+        glGenBuffers(1, &_EBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), indices.data(), GL_STATIC_DRAW);
+    }
+
+    // Bookmark
+    glGenVertexArrays(1, &chunk.VAO);
+    GLStateCache::get().bindVertexArray(chunk.VAO);
+
+    glGenBuffers(1, &chunk.VBO);
+    GLStateCache::get().bindBuffer(GL_ARRAY_BUFFER, chunk.VBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _EBO);
+
+    // same layout as the sprite batch, drawn with the sprite shader
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(shapes::sprite_vertex), (void *)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(shapes::sprite_vertex), (void *)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(shapes::sprite_vertex), (void *)(5 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+
+    // Disable VAO
+    GLStateCache::get().bindVertexArray(0);
+
+    // a table of an evicted chunk if there is one, the arena only grows to the most chunks ever resident
+    if (!_free_tables.empty())
+    {
+        chunk.quad_of_tile = _free_tables.back();
+        _free_tables.pop_back();
+    }
+    else
+    {
+        chunk.quad_of_tile = _arena.allocate<uint16_t>(CHUNK_TILES);
+    }
+    std::fill(chunk.quad_of_tile, chunk.quad_of_tile + CHUNK_TILES, NO_QUAD);
+    chunk.built = true;
+    chunk.dirty = true;
+    _resident.push_back((uint32_t)(&chunk - _chunks));
+}
+
+// GL objects deleted and the quad table handed back, the chunk is built again when next seen
+void TileMap::releaseChunk(chunk_t &chunk)
+{
+    GLStateCache::get().forgetVertexArray(chunk.VAO);
+    GLStateCache::get().forgetBuffer(chunk.VBO);
+    glDeleteVertexArrays(1, &chunk.VAO);
+    glDeleteBuffers(1, &chunk.VBO);
+    chunk.VAO = 0;
+    chunk.VBO = 0;
+    chunk.quad_count = 0;
+    chunk.built = false;
+    chunk.dirty = true;
+
+    _free_tables.push_back(chunk.quad_of_tile);
+    chunk.quad_of_tile = nullptr;
+}
+
+// only the resident list is walked, never the whole grid
+void TileMap::evictChunks()
+{
+    for (size_t i = 0; i < _resident.size();)
+    {
+        chunk_t &chunk = _chunks[_resident[i]];
+        if (_draw_count - chunk.last_drawn <= TILEMAP_EVICT_DRAWS)
+        {
+            i++;
+            continue;
+        }
+        releaseChunk(chunk);
+        _resident[i] = _resident.back();
+        _resident.pop_back();
+        _stats.chunks_evicted++;
+    }
+}
+
+void TileMap::rebuildChunk(int cx, int cy)
+{
+    chunk_t &chunk = _chunks[(size_t)cy * _chunks_x + cx];
+
+    _scratch.clear();
+    int x0 = cx * TILEMAP_CHUNK_SIZE;
+    int y0 = cy * TILEMAP_CHUNK_SIZE;
+    for (int ly = 0; ly < TILEMAP_CHUNK_SIZE; ly++)
+    {
+        for (int lx = 0; lx < TILEMAP_CHUNK_SIZE; lx++)
+        {
+            int local = ly * TILEMAP_CHUNK_SIZE + lx;
+            tile_t tile = getTile(x0 + lx, y0 + ly);
+            if (tile == TILE_EMPTY)
+            {
+                chunk.quad_of_tile[local] = NO_QUAD;
+                continue;
+            }
+            chunk.quad_of_tile[local] = (uint16_t)(_scratch.size() / VERTICES_PER_TILE);
+            _scratch.resize(_scratch.size() + VERTICES_PER_TILE);
+            writeTileQuad(&_scratch[_scratch.size() - VERTICES_PER_TILE], x0 + lx, y0 + ly, tile);
+        }
+    }
+
+    GLStateCache::get().bindBuffer(GL_ARRAY_BUFFER, chunk.VBO);
+    glBufferData(GL_ARRAY_BUFFER, _scratch.size() * sizeof(shapes::sprite_vertex), _scratch.data(), GL_STATIC_DRAW);
+
+    chunk.quad_count = (uint32_t)(_scratch.size() / VERTICES_PER_TILE);
+    chunk.dirty = false;
+    _stats.chunks_rebuilt++;
+
+    if (TILEMAP_DBG)
+    {
+        printf("Tilemap: rebuilt chunk (%d, %d), %u tiles\n", cx, cy, chunk.quad_count);
+    }
+}
+
+void TileMap::draw(Shader &shader, const glm::vec4 &view_rect)
+{
+    // chunk range under the view, nothing outside it is touched
+    float chunk_extent = _tile_size * TILEMAP_CHUNK_SIZE;
+    int cx0 = (int)std::floor((view_rect.x - _origin.x) / chunk_extent);
+    int cy0 = (int)std::floor((view_rect.y - _origin.y) / chunk_extent);
+    int cx1 = (int)std::floor((view_rect.z - _origin.x) / chunk_extent);
+    int cy1 = (int)std::floor((view_rect.w - _origin.y) / chunk_extent);
+    cx0 = cx0 < 0 ? 0 : cx0;
+    cy0 = cy0 < 0 ? 0 : cy0;
+    cx1 = cx1 >= _chunks_x ? _chunks_x - 1 : cx1;
+    cy1 = cy1 >= _chunks_y ? _chunks_y - 1 : cy1;
+
+    _draw_count++;
+    evictChunks();
+    if (cx0 > cx1 || cy0 > cy1)
+    {
+        return;
+    }
+
+    if (&shader != _tex_shader)
+    {
+        _tex_shader = &shader;
+        _tex_uniform = shader.getUniform<int>("tex");
+    }
+    shader.activate();
+    _tex_uniform.set(0);
+    GLStateCache::get().bindTexture(GL_TEXTURE_2D, _tileset, 0);
+
+    for (int cy = cy0; cy <= cy1; cy++)
+    {
+        for (int cx = cx0; cx <= cx1; cx++)
+        {
+            chunk_t &chunk = _chunks[(size_t)cy * _chunks_x + cx];
+            chunk.last_drawn = _draw_count;
+            _stats.chunks_visible++;
+
+            if (!chunk.built)
+            {
+                createChunkBuffers(chunk);
+            }
+            if (chunk.dirty)
+            {
+                rebuildChunk(cx, cy);
+            }
+            if (chunk.quad_count == 0)
+            {
+                continue;
+            }
+
+            GLStateCache::get().bindVertexArray(chunk.VAO);
+            glDrawElements(GL_TRIANGLES, chunk.quad_count * INDICES_PER_TILE, GL_UNSIGNED_SHORT, (void *)0);
+            _stats.chunks_drawn++;
+            _stats.tiles_drawn += chunk.quad_count;
+        }
+    }
+}
+
+const tile_t *TileMap::getTiles() const
+{
+    return _tiles;
+}
+
+const uint8_t *TileMap::getTileFlags() const
+{
+    return _tile_flags;
+}
+
+const uint64_t *TileMap::getSolidMask() const
+{
+    return _solid;
+}
+
+int TileMap::getSolidStride() const
+{
+    return _solid_stride;
+}
+
+int TileMap::getWidth() const
+{
+    return _width;
+}
+
+int TileMap::getHeight() const
+{
+    return _height;
+}
+
+float TileMap::getTileSize() const
+{
+    return _tile_size;
+}
+
+uint32_t TileMap::getResidentChunks() const
+{
+    return (uint32_t)_resident.size();
+}
+
+const tilemap_stats_t &TileMap::getStats() const
+{
+    return _stats;
+}
+
+void TileMap::resetStats()
+{
+    _stats = tilemap_stats_t{};
+}